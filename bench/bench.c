@@ -0,0 +1,318 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#define BENCH_MAX_CASES 128
+#define BENCH_MAX_METRICS 64
+
+typedef struct {
+    char name[96];
+    long long iters;
+    int reps;
+    double minNs, medianNs, p99Ns, meanNs;   /* per operation */
+    double cycles, cacheMisses;              /* per operation, < 0 if unavailable */
+    double gbPerSec;                         /* < 0 if the case has no byte count */
+} BenchResult;
+
+typedef struct {
+    char name[96];
+    char unit[16];
+    double value;
+} BenchMetricValue;
+
+struct BenchSuite {
+    const char *name;
+    int reps;
+    int warmup;
+    double scale;
+    const char *filter;
+    const char *jsonPath;
+    int perfFd;      /* group leader (cycles), -1 if unavailable */
+    int perfMissFd;  /* cache misses, -1 if unavailable */
+    BenchResult results[BENCH_MAX_CASES];
+    int count;
+    BenchMetricValue metrics[BENCH_MAX_METRICS];
+    int metricCount;
+};
+
+long long benchNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* ---- Hardware counters ---- */
+
+#ifdef __linux__
+static int perfOpen(unsigned long long config, int groupFd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = groupFd == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+#endif
+
+static void perfInit(BenchSuite *s) {
+    s->perfFd = -1;
+    s->perfMissFd = -1;
+#ifdef __linux__
+    if (getenv("BENCH_NO_PERF")) return;
+    s->perfFd = perfOpen(PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (s->perfFd < 0) {
+        s->perfFd = -1;
+        return;
+    }
+    s->perfMissFd = perfOpen(PERF_COUNT_HW_CACHE_MISSES, s->perfFd);
+    if (s->perfMissFd < 0) s->perfMissFd = -1;
+#endif
+}
+
+static void perfStart(BenchSuite *s) {
+#ifdef __linux__
+    if (s->perfFd < 0) return;
+    ioctl(s->perfFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(s->perfFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+    (void) s;
+#endif
+}
+
+/* reads the group into cycles / misses (left untouched when unavailable) */
+static void perfStop(BenchSuite *s, double *cycles, double *misses) {
+#ifdef __linux__
+    unsigned long long values[3] = {0, 0, 0};  /* nr, cycles, misses */
+    if (s->perfFd < 0) return;
+    ioctl(s->perfFd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    if (read(s->perfFd, values, sizeof(values)) < (ssize_t) (2 * sizeof(values[0]))) return;
+    *cycles = (double) values[1];
+    if (values[0] > 1) *misses = (double) values[2];
+#else
+    (void) s; (void) cycles; (void) misses;
+#endif
+}
+
+/* ---- Suite ---- */
+
+BenchSuite *benchOpen(const char *suiteName, int argc, char **argv) {
+    BenchSuite *s = (BenchSuite *) calloc(1, sizeof(BenchSuite));
+    if (!s) {
+        perror("calloc failed");
+        exit(1);
+    }
+    s->name = suiteName;
+    s->reps = 15;
+    s->warmup = 2;
+    s->scale = 1.0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *next = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--reps") == 0 && next) { s->reps = atoi(next); i++; }
+        else if (strcmp(argv[i], "--warmup") == 0 && next) { s->warmup = atoi(next); i++; }
+        else if (strcmp(argv[i], "--scale") == 0 && next) { s->scale = atof(next); i++; }
+        else if (strcmp(argv[i], "--filter") == 0 && next) { s->filter = next; i++; }
+        else if (strcmp(argv[i], "--json") == 0 && next) { s->jsonPath = next; i++; }
+        else {
+            fprintf(stderr, "usage: %s [--reps N] [--warmup N] [--scale X] "
+                            "[--filter STR] [--json FILE]\n", argv[0]);
+            exit(2);
+        }
+    }
+    if (s->reps < 1) s->reps = 1;
+    if (s->warmup < 0) s->warmup = 0;
+    if (s->scale <= 0) s->scale = 1.0;
+
+    perfInit(s);
+    fprintf(stderr, "== %s (%d reps, %d warm-up, counters %s)\n", s->name, s->reps,
+            s->warmup, s->perfFd >= 0 ? "on" : "unavailable");
+    fprintf(stderr, "%-36s %12s %12s %12s %10s %10s %8s\n",
+            "case", "min ns/op", "median", "p99", "cyc/op", "miss/op", "GB/s");
+    return s;
+}
+
+double benchScale(const BenchSuite *suite) {
+    return suite->scale;
+}
+
+long long benchScaled(const BenchSuite *suite, long long n) {
+    long long v = (long long) (n * suite->scale);
+    return v > 0 ? v : 1;
+}
+
+static int cmpDouble(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+void benchRun(BenchSuite *s, const BenchCase *bc) {
+    if (s->filter && !strstr(bc->name, s->filter)) return;
+    if (s->count >= BENCH_MAX_CASES) {
+        fprintf(stderr, "bench: too many cases, skipping %s\n", bc->name);
+        return;
+    }
+    long long iters = bc->iters > 0 ? bc->iters : 1;
+
+    for (int w = 0; w < s->warmup; w++) {
+        if (bc->setup) bc->setup(bc->ctx);
+        bc->run(bc->ctx, iters);
+        if (bc->teardown) bc->teardown(bc->ctx);
+    }
+
+    double *samples = (double *) malloc((size_t) s->reps * sizeof(double));
+    double cycles = -1, misses = -1, sumCycles = 0, sumMisses = 0, sum = 0;
+    if (!samples) {
+        perror("malloc failed");
+        exit(1);
+    }
+    for (int r = 0; r < s->reps; r++) {
+        if (bc->setup) bc->setup(bc->ctx);
+        perfStart(s);
+        long long t0 = benchNow();
+        bc->run(bc->ctx, iters);
+        long long t1 = benchNow();
+        perfStop(s, &cycles, &misses);
+        if (bc->teardown) bc->teardown(bc->ctx);
+        samples[r] = (double) (t1 - t0) / (double) iters;
+        sum += samples[r];
+        sumCycles += cycles;
+        sumMisses += misses;
+    }
+    qsort(samples, (size_t) s->reps, sizeof(double), cmpDouble);
+
+    BenchResult *res = &s->results[s->count++];
+    snprintf(res->name, sizeof(res->name), "%s", bc->name);
+    res->iters = iters;
+    res->reps = s->reps;
+    res->minNs = samples[0];
+    res->medianNs = samples[s->reps / 2];
+    res->p99Ns = samples[(int) ((s->reps - 1) * 0.99 + 0.5)];
+    res->meanNs = sum / s->reps;
+    res->cycles = cycles < 0 ? -1 : sumCycles / s->reps / (double) iters;
+    res->cacheMisses = misses < 0 ? -1 : sumMisses / s->reps / (double) iters;
+    /* bytes per nanosecond is GB/s */
+    res->gbPerSec = bc->bytesPerOp > 0 && res->medianNs > 0 ? bc->bytesPerOp / res->medianNs : -1;
+    free(samples);
+
+    char cyc[32] = "n/a", mis[32] = "n/a", gbs[32] = "-";
+    if (res->cycles >= 0) snprintf(cyc, sizeof(cyc), "%.1f", res->cycles);
+    if (res->cacheMisses >= 0) snprintf(mis, sizeof(mis), "%.3f", res->cacheMisses);
+    if (res->gbPerSec >= 0) snprintf(gbs, sizeof(gbs), "%.2f", res->gbPerSec);
+    fprintf(stderr, "%-36s %12.1f %12.1f %12.1f %10s %10s %8s\n",
+            res->name, res->minNs, res->medianNs, res->p99Ns, cyc, mis, gbs);
+}
+
+void benchMetric(BenchSuite *s, const char *name, double value, const char *unit) {
+    if (s->filter && !strstr(name, s->filter)) return;
+    if (s->metricCount >= BENCH_MAX_METRICS) return;
+    BenchMetricValue *m = &s->metrics[s->metricCount++];
+    snprintf(m->name, sizeof(m->name), "%s", name);
+    snprintf(m->unit, sizeof(m->unit), "%s", unit);
+    m->value = value;
+    fprintf(stderr, "%-36s %12.3f %s\n", m->name, value, m->unit);
+}
+
+void benchRate(BenchSuite *s, const char *caseName, double itemsPerOp, const char *unit) {
+    for (int i = 0; i < s->count; i++) {
+        if (strcmp(s->results[i].name, caseName) != 0 || s->results[i].medianNs <= 0) continue;
+        char name[96];
+        snprintf(name, sizeof(name), "%s/rate", caseName);
+        benchMetric(s, name, itemsPerOp / (s->results[i].medianNs * 1e-9), unit);
+        return;
+    }
+}
+
+static void jsonString(FILE *f, const char *str) {
+    fputc('"', f);
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\') fputc('\\', f);
+        fputc(*str, f);
+    }
+    fputc('"', f);
+}
+
+static void jsonNumber(FILE *f, double v) {
+    if (v < 0) fputs("null", f);
+    else fprintf(f, "%.3f", v);
+}
+
+int benchClose(BenchSuite *s) {
+    if (s->jsonPath) {
+        int toStdout = strcmp(s->jsonPath, "-") == 0;
+        FILE *f = toStdout ? stdout : fopen(s->jsonPath, "a");
+        if (!f) {
+            perror("bench: cannot open json output");
+        } else {
+            fputs("{\"suite\":", f);
+            jsonString(f, s->name);
+            fprintf(f, ",\"timestamp\":%lld,\"results\":[", (long long) time(NULL));
+            for (int i = 0; i < s->count; i++) {
+                const BenchResult *r = &s->results[i];
+                if (i) fputc(',', f);
+                fputs("{\"name\":", f);
+                jsonString(f, r->name);
+                fprintf(f, ",\"iters\":%lld,\"reps\":%d,\"min_ns\":%.3f,\"median_ns\":%.3f,"
+                           "\"p99_ns\":%.3f,\"mean_ns\":%.3f,\"cycles_per_op\":",
+                        r->iters, r->reps, r->minNs, r->medianNs, r->p99Ns, r->meanNs);
+                jsonNumber(f, r->cycles);
+                fputs(",\"cache_misses_per_op\":", f);
+                jsonNumber(f, r->cacheMisses);
+                if (r->gbPerSec >= 0) fprintf(f, ",\"gb_per_s\":%.3f", r->gbPerSec);
+                fputc('}', f);
+            }
+            fputs("],\"metrics\":[", f);
+            for (int i = 0; i < s->metricCount; i++) {
+                if (i) fputc(',', f);
+                fputs("{\"name\":", f);
+                jsonString(f, s->metrics[i].name);
+                fprintf(f, ",\"value\":%.6g,\"unit\":", s->metrics[i].value);
+                jsonString(f, s->metrics[i].unit);
+                fputc('}', f);
+            }
+            fputs("]}\n", f);
+            if (!toStdout) fclose(f);
+        }
+    }
+#ifdef __linux__
+    if (s->perfMissFd >= 0) close(s->perfMissFd);
+    if (s->perfFd >= 0) close(s->perfFd);
+#endif
+    free(s);
+    return 0;
+}
+
+/* ---- stdout redirection for report paths ---- */
+
+int benchMuteStdout(void) {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull >= 0) {
+        dup2(devnull, STDOUT_FILENO);
+        close(devnull);
+    }
+    return saved;
+}
+
+void benchUnmuteStdout(int savedFd) {
+    fflush(stdout);
+    if (savedFd >= 0) {
+        dup2(savedFd, STDOUT_FILENO);
+        close(savedFd);
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef PFTHEORY_BENCH_H
+#define PFTHEORY_BENCH_H
+
+#include <stddef.h>
+
+/* ---- Minimal benchmark harness shared by every suite in bench/ ----
+ *
+ * A suite opens a BenchSuite, runs a number of BenchCase entries and closes
+ * it. Each case is warmed up, then repeated; every repetition times 'iters'
+ * operations and the per-operation times are summarised as min / median /
+ * p99. Where perf_event_open is permitted, CPU cycles and cache misses per
+ * operation are reported too. Cases that set bytesPerOp also get a GB/s
+ * figure, computed from the median.
+ *
+ * Command line understood by benchOpen():
+ *   --reps N       timed repetitions per case (default 15)
+ *   --warmup N     untimed warm-up repetitions (default 2)
+ *   --scale X      multiply every case's problem size by X (default 1)
+ *   --filter STR   only run cases whose name contains STR
+ *   --json FILE    append one JSON object per suite to FILE ("-" = stdout)
+ */
+
+typedef struct {
+    const char *name;
+    void (*setup)(void *ctx);              /* untimed, before every repetition (may be NULL) */
+    void (*run)(void *ctx, long long iters);
+    void (*teardown)(void *ctx);           /* untimed, after every repetition (may be NULL) */
+    void *ctx;
+    long long iters;                       /* operations per repetition */
+    double bytesPerOp;                     /* > 0: also report throughput in GB/s */
+} BenchCase;
+
+typedef struct BenchSuite BenchSuite;
+
+BenchSuite *benchOpen(const char *suiteName, int argc, char **argv);
+void benchRun(BenchSuite *suite, const BenchCase *bc);
+/* finish the suite, write JSON if requested; returns the process exit code */
+int benchClose(BenchSuite *suite);
+
+/* A single measured value that is not a timing (memory per edit, ratios,
+ * ...): printed with the results and written to the JSON "metrics" list */
+void benchMetric(BenchSuite *suite, const char *name, double value, const char *unit);
+
+/* itemsPerOp over the median time of a case already run, as the metric
+ * "<case>/rate" in 'unit' (such as rows/s); nothing if it was filtered out */
+void benchRate(BenchSuite *suite, const char *caseName, double itemsPerOp, const char *unit);
+
+/* problem-size multiplier from --scale, for suites that size their data up front */
+double benchScale(const BenchSuite *suite);
+long long benchScaled(const BenchSuite *suite, long long n);
+
+/* redirect stdout to /dev/null around report benchmarks */
+int benchMuteStdout(void);
+void benchUnmuteStdout(int savedFd);
+
+/* monotonic clock in nanoseconds */
+long long benchNow(void);
+
+/* keep the compiler from discarding a computed value */
+static inline void benchKeep(const void *p) {
+    __asm__ __volatile__("" : : "r"(p) : "memory");
+}
+
+/* deterministic xorshift generator so every run sees the same workload */
+static inline unsigned long long benchRand(unsigned long long *state) {
+    unsigned long long x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+#endif
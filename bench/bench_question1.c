@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "bench.h"
+#include "question1.h"
+#include "loanschedule.h"
+
+/* question1: recursive repayment schedule (printing muted) */
+
+typedef struct {
+    int years;
+    int savedStdout;
+    double total;
+} RepayCtx;
+
+static void muteSetup(void *p) {
+    ((RepayCtx *) p)->savedStdout = benchMuteStdout();
+}
+
+static void muteTeardown(void *p) {
+    benchUnmuteStdout(((RepayCtx *) p)->savedStdout);
+}
+
+static void runRepayment(void *p, long long iters) {
+    RepayCtx *c = (RepayCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        c->total += calculateRepayment(100000 + (double) (i & 1023), 0.05, c->years, 9000);
+    }
+    benchKeep(&c->total);
+}
+
+/* what-if questions on a portfolio of 30-year monthly loans that reset to a
+ * higher rate after five years: each op asks one question (a prepayment or
+ * a rate change in a random month of a random loan) and takes it back, two
+ * answers (total paid, months to payoff) per op */
+
+#define MONTHS 360
+#define RESET 61
+
+typedef struct {
+    int loans;
+    struct LoanSchedule **sched;
+    double *loan, *installment;
+    double *rate, *extra;       /* per month, for the full recompute */
+    unsigned long long seed;
+    int savedStdout;
+    double sink;
+} WhatIfCtx;
+
+/* a random month that is not the reset */
+static int whatIfMonth(WhatIfCtx *c) {
+    int k = 1 + (int) (benchRand(&c->seed) % (MONTHS - 1));
+    return k >= RESET ? k + 1 : k;
+}
+
+static void runPrepay(void *p, long long iters) {
+    WhatIfCtx *c = (WhatIfCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        struct LoanSchedule *s = c->sched[benchRand(&c->seed) % (unsigned long long) c->loans];
+        int k = whatIfMonth(c);
+        schedulePrepay(s, k, 1000 + (double) (benchRand(&c->seed) % 50000));
+        c->sink += scheduleTotalPaid(s) + schedulePeriodsRun(s);
+        schedulePrepay(s, k, 0);
+        c->sink += scheduleTotalPaid(s) + schedulePeriodsRun(s);
+    }
+    benchKeep(&c->sink);
+}
+
+static void runRate(void *p, long long iters) {
+    WhatIfCtx *c = (WhatIfCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        struct LoanSchedule *s = c->sched[benchRand(&c->seed) % (unsigned long long) c->loans];
+        int k = whatIfMonth(c);
+        scheduleSetRate(s, k, (double) (benchRand(&c->seed) % 1000) / 120000);
+        c->sink += scheduleTotalPaid(s) + schedulePeriodsRun(s);
+        scheduleClearRate(s, k);
+        c->sink += scheduleTotalPaid(s) + schedulePeriodsRun(s);
+    }
+    benchKeep(&c->sink);
+}
+
+/* baseline: every answer runs the loan month by month from the first */
+static void fullAnswer(WhatIfCtx *c, int loan) {
+    const double *rate = c->rate + (size_t) loan * (MONTHS + 1);
+    const double *extra = c->extra + (size_t) loan * (MONTHS + 1);
+    double b = c->loan[loan], paid = 0;
+    int run = 0;
+    for (int m = 1; m <= MONTHS && b > 0; m++) {
+        b = b + b * rate[m];
+        b -= c->installment[loan] + extra[m];
+        paid += c->installment[loan] + extra[m];
+        run++;
+    }
+    c->sink += paid + run;
+}
+
+static void runPrepayFull(void *p, long long iters) {
+    WhatIfCtx *c = (WhatIfCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        int loan = (int) (benchRand(&c->seed) % (unsigned long long) c->loans);
+        double *extra = c->extra + (size_t) loan * (MONTHS + 1);
+        int k = whatIfMonth(c);
+        extra[k] = 1000 + (double) (benchRand(&c->seed) % 50000);
+        fullAnswer(c, loan);
+        extra[k] = 0;
+        fullAnswer(c, loan);
+    }
+    benchKeep(&c->sink);
+}
+
+static void runRateFull(void *p, long long iters) {
+    WhatIfCtx *c = (WhatIfCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        int loan = (int) (benchRand(&c->seed) % (unsigned long long) c->loans);
+        double *rate = c->rate + (size_t) loan * (MONTHS + 1);
+        int k = whatIfMonth(c), end = k < RESET ? RESET : MONTHS + 1;
+        double r = (double) (benchRand(&c->seed) % 1000) / 120000, old = rate[k];
+        for (int m = k; m < end; m++) rate[m] = r;
+        fullAnswer(c, loan);
+        for (int m = k; m < end; m++) rate[m] = old;
+        fullAnswer(c, loan);
+    }
+    benchKeep(&c->sink);
+}
+
+/* the original: calculateRepayment over all 360 months, printing muted */
+static void runWhatIfRecursion(void *p, long long iters) {
+    WhatIfCtx *c = (WhatIfCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        int loan = (int) (benchRand(&c->seed) % (unsigned long long) c->loans);
+        const double *rate = c->rate + (size_t) loan * (MONTHS + 1);
+        c->sink += calculateRepayment(c->loan[loan], rate[1], MONTHS, c->installment[loan]);
+        c->sink += calculateRepayment(c->loan[loan], rate[1], MONTHS, c->installment[loan]);
+    }
+    benchKeep(&c->sink);
+}
+
+static void whatIfMute(void *p) {
+    ((WhatIfCtx *) p)->savedStdout = benchMuteStdout();
+}
+
+static void whatIfUnmute(void *p) {
+    benchUnmuteStdout(((WhatIfCtx *) p)->savedStdout);
+}
+
+static void buildPortfolio(WhatIfCtx *c) {
+    unsigned long long seed = 0x9e3779b97f4a7c15ULL;
+    size_t n = (size_t) c->loans;
+    c->sched = (struct LoanSchedule **) malloc(n * sizeof(*c->sched));
+    c->loan = (double *) malloc(n * sizeof(double));
+    c->installment = (double *) malloc(n * sizeof(double));
+    c->rate = (double *) malloc(n * (MONTHS + 1) * sizeof(double));
+    c->extra = (double *) calloc(n * (MONTHS + 1), sizeof(double));
+    if (!c->sched || !c->loan || !c->installment || !c->rate || !c->extra) {
+        perror("malloc failed");
+        exit(1);
+    }
+    for (size_t i = 0; i < n; i++) {
+        double loan = 50000 + (double) (benchRand(&seed) % 450000);
+        double r = (300 + (double) (benchRand(&seed) % 500)) / 120000;    /* 3%..8% a year */
+        double reset = r + (double) (benchRand(&seed) % 300) / 120000;
+        double pay = loan * r / (1 - pow(1 + r, -MONTHS));
+        c->loan[i] = loan;
+        c->installment[i] = pay;
+        c->sched[i] = scheduleCreate(loan, r, MONTHS, pay);
+        scheduleSetRate(c->sched[i], RESET, reset);
+        scheduleTotalPaid(c->sched[i]);
+        double *rate = c->rate + i * (MONTHS + 1);
+        for (int m = 1; m <= MONTHS; m++) rate[m] = m < RESET ? r : reset;
+    }
+}
+
+static void freePortfolio(WhatIfCtx *c) {
+    for (int i = 0; i < c->loans; i++) scheduleFree(c->sched[i]);
+    free(c->sched);
+    free(c->loan);
+    free(c->installment);
+    free(c->rate);
+    free(c->extra);
+}
+
+int main(int argc, char **argv) {
+    BenchSuite *suite = benchOpen("question1", argc, argv);
+    RepayCtx shortLoan = {3, -1, 0}, longLoan = {30, -1, 0};
+    WhatIfCtx whatIf = {0};
+    whatIf.loans = (int) benchScaled(suite, 20000);
+    whatIf.seed = 42;
+    buildPortfolio(&whatIf);
+
+    BenchCase cases[] = {
+        {"repayment/3y", muteSetup, runRepayment, muteTeardown, &shortLoan, benchScaled(suite, 20000)},
+        {"repayment/30y", muteSetup, runRepayment, muteTeardown, &longLoan, benchScaled(suite, 2000)},
+        {"whatif/prepay", NULL, runPrepay, NULL, &whatIf, 200000},
+        {"whatif/prepay/full", NULL, runPrepayFull, NULL, &whatIf, 20000},
+        {"whatif/rate", NULL, runRate, NULL, &whatIf, 200000},
+        {"whatif/rate/full", NULL, runRateFull, NULL, &whatIf, 20000},
+        {"whatif/recursion", whatIfMute, runWhatIfRecursion, whatIfUnmute, &whatIf, 200},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) benchRun(suite, &cases[i]);
+    benchRate(suite, "whatif/prepay", 2, "answers/s");
+    benchRate(suite, "whatif/prepay/full", 2, "answers/s");
+    benchRate(suite, "whatif/rate", 2, "answers/s");
+    benchRate(suite, "whatif/rate/full", 2, "answers/s");
+    benchRate(suite, "whatif/recursion", 2, "answers/s");
+    freePortfolio(&whatIf);
+    return benchClose(suite);
+}
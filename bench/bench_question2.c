@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "question2.h"
+
+/* question2: mission simulation, batch sweep and frontier search */
+
+typedef struct {
+    MissionConfig *cfgs;
+    MissionResult *results;
+    size_t count;
+    size_t stride;   /* sampling stride for the O(route) iterative loop */
+    FILE *devnull;
+} SweepCtx;
+
+typedef struct {
+    MissionConfig base;
+    FuelFrontier fr;
+    int threads;
+} FrontierCtx;
+
+static void buildSweep(MissionConfig *cfgs, size_t count) {
+    /* Walk a 5-dimensional grid in mixed radix so every dimension varies */
+    for (size_t i = 0; i < count; i++) {
+        size_t x = i;
+        cfgs[i].fuel = 100 + (int) (x % 64) * 50;      x /= 64;
+        cfgs[i].consumption = 10 + (int) (x % 32) * 5; x /= 32;
+        cfgs[i].recharge = (int) (x % 32) * 5;         x /= 32;
+        cfgs[i].solarBonus = (int) (x % 16) * 10;      x /= 16;
+        cfgs[i].totalPlanets = 10 + (int) (x % 64) * 1000;
+    }
+}
+
+static void runClosedForm(void *p, long long iters) {
+    SweepCtx *c = (SweepCtx *) p;
+    for (long long done = 0; done < iters; done += (long long) c->count) {
+        size_t n = (size_t) (iters - done) < c->count ? (size_t) (iters - done) : c->count;
+        simulateBatch(c->cfgs, c->results, n);
+    }
+    benchKeep(c->results);
+}
+
+static void runIterative(void *p, long long iters) {
+    SweepCtx *c = (SweepCtx *) p;
+    long long sum = 0;
+    for (long long i = 0; i < iters; i++) {
+        sum += simulateMission(&c->cfgs[((size_t) i * c->stride) % c->count], NULL).finalFuel;
+    }
+    benchKeep(&sum);
+}
+
+static void runTraced(void *p, long long iters) {
+    SweepCtx *c = (SweepCtx *) p;
+    TraceSink sink;
+    traceInit(&sink, c->devnull, 1 << 16);
+    for (long long i = 0; i < iters; i++) {
+        simulateMission(&c->cfgs[((size_t) i * c->stride) % c->count], &sink);
+    }
+    traceFree(&sink);
+}
+
+static void runFrontier(void *p, long long iters) {
+    FrontierCtx *c = (FrontierCtx *) p;
+    for (long long i = 0; i < iters; i++) searchFrontier(&c->base, &c->fr, c->threads);
+    benchKeep(c->fr.minFuel);
+}
+
+static void initFrontier(FrontierCtx *c, int rows, int threads) {
+    /* Every row has a distinct answer, so no band collapses for free */
+    c->base.fuel = 0;
+    c->base.consumption = rows;
+    c->base.recharge = 0;
+    c->base.solarBonus = 7;
+    c->base.totalPlanets = 1000;
+    c->fr.rechargeMin = 0;
+    c->fr.rechargeMax = rows - 1;
+    c->fr.fuelMin = 1;
+    c->fr.fuelMax = 2000000000;
+    c->fr.minFuel = (int *) malloc((size_t) rows * sizeof(int));
+    c->threads = threads;
+    if (!c->fr.minFuel) {
+        perror("malloc failed");
+        exit(1);
+    }
+}
+
+int main(int argc, char **argv) {
+    BenchSuite *suite = benchOpen("question2", argc, argv);
+
+    SweepCtx sweep;
+    sweep.count = (size_t) benchScaled(suite, 1 << 20);
+    sweep.stride = sweep.count / 4096 + 1;
+    sweep.cfgs = (MissionConfig *) malloc(sweep.count * sizeof(MissionConfig));
+    sweep.results = (MissionResult *) malloc(sweep.count * sizeof(MissionResult));
+    sweep.devnull = fopen("/dev/null", "w");
+    if (!sweep.cfgs || !sweep.results || !sweep.devnull) {
+        perror("bench setup failed");
+        return 1;
+    }
+    buildSweep(sweep.cfgs, sweep.count);
+
+    FrontierCtx frontier1, frontier4;
+    int rows = (int) benchScaled(suite, 200000);
+    initFrontier(&frontier1, rows, 1);
+    initFrontier(&frontier4, rows, 4);
+
+    BenchCase cases[] = {
+        {"sweep/closed-form", NULL, runClosedForm, NULL, &sweep, (long long) sweep.count},
+        {"sweep/iterative", NULL, runIterative, NULL, &sweep, 4096},
+        {"sweep/iterative-traced", NULL, runTraced, NULL, &sweep, 256},
+        {"frontier/1-thread", NULL, runFrontier, NULL, &frontier1, 1},
+        {"frontier/4-threads", NULL, runFrontier, NULL, &frontier4, 1},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) benchRun(suite, &cases[i]);
+
+    free(sweep.cfgs);
+    free(sweep.results);
+    fclose(sweep.devnull);
+    free(frontier1.fr.minFuel);
+    free(frontier4.fr.minFuel);
+    return benchClose(suite);
+}
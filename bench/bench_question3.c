@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "question3.h"
+#include "empstream.h"
+
+/* question3: employee report, highest-salary scan and bonus pass */
+
+typedef struct {
+    struct Employee *emp;
+    struct Employee *pristine;
+    int n;
+    int savedStdout;
+    EmployeeStore staff;
+    unsigned long long seed;
+} EmpCtx;
+
+static void muteSetup(void *p) {
+    ((EmpCtx *) p)->savedStdout = benchMuteStdout();
+}
+
+static void muteTeardown(void *p) {
+    benchUnmuteStdout(((EmpCtx *) p)->savedStdout);
+}
+
+static void resetSalaries(void *p) {
+    EmpCtx *c = (EmpCtx *) p;
+    memcpy(c->emp, c->pristine, (size_t) c->n * sizeof(struct Employee));
+}
+
+static void runDisplay(void *p, long long iters) {
+    EmpCtx *c = (EmpCtx *) p;
+    for (long long i = 0; i < iters; i++) displayEmployees(c->emp, c->n);
+}
+
+/* the per-row printf displayEmployees used before the buffered output */
+static void runDisplayPrintf(void *p, long long iters) {
+    EmpCtx *c = (EmpCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        for (int j = 0; j < c->n; j++)
+            printf("%-10d %-20s %-20s %-10.2f\n",
+                   c->emp[j].id, c->emp[j].name, c->emp[j].designation, c->emp[j].salary);
+        fflush(stdout);
+    }
+}
+
+static void runHighest(void *p, long long iters) {
+    EmpCtx *c = (EmpCtx *) p;
+    for (long long i = 0; i < iters; i++) findHighestSalary(c->emp, c->n);
+}
+
+static void runBonus(void *p, long long iters) {
+    EmpCtx *c = (EmpCtx *) p;
+    int saved = benchMuteStdout();
+    for (long long i = 0; i < iters; i++) giveBonus(c->emp, c->n, 50000);
+    benchUnmuteStdout(saved);
+}
+
+/* ---- ID lookups: the store's index against the scan it replaced ---- */
+
+static void buildStaff(void *p) {
+    EmpCtx *c = (EmpCtx *) p;
+    employeeStoreFree(&c->staff);
+    employeeStorePushMany(&c->staff, c->pristine, (size_t) c->n);
+}
+
+static void runFindId(void *p, long long iters) {
+    EmpCtx *c = (EmpCtx *) p;
+    size_t sum = 0;
+    for (long long i = 0; i < iters; i++)
+        sum += employeeStoreFind(&c->staff, (int) (benchRand(&c->seed) % (unsigned long long) c->n) + 1);
+    benchKeep(&sum);
+}
+
+static void runFindIdLinear(void *p, long long iters) {
+    EmpCtx *c = (EmpCtx *) p;
+    size_t sum = 0;
+    for (long long i = 0; i < iters; i++) {
+        int id = (int) (benchRand(&c->seed) % (unsigned long long) c->n) + 1;
+        for (int j = 0; j < c->n; j++)
+            if (c->emp[j].id == id) {
+                sum += (size_t) j;
+                break;
+            }
+    }
+    benchKeep(&sum);
+}
+
+/* per build of the whole store */
+static void runPush(void *p, long long iters) {
+    EmpCtx *c = (EmpCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        employeeStoreFree(&c->staff);
+        for (int j = 0; j < c->n; j++) employeeStorePush(&c->staff, &c->pristine[j]);
+    }
+}
+
+static void runPushMany(void *p, long long iters) {
+    EmpCtx *c = (EmpCtx *) p;
+    for (long long i = 0; i < iters; i++) buildStaff(c);
+}
+
+/* ---- streaming passes over employee files ---- */
+
+typedef struct {
+    char binPath[64];
+    char csvPath[64];
+    long long records;
+    double binBytes, csvBytes;
+    struct StreamOptions scan, bonus;
+    struct StreamStats last;
+} StreamCtx;
+
+static void employeeAt(long long i, struct Employee *e) {
+    unsigned long long seed = 0x9e3779b97f4a7c15ULL ^ (unsigned long long) i;
+    memset(e, 0, sizeof(*e));
+    e->id = (int) (i + 1);
+    snprintf(e->name, sizeof(e->name), "emp%lld", i);
+    snprintf(e->designation, sizeof(e->designation), "grade%lld", i % 7);
+    e->salary = (float) (20000 + benchRand(&seed) % 80000);
+}
+
+static void writeBinary(void *p) {
+    StreamCtx *c = (StreamCtx *) p;
+    FILE *f = fopen(c->binPath, "wb");
+    struct EmpFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, EMP_FILE_MAGIC, sizeof(h.magic));
+    h.recordSize = (int) sizeof(struct Employee);
+    if (!f || fwrite(&h, sizeof(h), 1, f) != 1) {
+        perror("cannot write the employee file");
+        exit(1);
+    }
+    for (long long i = 0; i < c->records; i++) {
+        struct Employee e;
+        employeeAt(i, &e);
+        fwrite(&e, sizeof(e), 1, f);
+    }
+    c->binBytes = (double) ftell(f);
+    fclose(f);
+}
+
+static void writeCsv(void *p) {
+    StreamCtx *c = (StreamCtx *) p;
+    FILE *f = fopen(c->csvPath, "w");
+    if (!f) {
+        perror("cannot write the employee file");
+        exit(1);
+    }
+    fprintf(f, "id,name,designation,salary\n");
+    for (long long i = 0; i < c->records; i++) {
+        struct Employee e;
+        employeeAt(i, &e);
+        fprintf(f, "%d,%s,%s,%.2f\n", e.id, e.name, e.designation, e.salary);
+    }
+    c->csvBytes = (double) ftell(f);
+    fclose(f);
+}
+
+static void runStream(StreamCtx *c, const char *path, const struct StreamOptions *opt, long long iters) {
+    for (long long i = 0; i < iters; i++)
+        if (streamEmployees(path, opt, &c->last) != 0) exit(1);
+}
+
+static void runBinaryScan(void *p, long long iters) {
+    StreamCtx *c = (StreamCtx *) p;
+    runStream(c, c->binPath, &c->scan, iters);
+}
+
+static void runBinaryBonus(void *p, long long iters) {
+    StreamCtx *c = (StreamCtx *) p;
+    runStream(c, c->binPath, &c->bonus, iters);
+}
+
+static void runCsvScan(void *p, long long iters) {
+    StreamCtx *c = (StreamCtx *) p;
+    runStream(c, c->csvPath, &c->scan, iters);
+}
+
+static void runCsvBonus(void *p, long long iters) {
+    StreamCtx *c = (StreamCtx *) p;
+    runStream(c, c->csvPath, &c->bonus, iters);
+}
+
+int main(int argc, char **argv) {
+    BenchSuite *suite = benchOpen("question3", argc, argv);
+    EmpCtx ctx;
+    unsigned long long seed = 0x9e3779b97f4a7c15ULL;
+
+    employeeStoreInit(&ctx.staff);
+    ctx.seed = seed;
+    ctx.n = (int) benchScaled(suite, 100000);
+    ctx.emp = (struct Employee *) malloc((size_t) ctx.n * sizeof(struct Employee));
+    ctx.pristine = (struct Employee *) malloc((size_t) ctx.n * sizeof(struct Employee));
+    if (!ctx.emp || !ctx.pristine) {
+        perror("malloc failed");
+        return 1;
+    }
+    for (int i = 0; i < ctx.n; i++) {
+        ctx.pristine[i].id = i + 1;
+        snprintf(ctx.pristine[i].name, sizeof(ctx.pristine[i].name), "emp%d", i);
+        snprintf(ctx.pristine[i].designation, sizeof(ctx.pristine[i].designation), "grade%d", i % 7);
+        ctx.pristine[i].salary = (float) (20000 + benchRand(&seed) % 80000);
+    }
+    resetSalaries(&ctx);
+
+    /* per-op time below is per report / pass over all employees, per
+     * lookup for findById */
+    BenchCase cases[] = {
+        {"displayEmployees", muteSetup, runDisplay, muteTeardown, &ctx, 5},
+        {"displayEmployees/printf", muteSetup, runDisplayPrintf, muteTeardown, &ctx, 5},
+        {"findHighestSalary", muteSetup, runHighest, muteTeardown, &ctx, 50},
+        {"giveBonus", resetSalaries, runBonus, NULL, &ctx, 1},
+        {"findById", buildStaff, runFindId, NULL, &ctx, 100000},
+        {"findById/linear", resetSalaries, runFindIdLinear, NULL, &ctx, 200},
+        {"store/push", NULL, runPush, NULL, &ctx, 1},
+        {"store/pushMany", NULL, runPushMany, NULL, &ctx, 1},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) benchRun(suite, &cases[i]);
+    benchRate(suite, "displayEmployees", ctx.n, "rows/s");
+    benchRate(suite, "displayEmployees/printf", ctx.n, "rows/s");
+    employeeStoreFree(&ctx.staff);
+
+    /* 4M employees by default (412 MB binary); raise --scale to go past RAM,
+     * peak RSS should not move */
+    StreamCtx st;
+    memset(&st, 0, sizeof(st));
+    st.records = benchScaled(suite, 4000000);
+    snprintf(st.binPath, sizeof(st.binPath), "bench_q3_%d.emp", (int) getpid());
+    snprintf(st.csvPath, sizeof(st.csvPath), "bench_q3_%d.csv", (int) getpid());
+    st.bonus.applyBonus = 1;
+    st.bonus.threshold = 50000;
+    writeBinary(&st);
+    writeCsv(&st);
+    /* per-op time is one pass over the whole file */
+    BenchCase streamCases[] = {
+        {"stream/binary", NULL, runBinaryScan, NULL, &st, 1, st.binBytes},
+        {"stream/binary+bonus", writeBinary, runBinaryBonus, NULL, &st, 1, st.binBytes},
+        {"stream/csv", NULL, runCsvScan, NULL, &st, 1, st.csvBytes},
+        {"stream/csv+bonus", writeCsv, runCsvBonus, NULL, &st, 1, st.csvBytes},
+    };
+    double rate[4];
+    for (size_t i = 0; i < sizeof(streamCases) / sizeof(streamCases[0]); i++) {
+        benchRun(suite, &streamCases[i]);
+        rate[i] = (double) st.last.records / st.last.seconds;
+    }
+    benchMetric(suite, "stream/binary-records-per-sec", rate[0], "rec/s");
+    benchMetric(suite, "stream/binary+bonus-records-per-sec", rate[1], "rec/s");
+    benchMetric(suite, "stream/csv-records-per-sec", rate[2], "rec/s");
+    benchMetric(suite, "stream/csv+bonus-records-per-sec", rate[3], "rec/s");
+    benchMetric(suite, "stream/binary-file", st.binBytes / (1 << 20), "MB");
+    benchMetric(suite, "stream/peak-rss", (double) st.last.peakRssKb / 1024, "MB");
+    remove(st.binPath);
+    remove(st.csvPath);
+
+    free(ctx.emp);
+    free(ctx.pristine);
+    return benchClose(suite);
+}
@@ -0,0 +1,460 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "bench.h"
+#include "question4.h"
+#include "timerwheel.h"
+
+/* question4: shelf cache operations (ADD / ACCESS, with LRA eviction) */
+
+typedef struct {
+    struct Shelf shelf;
+    int capacity;
+    int keySpace;      /* ids are drawn from [0, keySpace) */
+    int *keys;         /* pre-generated skewed key stream */
+    int *ops;          /* 0 = ADD, 1 = ACCESS */
+    long long streamLen;
+} ShelfCtx;
+
+static void resetShelf(void *p) {
+    ShelfCtx *c = (ShelfCtx *) p;
+    shelfFree(&c->shelf);
+    shelfInit(&c->shelf, c->capacity);
+    /* start full so every miss exercises eviction */
+    for (int i = 0; i < c->capacity; i++) shelfAdd(&c->shelf, c->keySpace + i, i);
+}
+
+static void runMixed(void *p, long long iters) {
+    ShelfCtx *c = (ShelfCtx *) p;
+    long long sum = 0;
+    for (long long i = 0; i < iters; i++) {
+        long long k = i % c->streamLen;
+        if (c->ops[k] == 0) shelfAdd(&c->shelf, c->keys[k], (int) i);
+        else sum += shelfAccess(&c->shelf, c->keys[k]);
+    }
+    benchKeep(&sum);
+}
+
+static void runAccessOnly(void *p, long long iters) {
+    ShelfCtx *c = (ShelfCtx *) p;
+    long long sum = 0;
+    for (long long i = 0; i < iters; i++) sum += shelfAccess(&c->shelf, c->keys[i % c->streamLen]);
+    benchKeep(&sum);
+}
+
+static void runAddOnly(void *p, long long iters) {
+    ShelfCtx *c = (ShelfCtx *) p;
+    for (long long i = 0; i < iters; i++) shelfAdd(&c->shelf, c->keys[i % c->streamLen], (int) i);
+}
+
+static void initCtx(ShelfCtx *c, int capacity, long long streamLen) {
+    unsigned long long seed = 88172645463325252ULL;
+    c->capacity = capacity;
+    c->keySpace = capacity * 4;
+    c->streamLen = streamLen;
+    c->keys = (int *) malloc((size_t) streamLen * sizeof(int));
+    c->ops = (int *) malloc((size_t) streamLen * sizeof(int));
+    if (!c->keys || !c->ops) {
+        perror("malloc failed");
+        exit(1);
+    }
+    for (long long i = 0; i < streamLen; i++) {
+        /* 80% of the traffic goes to the hottest 20% of the key space */
+        unsigned long long r = benchRand(&seed);
+        int hot = (r % 100) < 80;
+        int range = hot ? c->keySpace / 5 : c->keySpace;
+        c->keys[i] = (int) ((r >> 8) % (unsigned long long) (range > 0 ? range : 1));
+        c->ops[i] = (int) ((r >> 40) % 10) < 3 ? 0 : 1;   /* 30% ADD, 70% ACCESS */
+    }
+    shelfInit(&c->shelf, capacity);
+}
+
+static void freeCtx(ShelfCtx *c) {
+    shelfFree(&c->shelf);
+    free(c->keys);
+    free(c->ops);
+}
+
+/* ---- warm-start snapshots of a large shelf ---- */
+
+typedef struct {
+    struct Shelf shelf;
+    int capacity;
+    char path[64];
+} SnapCtx;
+
+static void fillLarge(void *p) {
+    SnapCtx *c = (SnapCtx *) p;
+    shelfFree(&c->shelf);
+    shelfInit(&c->shelf, c->capacity);
+    for (int i = 0; i < c->capacity; i++) {
+        c->shelf.books[i].id = i;
+        c->shelf.books[i].pop = i;
+        c->shelf.books[i].lastAccess = c->shelf.timeCounter++;
+    }
+}
+
+static void saveLarge(void *p) {
+    SnapCtx *c = (SnapCtx *) p;
+    fillLarge(c);
+    shelfSave(&c->shelf, c->path);
+    shelfFree(&c->shelf);
+}
+
+static void waitSave(void *p) {
+    (void) p;
+    shelfSaveFinish(1);
+}
+
+static void runSave(void *p, long long iters) {
+    SnapCtx *c = (SnapCtx *) p;
+    for (long long i = 0; i < iters; i++) shelfSave(&c->shelf, c->path);
+}
+
+/* time until the caller can go on; the child's write is not timed */
+static void runSaveBackground(void *p, long long iters) {
+    SnapCtx *c = (SnapCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        shelfSaveFinish(1);
+        shelfSaveBackground(&c->shelf, c->path);
+    }
+}
+
+static void runColdInit(void *p, long long iters) {
+    SnapCtx *c = (SnapCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        shelfFree(&c->shelf);
+        shelfInit(&c->shelf, c->capacity);
+    }
+}
+
+static void runRestore(void *p, long long iters) {
+    SnapCtx *c = (SnapCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        shelfFree(&c->shelf);
+        shelfRestore(&c->shelf, c->capacity, c->path);
+    }
+}
+
+/* restore, then one miss: the first lookup reads every page of the snapshot */
+static void runRestoreScan(void *p, long long iters) {
+    SnapCtx *c = (SnapCtx *) p;
+    long long sum = 0;
+    for (long long i = 0; i < iters; i++) {
+        shelfFree(&c->shelf);
+        shelfRestore(&c->shelf, c->capacity, c->path);
+        sum += shelfAccess(&c->shelf, -2);
+    }
+    benchKeep(&sum);
+}
+
+/* ACCESS hit rate over ops [from, from + n) of the stream */
+static double hitRate(ShelfCtx *c, struct Shelf *s, long long from, long long n) {
+    long long hits = 0, accesses = 0;
+    for (long long i = from; i < from + n; i++) {
+        long long k = i % c->streamLen;
+        if (c->ops[k] == 0) {
+            shelfAdd(s, c->keys[k], (int) i);
+        } else {
+            accesses++;
+            hits += shelfAccess(s, c->keys[k]) != -1;
+        }
+    }
+    return accesses ? (double) hits / (double) accesses : 0;
+}
+
+#define RECOVERY_WARMUP 200000
+#define RECOVERY_WINDOW 5000
+#define RECOVERY_WINDOWS 40
+
+/* Run the workload, snapshot, "restart" once cold and once from the
+ * snapshot, and follow the hit rate window by window after the restart */
+static void measureRecovery(BenchSuite *suite, ShelfCtx *c, const char *path) {
+    struct Shelf steady, cold, warm;
+    shelfInit(&steady, c->capacity);
+    hitRate(c, &steady, 0, RECOVERY_WARMUP);
+    shelfSave(&steady, path);
+    shelfInit(&cold, c->capacity);
+    shelfRestore(&warm, c->capacity, path);
+
+    double steadySum = 0, coldFirst = 0, warmFirst = 0;
+    long long coldRecovered = -1, warmRecovered = -1;
+    double rates[3][RECOVERY_WINDOWS];
+    for (int w = 0; w < RECOVERY_WINDOWS; w++) {
+        long long from = RECOVERY_WARMUP + (long long) w * RECOVERY_WINDOW;
+        rates[0][w] = hitRate(c, &steady, from, RECOVERY_WINDOW);
+        rates[1][w] = hitRate(c, &cold, from, RECOVERY_WINDOW);
+        rates[2][w] = hitRate(c, &warm, from, RECOVERY_WINDOW);
+        steadySum += rates[0][w];
+    }
+    double steadyRate = steadySum / RECOVERY_WINDOWS;
+    coldFirst = rates[1][0];
+    warmFirst = rates[2][0];
+    for (int w = RECOVERY_WINDOWS - 1; w >= 0; w--) {
+        /* ops until the hit rate stays within 90% of the uninterrupted run */
+        if (coldRecovered < 0 && rates[1][w] < 0.9 * steadyRate) coldRecovered = (long long) (w + 1) * RECOVERY_WINDOW;
+        if (warmRecovered < 0 && rates[2][w] < 0.9 * steadyRate) warmRecovered = (long long) (w + 1) * RECOVERY_WINDOW;
+    }
+    benchMetric(suite, "recovery/steady-hit-rate", 100 * steadyRate, "%");
+    benchMetric(suite, "recovery/cold-first-window", 100 * coldFirst, "%");
+    benchMetric(suite, "recovery/warm-first-window", 100 * warmFirst, "%");
+    benchMetric(suite, "recovery/cold-ops-to-90%", (double) (coldRecovered < 0 ? 0 : coldRecovered), "ops");
+    benchMetric(suite, "recovery/warm-ops-to-90%", (double) (warmRecovered < 0 ? 0 : warmRecovered), "ops");
+    shelfFree(&steady);
+    shelfFree(&cold);
+    shelfFree(&warm);
+    remove(path);
+}
+
+/* ---- RAM shelf over a disk overflow tier ---- */
+
+#define TIER_CAPACITY 4096
+#define TIER_ON_DISK 40000
+
+typedef struct {
+    struct Shelf shelf;
+    char path[64];
+    int withDisk;
+    unsigned long long seed;
+} TierCtx;
+
+/* ids [0, TIER_CAPACITY + TIER_ON_DISK) added in order: the last
+ * TIER_CAPACITY are in RAM, the rest were evicted (to disk, if attached) */
+static void fillTiers(void *p) {
+    TierCtx *c = (TierCtx *) p;
+    shelfFree(&c->shelf);
+    shelfInit(&c->shelf, TIER_CAPACITY);
+    if (c->withDisk) shelfAttachDisk(&c->shelf, c->path);
+    for (int i = 0; i < TIER_CAPACITY + TIER_ON_DISK; i++) shelfAdd(&c->shelf, i, i);
+}
+
+static void runRamHits(void *p, long long iters) {
+    TierCtx *c = (TierCtx *) p;
+    long long sum = 0;
+    for (long long i = 0; i < iters; i++)
+        sum += shelfAccess(&c->shelf, TIER_ON_DISK + (int) (benchRand(&c->seed) % TIER_CAPACITY));
+    benchKeep(&sum);
+}
+
+/* every access finds its book on disk, promotes it and demotes the LRA */
+static void runDiskHits(void *p, long long iters) {
+    TierCtx *c = (TierCtx *) p;
+    long long sum = 0;
+    for (long long i = 0; i < iters; i++) sum += shelfAccess(&c->shelf, (int) i);
+    benchKeep(&sum);
+}
+
+static void runMisses(void *p, long long iters) {
+    TierCtx *c = (TierCtx *) p;
+    long long sum = 0;
+    for (long long i = 0; i < iters; i++) sum += shelfAccess(&c->shelf, -2 - (int) (i & 1023));
+    benchKeep(&sum);
+}
+
+/* the skewed mixed stream with and without the tier: where ACCESS hits */
+static void measureTiers(BenchSuite *suite, ShelfCtx *c, const char *path) {
+    struct Shelf single, tiered;
+    shelfInit(&single, c->capacity);
+    shelfInit(&tiered, c->capacity);
+    shelfAttachDisk(&tiered, path);
+    for (long long i = 0; i < 4 * c->streamLen; i++) {
+        long long k = i % c->streamLen;
+        if (c->ops[k] == 0) {
+            shelfAdd(&single, c->keys[k], (int) i);
+            shelfAdd(&tiered, c->keys[k], (int) i);
+        } else {
+            shelfAccess(&single, c->keys[k]);
+            shelfAccess(&tiered, c->keys[k]);
+        }
+    }
+    double n = (double) (tiered.stats.ramHits + tiered.stats.diskHits + tiered.stats.misses);
+    benchMetric(suite, "tier/ram-hit-rate", 100 * (double) tiered.stats.ramHits / n, "%");
+    benchMetric(suite, "tier/disk-hit-rate", 100 * (double) tiered.stats.diskHits / n, "%");
+    benchMetric(suite, "tier/miss-rate", 100 * (double) tiered.stats.misses / n, "%");
+    benchMetric(suite, "tier/single-tier-miss-rate", 100 * (double) single.stats.misses / n, "%");
+    shelfFree(&single);
+    shelfFree(&tiered);
+}
+
+/* ---- TTL expiry ---- */
+
+/* Mixed TTLs in logical ticks: 5% none, 50% up to 1K, 30% up to 1M, the
+ * rest up to 1G */
+static long long mixedTtl(unsigned long long *seed) {
+    unsigned long long r = benchRand(seed);
+    int kind = (int) (r % 100);
+    r /= 100;
+    if (kind < 5) return 0;
+    if (kind < 55) return 1 + (long long) (r % 1000);
+    if (kind < 85) return 1000 + (long long) (r % 1000000);
+    return 1000000 + (long long) (r % 1000000000);
+}
+
+typedef struct {
+    struct Shelf shelf;
+    int capacity;
+    long long *ttls;   /* one per slot */
+    unsigned long long seed;
+} TtlCtx;
+
+/* a full shelf with TTLs on and no timer set */
+static void fillTtl(void *p) {
+    TtlCtx *c = (TtlCtx *) p;
+    shelfFree(&c->shelf);
+    shelfInit(&c->shelf, c->capacity);
+    for (int i = 0; i < c->capacity; i++) {
+        c->shelf.books[i].id = i;
+        c->shelf.books[i].pop = i;
+        c->shelf.books[i].lastAccess = c->shelf.timeCounter++;
+    }
+    shelfEnableTtl(&c->shelf, 0, 0);
+}
+
+/* every book with its TTL running */
+static void armTtl(void *p) {
+    TtlCtx *c = (TtlCtx *) p;
+    fillTtl(c);
+    long long now = c->shelf.timeCounter;
+    for (int i = 0; i < c->capacity; i++)
+        if (c->ttls[i]) wheelSet(c->shelf.ttl, i, now + c->ttls[i]);
+}
+
+static void runArm(void *p, long long iters) {
+    TtlCtx *c = (TtlCtx *) p;
+    long long now = c->shelf.timeCounter;
+    for (long long i = 0; i < iters; i++) {
+        int slot = (int) (i % c->capacity);
+        wheelSet(c->shelf.ttl, slot, c->ttls[slot] ? now + c->ttls[slot] : 0);
+    }
+}
+
+/* an ADD over a book that has a timer: cancel it and set a new one */
+static void runRearm(void *p, long long iters) {
+    TtlCtx *c = (TtlCtx *) p;
+    long long now = c->shelf.timeCounter;
+    for (long long i = 0; i < iters; i++) {
+        int slot = (int) (benchRand(&c->seed) % (unsigned long long) c->capacity);
+        wheelSet(c->shelf.ttl, slot, now + 1 + c->ttls[(slot + 1) % c->capacity]);
+    }
+}
+
+/* what every shelf operation adds: one tick of the clock and its expiries */
+static void runTick(void *p, long long iters) {
+    TtlCtx *c = (TtlCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        c->shelf.timeCounter++;
+        shelfExpireDue(&c->shelf);
+    }
+    benchKeep(&c->shelf.expired);
+}
+
+/* the clock jumps past every deadline at once (a wall clock after a stall) */
+static void runExpireAll(void *p, long long iters) {
+    TtlCtx *c = (TtlCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        c->shelf.timeCounter = 2000000000;
+        shelfExpireDue(&c->shelf);
+    }
+    benchKeep(&c->shelf.expired);
+}
+
+static void resetShelfTtl(void *p) {
+    ShelfCtx *c = (ShelfCtx *) p;
+    resetShelf(c);
+    shelfEnableTtl(&c->shelf, 0, 0);
+}
+
+/* runMixed with a mixed TTL on every ADD */
+static void runMixedTtl(void *p, long long iters) {
+    ShelfCtx *c = (ShelfCtx *) p;
+    unsigned long long seed = 11;
+    long long sum = 0;
+    for (long long i = 0; i < iters; i++) {
+        long long k = i % c->streamLen;
+        if (c->ops[k] == 0) shelfAddTtl(&c->shelf, c->keys[k], (int) i, mixedTtl(&seed));
+        else sum += shelfAccess(&c->shelf, c->keys[k]);
+    }
+    benchKeep(&sum);
+}
+
+int main(int argc, char **argv) {
+    BenchSuite *suite = benchOpen("question4", argc, argv);
+    ShelfCtx small, large;
+    initCtx(&small, 64, 1 << 16);
+    initCtx(&large, (int) benchScaled(suite, 4096), 1 << 16);
+
+    BenchCase cases[] = {
+        {"mixed/cap64", resetShelf, runMixed, NULL, &small, 200000},
+        {"access/cap64", resetShelf, runAccessOnly, NULL, &small, 200000},
+        {"add/cap64", resetShelf, runAddOnly, NULL, &small, 200000},
+        {"mixed/cap4096", resetShelf, runMixed, NULL, &large, 20000},
+        {"access/cap4096", resetShelf, runAccessOnly, NULL, &large, 20000},
+        {"add/cap4096", resetShelf, runAddOnly, NULL, &large, 20000},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) benchRun(suite, &cases[i]);
+
+    /* 10M slots by default (120 MB snapshot) */
+    SnapCtx snap;
+    snap.capacity = (int) benchScaled(suite, 10000000);
+    snprintf(snap.path, sizeof(snap.path), "bench_q4_%d.snap", (int) getpid());
+    shelfInit(&snap.shelf, 0);
+    BenchCase snapCases[] = {
+        {"snapshot/save-10M", fillLarge, runSave, NULL, &snap, 1},
+        {"snapshot/save-background-10M", fillLarge, runSaveBackground, waitSave, &snap, 1},
+        {"snapshot/cold-init-10M", NULL, runColdInit, NULL, &snap, 1},
+        {"snapshot/restore-10M", saveLarge, runRestore, NULL, &snap, 1},
+        {"snapshot/restore+first-miss-10M", saveLarge, runRestoreScan, NULL, &snap, 1},
+    };
+    for (size_t i = 0; i < sizeof(snapCases) / sizeof(snapCases[0]); i++) benchRun(suite, &snapCases[i]);
+    shelfFree(&snap.shelf);
+    remove(snap.path);
+
+    TierCtx ram = {.withDisk = 0, .seed = 7}, disk = {.withDisk = 1, .seed = 7};
+    snprintf(disk.path, sizeof(disk.path), "bench_q4_%d.tier", (int) getpid());
+    shelfInit(&ram.shelf, 0);
+    shelfInit(&disk.shelf, 0);
+    /* per-op time per ACCESS, by the tier that answers it */
+    BenchCase tierCases[] = {
+        {"tier/access-ram-hit", fillTiers, runRamHits, NULL, &disk, 20000},
+        {"tier/access-disk-hit", fillTiers, runDiskHits, NULL, &disk, 20000},
+        {"tier/access-miss", fillTiers, runMisses, NULL, &disk, 20000},
+        {"tier/access-miss-no-tier", fillTiers, runMisses, NULL, &ram, 20000},
+    };
+    for (size_t i = 0; i < sizeof(tierCases) / sizeof(tierCases[0]); i++) benchRun(suite, &tierCases[i]);
+    shelfFree(&ram.shelf);
+    shelfFree(&disk.shelf);
+    measureTiers(suite, &large, disk.path);
+
+    /* 10M entries by default; shelf operations scan every slot, so the
+     * wheel is driven directly and the shelf-level overhead is measured on
+     * the 4096-slot stream */
+    TtlCtx ttl;
+    ttl.capacity = (int) benchScaled(suite, 10000000);
+    ttl.seed = 5;
+    ttl.ttls = (long long *) malloc((size_t) ttl.capacity * sizeof(long long));
+    if (!ttl.ttls) {
+        perror("malloc failed");
+        return 1;
+    }
+    unsigned long long ttlSeed = 3;
+    for (int i = 0; i < ttl.capacity; i++) ttl.ttls[i] = mixedTtl(&ttlSeed);
+    shelfInit(&ttl.shelf, 0);
+    BenchCase ttlCases[] = {
+        {"ttl/mixed/cap4096", resetShelfTtl, runMixedTtl, NULL, &large, 20000},
+        {"ttl/arm-10M", fillTtl, runArm, NULL, &ttl, ttl.capacity},
+        {"ttl/rearm-10M", armTtl, runRearm, NULL, &ttl, ttl.capacity},
+        {"ttl/tick-10M", armTtl, runTick, NULL, &ttl, ttl.capacity},
+        {"ttl/expire-all-10M", armTtl, runExpireAll, NULL, &ttl, 1},
+    };
+    for (size_t i = 0; i < sizeof(ttlCases) / sizeof(ttlCases[0]); i++) benchRun(suite, &ttlCases[i]);
+    shelfFree(&ttl.shelf);
+    free(ttl.ttls);
+
+    char recoveryPath[64];
+    snprintf(recoveryPath, sizeof(recoveryPath), "bench_q4_%d.recovery", (int) getpid());
+    measureRecovery(suite, &large, recoveryPath);
+
+    freeCtx(&small);
+    freeCtx(&large);
+    return benchClose(suite);
+}
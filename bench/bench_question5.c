@@ -0,0 +1,575 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "question5.h"
+#include "linetree.h"
+#include "linesearch.h"
+#include "lazyfile.h"
+#include "lz.h"
+
+#define SCREEN_LINES 24
+
+/* question5: line buffer edits, load and save */
+
+typedef struct {
+    LineBuffer buf;
+    size_t lines;        /* lines in the prepared buffer / file */
+    char path[64];
+    int savedStdout;
+} EditCtx;
+
+static const char *sampleLine(size_t i) {
+    static const char *samples[] = {
+        "2024-05-01 12:00:01 INFO  request served in 12ms",
+        "2024-05-01 12:00:02 WARN  slow query on table members (412ms)",
+        "2024-05-01 12:00:02 DEBUG cache hit ratio 0.93",
+        "2024-05-01 12:00:03 ERROR connection reset by peer",
+    };
+    return samples[i & 3];
+}
+
+/* n sample lines, built in bulk (appending one by one would keep a version per line) */
+static void setLines(LineBuffer *buf, size_t n, const char *(*lineFor)(size_t)) {
+    LtBuilder b;
+    ltBuilderInit(&b);
+    for (size_t i = 0; i < n; i++) {
+        const char *line = lineFor(i);
+        ltBuilderAdd(&b, line, strlen(line));
+    }
+    freeAll(buf);
+    initBuffer(buf, 4);
+    commitVersion(buf, ltBuilderFinish(&b));
+}
+
+static void fillBuffer(void *p) {
+    EditCtx *c = (EditCtx *) p;
+    setLines(&c->buf, c->lines, sampleLine);
+}
+
+static void emptyBuffer(void *p) {
+    EditCtx *c = (EditCtx *) p;
+    freeAll(&c->buf);
+    initBuffer(&c->buf, 4);
+}
+
+static void runAppend(void *p, long long iters) {
+    EditCtx *c = (EditCtx *) p;
+    for (long long i = 0; i < iters; i++) insertLine(&c->buf, c->buf.size, sampleLine((size_t) i));
+}
+
+static void runInsertFront(void *p, long long iters) {
+    EditCtx *c = (EditCtx *) p;
+    for (long long i = 0; i < iters; i++) insertLine(&c->buf, 0, sampleLine((size_t) i));
+}
+
+static void runInsertMiddle(void *p, long long iters) {
+    EditCtx *c = (EditCtx *) p;
+    for (long long i = 0; i < iters; i++) insertLine(&c->buf, c->buf.size / 2, sampleLine((size_t) i));
+}
+
+static void runDeleteFront(void *p, long long iters) {
+    EditCtx *c = (EditCtx *) p;
+    for (long long i = 0; i < iters && c->buf.size > 0; i++) deleteLine(&c->buf, 0);
+}
+
+static void runReplace(void *p, long long iters) {
+    EditCtx *c = (EditCtx *) p;
+    for (long long i = 0; i < iters; i++)
+        replaceLine(&c->buf, (size_t) i % c->buf.size, sampleLine((size_t) i + 1));
+}
+
+static void runSave(void *p, long long iters) {
+    EditCtx *c = (EditCtx *) p;
+    for (long long i = 0; i < iters; i++) saveToFile(&c->buf, c->path);
+}
+
+static void runLoad(void *p, long long iters) {
+    EditCtx *c = (EditCtx *) p;
+    for (long long i = 0; i < iters; i++) loadFromFile(&c->buf, c->path);
+}
+
+static void runPrint(void *p, long long iters) {
+    EditCtx *c = (EditCtx *) p;
+    int saved = benchMuteStdout();
+    for (long long i = 0; i < iters; i++) printAllLines(&c->buf);
+    benchUnmuteStdout(saved);
+}
+
+/* the per-line printf printAllLines used before the buffered output */
+static void runPrintPrintf(void *p, long long iters) {
+    EditCtx *c = (EditCtx *) p;
+    int saved = benchMuteStdout();
+    for (long long i = 0; i < iters; i++) {
+        LtLeafList leaves;
+        LtScratch scratch = {NULL, 0};
+        printf("---- Buffer: %zu line(s) ----\n", c->buf.size);
+        ltCollectLeaves(c->buf.root, &leaves);
+        for (size_t j = 0; j < leaves.count; ++j) {
+            const size_t *off;
+            const char *text = ltLeafScan(leaves.leaf[j], &scratch, &off);
+            for (size_t k = 0; k < ltLeafLines(leaves.leaf[j]); ++k)
+                printf("%4zu: %.*s\n", leaves.firstLine[j] + k + 1, (int) (off[k + 1] - off[k] - 1), text + off[k]);
+        }
+        ltFreeLeafList(&leaves);
+        free(scratch.buf);
+        printf("---- end ----\n");
+        fflush(stdout);
+    }
+    benchUnmuteStdout(saved);
+}
+
+/* ---- search: one large buffer, a needle on every 4096th line ---- */
+
+typedef struct {
+    LineBuffer buf;
+    size_t bytes;        /* text bytes in the buffer, newlines not counted */
+    size_t sink;
+} SearchCtx;
+
+static const char *searchLine(size_t i) {
+    return (i & 4095) == 4095 ? "2024-05-01 12:00:04 ERROR upstream timeout after 30s" : sampleLine(i);
+}
+
+static void buildSearchBuffer(SearchCtx *c, size_t targetBytes) {
+    size_t n = 0;
+    c->bytes = 0;
+    while (c->bytes < targetBytes) c->bytes += strlen(searchLine(n++));
+    initBuffer(&c->buf, 4);
+    setLines(&c->buf, n, searchLine);
+}
+
+static void runFindAll(void *p, long long iters) {
+    SearchCtx *c = (SearchCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        MatchList m;
+        c->sink += findAll(&c->buf, "upstream timeout", &m);
+        freeMatches(&m);
+    }
+}
+
+/* baseline: libc memmem over every chunk, single thread */
+static void runMemmem(void *p, long long iters) {
+    SearchCtx *c = (SearchCtx *) p;
+    LtLeafList leaves;
+    ltCollectLeaves(c->buf.root, &leaves);
+    for (long long i = 0; i < iters; i++) {
+        for (size_t k = 0; k < leaves.count; k++) {
+            const char *text = ltLeafText(leaves.leaf[k]), *end = text + ltBytes(leaves.leaf[k]);
+            const char *hit;
+            while ((hit = memmem(text, (size_t) (end - text), "upstream timeout", 16))) {
+                c->sink++;
+                text = hit + 16;
+            }
+        }
+    }
+    ltFreeLeafList(&leaves);
+}
+
+/* alternates direction so every repetition has the same amount of work */
+static void runReplaceAll(void *p, long long iters) {
+    SearchCtx *c = (SearchCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        if (i & 1) c->sink += replaceAll(&c->buf, "upstream deadline", "upstream timeout", NULL);
+        else c->sink += replaceAll(&c->buf, "upstream timeout", "upstream deadline", NULL);
+    }
+}
+
+/* ---- history: edits and undo on a large buffer ---- */
+
+typedef struct {
+    LineBuffer buf;
+    unsigned long long rng;
+} HistoryCtx;
+
+static void runHistoryReplace(void *p, long long iters) {
+    HistoryCtx *c = (HistoryCtx *) p;
+    for (long long i = 0; i < iters; i++)
+        replaceLine(&c->buf, benchRand(&c->rng) % c->buf.size, sampleLine((size_t) i));
+}
+
+static void runHistoryInsert(void *p, long long iters) {
+    HistoryCtx *c = (HistoryCtx *) p;
+    for (long long i = 0; i < iters; i++)
+        insertLine(&c->buf, benchRand(&c->rng) % (c->buf.size + 1), sampleLine((size_t) i));
+}
+
+static void makeUndoable(void *p) {
+    runHistoryReplace(p, UNDO_LIMIT);
+}
+
+static void runUndo(void *p, long long iters) {
+    HistoryCtx *c = (HistoryCtx *) p;
+    for (long long i = 0; i < iters; i++) undoEdit(&c->buf);
+}
+
+/* tree memory added per edit while every version stays reachable (the two
+ * measurements together stay below UNDO_LIMIT, so no version is dropped) */
+static double bytesPerEdit(HistoryCtx *c, void (*edit)(void *, long long), long long edits) {
+    size_t before = ltMemoryInUse();
+    edit(c, edits);
+    return (double) (ltMemoryInUse() - before) / (double) edits;
+}
+
+/* ---- save latency against the size of the edit ---- */
+
+typedef struct {
+    LineBuffer buf;
+    char path[64];
+    size_t lines;          /* same-length replacements per save, 0 for an insert */
+    double insertAt;       /* where the insert goes, as a fraction of the file */
+    unsigned long long rng;
+} SaveCtx;
+
+/* edit, then save back to the file the buffer was loaded from */
+static void runEditAndSave(void *p, long long iters) {
+    SaveCtx *c = (SaveCtx *) p;
+    char text[128];
+    for (long long i = 0; i < iters; i++) {
+        for (size_t k = 0; k < c->lines; k++) {
+            size_t index = benchRand(&c->rng) % c->buf.size, len;
+            const char *line = getLine(&c->buf, index, &len);
+            snprintf(text, sizeof(text), "%.*s", (int) len, line);
+            text[0] ^= 1;   /* "2024" <-> "3024": the length does not change */
+            replaceLine(&c->buf, index, text);
+        }
+        if (c->lines == 0) insertLine(&c->buf, (size_t) (c->insertAt * (double) c->buf.size), "inserted line");
+        saveToFile(&c->buf, c->path);
+    }
+}
+
+/* cut the final newline off the file and load it again, so the next save
+ * starts from a file one byte shorter than the buffer counts */
+static void dropFinalNewline(void *p) {
+    SaveCtx *c = (SaveCtx *) p;
+    struct stat st;
+    if (stat(c->path, &st) == 0 && st.st_size > 0 && truncate(c->path, st.st_size - 1) == 0)
+        loadFromFile(&c->buf, c->path);
+}
+
+/* 1 if the file is exactly the buffer, one '\n' after every line */
+static int savedIntact(SaveCtx *c) {
+    FILE *f = fopen(c->path, "rb");
+    if (!f) return 0;
+    int ok = 1;
+    for (size_t i = 0; i < c->buf.size && ok; i++) {
+        size_t len;
+        const char *line = getLine(&c->buf, i, &len);
+        for (size_t k = 0; k < len && ok; k++) ok = fgetc(f) == (unsigned char) line[k];
+        if (ok) ok = fgetc(f) == '\n';
+    }
+    if (ok) ok = fgetc(f) == EOF;
+    fclose(f);
+    return ok;
+}
+
+/* ---- compression of cold chunks on log text ---- */
+
+typedef struct {
+    LineBuffer buf;
+    unsigned long long rng;
+    size_t sink;
+    LtLeafList leaves;     /* for the codec cases */
+    char *packed;
+    size_t *packedLen;
+} PackCtx;
+
+/* log lines with the variety of a real service log: running timestamps,
+ * ids, addresses, latencies and a handful of message shapes */
+static const char *logLine(size_t i) {
+    static char line[192];
+    static unsigned long long rng = 99;
+    static const char *levels[] = {"INFO ", "INFO ", "INFO ", "DEBUG", "WARN ", "ERROR"};
+    static const char *paths[] = {"/api/v1/orders", "/api/v1/members", "/login", "/static/app.js", "/health"};
+    unsigned long long x = benchRand(&rng);
+    unsigned secs = (unsigned) (i / 40);
+    int n = snprintf(line, sizeof(line), "2024-05-%02u %02u:%02u:%02u.%03u %s [req %08llx] ",
+                     1 + secs / 86400 % 28, secs / 3600 % 24, secs / 60 % 60, secs % 60, (unsigned) (i * 37 % 1000),
+                     levels[x % 6], x >> 32 & 0xffffffffULL);
+    switch (x >> 8 & 3) {
+    case 0:
+        snprintf(line + n, sizeof(line) - n, "GET %s from 10.%u.%u.%u status 200 in %llums", paths[x >> 12 & 3],
+                 (unsigned) (x >> 16 & 255), (unsigned) (x >> 24 & 255), (unsigned) (x >> 40 & 255), x >> 48 & 511);
+        break;
+    case 1:
+        snprintf(line + n, sizeof(line) - n, "POST %s user=%llu items=%llu total=%llu.%02llu", paths[x >> 12 & 1],
+                 x >> 20 & 0xfffff, x >> 40 & 15, x >> 44 & 4095, x >> 56 & 99);
+        break;
+    case 2:
+        snprintf(line + n, sizeof(line) - n, "cache %s for key member:%llu (ratio 0.%02llu)",
+                 x & 0x1000 ? "hit" : "miss", x >> 20 & 0xfffff, x >> 40 & 99);
+        break;
+    default:
+        snprintf(line + n, sizeof(line) - n, "db query on %s took %llums rows=%llu",
+                 x & 0x1000 ? "orders" : "members", x >> 20 & 2047, x >> 40 & 255);
+        break;
+    }
+    return line;
+}
+
+static double rssMB(void) {
+    long pages = 0, resident = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f) {
+        if (fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+        fclose(f);
+    }
+    return (double) resident * (double) sysconf(_SC_PAGESIZE) / 1048576.0;
+}
+
+static void runCompress(void *p, long long iters) {
+    PackCtx *c = (PackCtx *) p;
+    for (long long i = 0; i < iters; i++)
+        for (size_t k = 0; k < c->leaves.count; k++) {
+            const LtNode *leaf = c->leaves.leaf[k];
+            c->packedLen[k] = lzCompress(ltLeafText(leaf), ltBytes(leaf), c->packed + k * lzBound(LT_LEAF_BYTES * 2));
+        }
+}
+
+static void runDecompress(void *p, long long iters) {
+    PackCtx *c = (PackCtx *) p;
+    char out[LT_LEAF_BYTES * 2];
+    for (long long i = 0; i < iters; i++)
+        for (size_t k = 0; k < c->leaves.count; k++) {
+            lzDecompress(c->packed + k * lzBound(LT_LEAF_BYTES * 2), c->packedLen[k], out, ltBytes(c->leaves.leaf[k]));
+            benchKeep(out);
+        }
+}
+
+/* random lines, trimming every 64 reads as the editor does between commands */
+static void runRandomLines(void *p, long long iters) {
+    PackCtx *c = (PackCtx *) p;
+    size_t len;
+    for (long long i = 0; i < iters; i++) {
+        c->sink += getLine(&c->buf, benchRand(&c->rng) % c->buf.size, &len) ? len : 0;
+        if ((i & 63) == 63) ltTrim();
+    }
+}
+
+/* a screen of lines from a random place: one unpack, then hits */
+static void runRandomScreens(void *p, long long iters) {
+    PackCtx *c = (PackCtx *) p;
+    size_t len, at = 0;
+    for (long long i = 0; i < iters; i++) {
+        if (i % SCREEN_LINES == 0) {
+            at = benchRand(&c->rng) % (c->buf.size - SCREEN_LINES);
+            ltTrim();
+        }
+        c->sink += getLine(&c->buf, at + (size_t) (i % SCREEN_LINES), &len) ? len : 0;
+    }
+}
+
+/* ---- lazy open: time until a line can be shown ---- */
+
+typedef struct {
+    char path[64];
+    size_t lines;
+    unsigned long long rng;
+    size_t sink;
+} LazyCtx;
+
+static void writeLogFile(LazyCtx *c, size_t targetBytes) {
+    FILE *f = fopen(c->path, "w");
+    size_t bytes = 0;
+    c->lines = 0;
+    if (!f) return;
+    while (bytes < targetBytes) {
+        const char *line = sampleLine(c->lines++);
+        fprintf(f, "%s\n", line);
+        bytes += strlen(line) + 1;
+    }
+    fclose(f);
+}
+
+static void runLazyFirstScreen(void *p, long long iters) {
+    LazyCtx *c = (LazyCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        LazyFile *lf = lazyOpen(c->path);
+        size_t len;
+        for (size_t k = 0; k < 24; k++) c->sink += lazyLine(lf, k, &len) ? len : 0;
+        lazyClose(lf);
+    }
+}
+
+static void runLazyRandomLine(void *p, long long iters) {
+    LazyCtx *c = (LazyCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        LazyFile *lf = lazyOpen(c->path);
+        size_t len;
+        c->sink += lazyLine(lf, benchRand(&c->rng) % c->lines, &len) ? len : 0;
+        lazyClose(lf);
+    }
+}
+
+static void runLazyLastLine(void *p, long long iters) {
+    LazyCtx *c = (LazyCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        LazyFile *lf = lazyOpen(c->path);
+        size_t len;
+        c->sink += lazyLine(lf, c->lines - 1, &len) ? len : 0;
+        lazyClose(lf);
+    }
+}
+
+/* what the first 'p' costs without lazy open */
+static void runEagerLoad(void *p, long long iters) {
+    LazyCtx *c = (LazyCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        LineBuffer buf;
+        initBuffer(&buf, 4);
+        loadFromFile(&buf, c->path);
+        c->sink += buf.size;
+        freeAll(&buf);
+    }
+}
+
+int main(int argc, char **argv) {
+    BenchSuite *suite = benchOpen("question5", argc, argv);
+    EditCtx ctx;
+    initBuffer(&ctx.buf, 4);
+    ctx.lines = (size_t) benchScaled(suite, 200000);
+    snprintf(ctx.path, sizeof(ctx.path), "bench_q5_%d.tmp", (int) getpid());
+
+    /* file used by the load case */
+    fillBuffer(&ctx);
+    saveToFile(&ctx.buf, ctx.path);
+
+    /* per-op time is per line edit; load/save/print are per whole buffer */
+    BenchCase cases[] = {
+        {"append", emptyBuffer, runAppend, NULL, &ctx, (long long) ctx.lines},
+        {"insert/front", fillBuffer, runInsertFront, NULL, &ctx, 1000},
+        {"insert/middle", fillBuffer, runInsertMiddle, NULL, &ctx, 1000},
+        {"delete/front", fillBuffer, runDeleteFront, NULL, &ctx, 1000},
+        {"replace", fillBuffer, runReplace, NULL, &ctx, 100000},
+        {"saveToFile", fillBuffer, runSave, NULL, &ctx, 1},
+        {"loadFromFile", emptyBuffer, runLoad, NULL, &ctx, 1},
+        {"printAllLines", fillBuffer, runPrint, NULL, &ctx, 1},
+        {"printAllLines/printf", fillBuffer, runPrintPrintf, NULL, &ctx, 1},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) benchRun(suite, &cases[i]);
+    benchRate(suite, "printAllLines", (double) ctx.lines, "rows/s");
+    benchRate(suite, "printAllLines/printf", (double) ctx.lines, "rows/s");
+    freeAll(&ctx.buf);
+
+    /* 256 MB of text by default; --scale 16 gives a 4 GB buffer */
+    SearchCtx sctx = {.sink = 0};
+    buildSearchBuffer(&sctx, (size_t) benchScaled(suite, 256LL << 20));
+    BenchCase searchCases[] = {
+        {"search/findAll", NULL, runFindAll, NULL, &sctx, 1, (double) sctx.bytes},
+        {"search/memmem-baseline", NULL, runMemmem, NULL, &sctx, 1, (double) sctx.bytes},
+        {"search/replaceAll", NULL, runReplaceAll, NULL, &sctx, 2, (double) sctx.bytes},
+    };
+    for (size_t i = 0; i < sizeof(searchCases) / sizeof(searchCases[0]); i++) benchRun(suite, &searchCases[i]);
+    freeAll(&sctx.buf);
+
+    /* 10M lines by default */
+    HistoryCtx hctx = {.rng = 42};
+    size_t hlines = (size_t) benchScaled(suite, 10000000);
+    initBuffer(&hctx.buf, 4);
+    setLines(&hctx.buf, hlines, sampleLine);
+    size_t textBytes = ltBytes(hctx.buf.root);
+    benchMetric(suite, "history/tree-overhead", (double) (ltMemoryInUse() - textBytes) / (double) hlines,
+                "bytes/line");
+    benchMetric(suite, "history/bytes-per-replace", bytesPerEdit(&hctx, runHistoryReplace, UNDO_LIMIT / 2 - 1),
+                "bytes/edit");
+    benchMetric(suite, "history/bytes-per-insert", bytesPerEdit(&hctx, runHistoryInsert, UNDO_LIMIT / 2 - 1),
+                "bytes/edit");
+    BenchCase historyCases[] = {
+        {"history/replace", NULL, runHistoryReplace, NULL, &hctx, 10000},
+        {"history/insert", NULL, runHistoryInsert, NULL, &hctx, 10000},
+        {"history/undo", makeUndoable, runUndo, NULL, &hctx, UNDO_LIMIT},
+    };
+    for (size_t i = 0; i < sizeof(historyCases) / sizeof(historyCases[0]); i++) benchRun(suite, &historyCases[i]);
+    freeAll(&hctx.buf);
+
+    remove(ctx.path);
+
+    /* 256 MB of log text; the codec on its own, then the buffer with all
+     * but 16 MB of it packed */
+    PackCtx pctx = {.rng = 5};
+    initBuffer(&pctx.buf, 4);
+    malloc_trim(0);   /* memory freed by the cases above */
+    double rssEmpty = rssMB();
+    setLines(&pctx.buf, (size_t) benchScaled(suite, 256LL << 20) / 80, logLine);
+    double rssFull = rssMB();
+    ltCollectLeaves(pctx.buf.root, &pctx.leaves);
+    pctx.packed = (char *) malloc(pctx.leaves.count * lzBound(LT_LEAF_BYTES * 2));
+    pctx.packedLen = (size_t *) malloc(pctx.leaves.count * sizeof(size_t));
+    BenchCase codecCases[] = {
+        {"pack/lzCompress", NULL, runCompress, NULL, &pctx, 1, (double) ltBytes(pctx.buf.root)},
+        {"pack/lzDecompress", NULL, runDecompress, NULL, &pctx, 1, (double) ltBytes(pctx.buf.root)},
+        {"pack/getLine-unpacked", NULL, runRandomLines, NULL, &pctx, 100000},
+    };
+    for (size_t i = 0; i < sizeof(codecCases) / sizeof(codecCases[0]); i++) benchRun(suite, &codecCases[i]);
+    free(pctx.packed);
+    free(pctx.packedLen);
+    ltFreeLeafList(&pctx.leaves);
+
+    ltSetHotLimit(16 << 20);
+    ltTrim();
+    double rssPacked = rssMB();
+    LtPackStats pst;
+    ltPackStats(&pst);
+    benchMetric(suite, "pack/ratio", (double) pst.coldText / (double) pst.coldPacked, "x");
+    benchMetric(suite, "pack/rss-unpacked", rssFull - rssEmpty, "MB");
+    benchMetric(suite, "pack/rss-packed", rssPacked - rssEmpty, "MB");
+    BenchCase packedCases[] = {
+        {"pack/getLine-packed", NULL, runRandomLines, NULL, &pctx, 100000},
+        {"pack/getLine-screens", NULL, runRandomScreens, NULL, &pctx, 100 * SCREEN_LINES},
+    };
+    for (size_t i = 0; i < sizeof(packedCases) / sizeof(packedCases[0]); i++) benchRun(suite, &packedCases[i]);
+    ltSetHotLimit(0);
+    freeAll(&pctx.buf);
+
+    /* 256 MB file by default; an edit plus the save that follows it */
+    SaveCtx svctx = {.rng = 11};
+    snprintf(svctx.path, sizeof(svctx.path), "bench_q5_save_%d.tmp", (int) getpid());
+    initBuffer(&svctx.buf, 4);
+    setLines(&svctx.buf, (size_t) benchScaled(suite, 256LL << 20) / 50, sampleLine);
+    saveToFile(&svctx.buf, svctx.path);
+    loadFromFile(&svctx.buf, svctx.path);
+    static const struct {
+        const char *name;
+        size_t lines;
+        double insertAt;
+    } saveEdits[] = {
+        {"save/replace-1-line", 1, 0},
+        {"save/replace-64-lines", 64, 0},
+        {"save/replace-4096-lines", 4096, 0},
+        {"save/insert-at-90%", 0, 0.9},
+        {"save/insert-at-50%", 0, 0.5},
+        {"save/insert-at-front", 0, 0},
+    };
+    for (size_t i = 0; i < sizeof(saveEdits) / sizeof(saveEdits[0]); i++) {
+        svctx.lines = saveEdits[i].lines;
+        svctx.insertAt = saveEdits[i].insertAt;
+        BenchCase sc = {saveEdits[i].name, NULL, runEditAndSave, NULL, &svctx, 1};
+        benchRun(suite, &sc);
+    }
+    /* a file without a final newline is saved whole, adding the newline */
+    svctx.lines = 1;
+    BenchCase noNewline = {"save/no-final-newline", dropFinalNewline, runEditAndSave, NULL, &svctx, 1};
+    benchRun(suite, &noNewline);
+    benchMetric(suite, "save/no-final-newline-intact", savedIntact(&svctx), "bool");
+    freeAll(&svctx.buf);
+    remove(svctx.path);
+
+    /* 256 MB file by default, --scale 20 for 5 GB; timings are with the
+     * file in the page cache */
+    LazyCtx lctx = {.rng = 7};
+    snprintf(lctx.path, sizeof(lctx.path), "bench_q5_lazy_%d.tmp", (int) getpid());
+    writeLogFile(&lctx, (size_t) benchScaled(suite, 256LL << 20));
+    BenchCase lazyCases[] = {
+        {"lazy/first-screen", NULL, runLazyFirstScreen, NULL, &lctx, 1},
+        {"lazy/random-line", NULL, runLazyRandomLine, NULL, &lctx, 1},
+        {"lazy/last-line", NULL, runLazyLastLine, NULL, &lctx, 1},
+        {"lazy/eager-load", NULL, runEagerLoad, NULL, &lctx, 1},
+    };
+    for (size_t i = 0; i < sizeof(lazyCases) / sizeof(lazyCases[0]); i++) benchRun(suite, &lazyCases[i]);
+    remove(lctx.path);
+    return benchClose(suite);
+}
@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "question6.h"
+#include "memberreport.h"
+
+/* question6: member registration, lookup, reports and persistence */
+
+typedef struct {
+    Database db;
+    size_t members;
+    char path[64];
+    int nextId;
+    unsigned long long seed;
+    int *order;         // ids in a random order, for delete-heavy cases
+    size_t cursor;
+    BenchSuite *suite;
+    size_t reportMembers;   // members in the report file, written on first use
+    char reportPath[64];
+    int reportReady;
+    ReportSpec spec;
+} MemberCtx;
+
+static const char *batches[] = {"CS", "SE", "Cyber Security", "AI"};
+static const char *types[] = {"IEEE", "ACM"};
+static const char *interests[] = {"IEEE", "ACM", "Both"};
+
+static void makeStudent(Student *s, int id) {
+    memset(s, 0, sizeof(*s));
+    s->id = id;
+    snprintf(s->name, NAME_LEN, "Student Number %d", id);
+    snprintf(s->batch, BATCH_LEN, "%s", batches[id & 3]);
+    snprintf(s->membershipType, TYPE_LEN, "%s", types[id & 1]);
+    snprintf(s->registrationDate, DATE_LEN, "2024-%02u-%02u", (unsigned) id % 12 + 1, (unsigned) id % 28 + 1);
+    snprintf(s->dob, DATE_LEN, "2003-%02u-%02u", (unsigned) id % 12 + 1, (unsigned) id % 27 + 1);
+    snprintf(s->interest, INTEREST_LEN, "%s", interests[id % 3]);
+}
+
+static void fillDb(void *p) {
+    MemberCtx *c = (MemberCtx *) p;
+    freeDatabase(&c->db);
+    initDatabase(&c->db);
+    ensureCapacity(&c->db, c->members);
+    for (size_t i = 0; i < c->members; i++) makeStudent(&c->db.members.items[i], (int) i + 1);
+    c->db.members.size = c->members;
+    studentStoreReindex(&c->db.members);
+    c->nextId = (int) c->members + 1;
+}
+
+static void fillShuffled(void *p) {
+    MemberCtx *c = (MemberCtx *) p;
+    fillDb(c);
+    for (size_t i = 0; i < c->members; i++) c->order[i] = (int) i + 1;
+    for (size_t i = c->members - 1; i > 0; i--) {
+        size_t j = (size_t) (benchRand(&c->seed) % (i + 1));
+        int t = c->order[i];
+        c->order[i] = c->order[j];
+        c->order[j] = t;
+    }
+    c->cursor = 0;
+}
+
+static void fillBackground(void *p) {
+    MemberCtx *c = (MemberCtx *) p;
+    fillShuffled(c);
+    c->db.compactInBackground = 1;
+}
+
+static void fillSaved(void *p) {
+    MemberCtx *c = (MemberCtx *) p;
+    fillShuffled(c);
+    saveDatabase(&c->db, c->path);
+}
+
+/* a table loaded back from a file in which every other record was deleted */
+static void fillHalfDead(void *p) {
+    MemberCtx *c = (MemberCtx *) p;
+    char path[80];
+    fillDb(c);
+    for (size_t i = 0; i < c->members; i += 2) {
+        memset(&c->db.members.items[i], 0, sizeof(Student));
+        c->db.members.items[i].id = TOMBSTONE_ID;
+    }
+    snprintf(path, sizeof(path), "%s.dead", c->path);
+    saveDatabase(&c->db, path);
+    freeDatabase(&c->db);
+    initDatabase(&c->db);
+    loadDatabase(&c->db, path);
+    remove(path);
+}
+
+static void resetDb(void *p) {
+    MemberCtx *c = (MemberCtx *) p;
+    c->db.compactInBackground = 0;
+    freeDatabase(&c->db);
+}
+
+static void runDeleteFront(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    for (long long i = 0; i < iters; i++) deleteStudent(&c->db, (int) i + 1);
+    finishCompaction(&c->db, 1);
+}
+
+static void runDeleteRandom(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        deleteStudent(&c->db, c->order[c->cursor++]);
+        finishCompaction(&c->db, 0);
+    }
+    finishCompaction(&c->db, 1);
+}
+
+/* delete a member and register a new one, which takes the freed slot */
+static void runChurn(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    Student s;
+    for (long long i = 0; i < iters; i++) {
+        deleteStudent(&c->db, c->order[c->cursor++]);
+        makeStudent(&s, c->nextId++);
+        addStudent(&c->db, &s);
+    }
+}
+
+/* what the menu does per delete: write back one slot, or the whole file */
+static void runDeleteSaveRecord(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    size_t layout = c->db.layoutVersion;
+    for (long long i = 0; i < iters; i++) {
+        int id = c->order[c->cursor++];
+        size_t idx = findStudentIndex(&c->db, id);
+        deleteStudent(&c->db, id);
+        if (layout != c->db.layoutVersion) {
+            saveDatabase(&c->db, c->path);
+            layout = c->db.layoutVersion;
+        } else {
+            saveRecord(&c->db, c->path, idx);
+        }
+    }
+}
+
+static void runDeleteSaveAll(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        deleteStudent(&c->db, c->order[c->cursor++]);
+        saveDatabase(&c->db, c->path);
+    }
+}
+
+static void runCompact(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    for (long long i = 0; i < iters; i++) compactDatabase(&c->db);
+}
+
+/* ---- sorted reports over a data file larger than the sort memory ---- */
+
+#define PAGE_ROWS 20
+
+static void makeReportFile(void *p) {
+    MemberCtx *c = (MemberCtx *) p;
+    if (c->reportReady) return;
+    FILE *f = fopen(c->reportPath, "wb");
+    Student *block = (Student *) malloc(4096 * sizeof(Student));
+    if (!f || !block) {
+        perror("report file");
+        exit(1);
+    }
+    for (size_t i = 0; i < c->reportMembers; i += 4096) {
+        size_t n = c->reportMembers - i < 4096 ? c->reportMembers - i : 4096;
+        for (size_t k = 0; k < n; k++) makeStudent(&block[k], (int) (i + k) + 1);
+        if (fwrite(block, sizeof(Student), n, f) != n) {
+            perror("report file");
+            exit(1);
+        }
+    }
+    fclose(f);
+    free(block);
+    /* a quarter of the file per chunk: the sort always spills runs */
+    size_t bytes = c->reportMembers * sizeof(Student);
+    c->spec.memoryLimit = bytes / 4 < REPORT_MEMORY ? bytes / 4 : REPORT_MEMORY;
+    benchMetric(c->suite, "report-file", (double) bytes / (1 << 20), "MB");
+    c->reportReady = 1;
+}
+
+static void runFirstPageTopN(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    Student rows[PAGE_ROWS];
+    size_t n = 0;
+    for (long long i = 0; i < iters; i++) n += reportTopNFile(c->reportPath, &c->spec, rows, PAGE_ROWS);
+    benchKeep(&n);
+}
+
+static void runFirstPageSorted(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    Student rows[PAGE_ROWS];
+    size_t n = 0;
+    for (long long i = 0; i < iters; i++) {
+        Report *r = reportOpenFile(c->reportPath, &c->spec);
+        n += reportRead(r, rows, PAGE_ROWS);
+        reportClose(r);
+    }
+    benchKeep(&n);
+}
+
+static void runAllPagesSorted(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    Student rows[PAGE_ROWS];
+    size_t total = 0;
+    for (long long i = 0; i < iters; i++) {
+        Report *r = reportOpenFile(c->reportPath, &c->spec);
+        size_t n;
+        while ((n = reportRead(r, rows, PAGE_ROWS)) > 0) total += n;
+        reportClose(r);
+    }
+    benchKeep(&total);
+}
+
+/* the same over the 20000-member table in memory */
+static void runTableSorted(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    Student rows[PAGE_ROWS];
+    size_t n = 0;
+    for (long long i = 0; i < iters; i++) {
+        Report *r = reportOpen(&c->db, &c->spec);
+        n += reportRead(r, rows, PAGE_ROWS);
+        reportClose(r);
+    }
+    benchKeep(&n);
+}
+
+static void runTableTopN(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    Student rows[PAGE_ROWS];
+    size_t n = 0;
+    for (long long i = 0; i < iters; i++) n += reportTopN(&c->db, &c->spec, rows, PAGE_ROWS);
+    benchKeep(&n);
+}
+
+static void fillTable(void *p) {
+    MemberCtx *c = (MemberCtx *) p;
+    makeReportFile(c);
+    fillDb(c);
+}
+
+static void runAdd(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    Student s;
+    for (long long i = 0; i < iters; i++) {
+        makeStudent(&s, c->nextId++);
+        addStudent(&c->db, &s);
+    }
+}
+
+static void runLookup(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    size_t sum = 0;
+    for (long long i = 0; i < iters; i++)
+        sum += findStudentIndex(&c->db, (int) (benchRand(&c->seed) % c->members) + 1);
+    benchKeep(&sum);
+}
+
+static void runDisplayAll(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    int saved = benchMuteStdout();
+    for (long long i = 0; i < iters; i++) displayAll(&c->db);
+    benchUnmuteStdout(saved);
+}
+
+/* the per-row printf displayAll used before the buffered output */
+static void runDisplayAllPrintf(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    int saved = benchMuteStdout();
+    for (long long i = 0; i < iters; i++) {
+        for (size_t j = 0; j < c->db.members.size; j++) {
+            if (isTombstone(&c->db, j)) continue;
+            const Student *s = &c->db.members.items[j];
+            printf("%d\t%s\t%s\t%s\t%s\t%s\t%s\n", s->id, s->name, s->batch, s->membershipType,
+                   s->registrationDate, s->dob, s->interest);
+        }
+        fflush(stdout);
+    }
+    benchUnmuteStdout(saved);
+}
+
+static void runBatchReport(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    int saved = benchMuteStdout();
+    for (long long i = 0; i < iters; i++) displayBatchReport(&c->db, "CS", "IEEE");
+    benchUnmuteStdout(saved);
+}
+
+static void runSave(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    for (long long i = 0; i < iters; i++) saveDatabase(&c->db, c->path);
+}
+
+static void runLoad(void *p, long long iters) {
+    MemberCtx *c = (MemberCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        freeDatabase(&c->db);
+        initDatabase(&c->db);
+        loadDatabase(&c->db, c->path);
+    }
+}
+
+int main(int argc, char **argv) {
+    BenchSuite *suite = benchOpen("question6", argc, argv);
+    MemberCtx ctx;
+    initDatabase(&ctx.db);
+    ctx.members = (size_t) benchScaled(suite, 20000);
+    ctx.seed = 2463534242ULL;
+    snprintf(ctx.path, sizeof(ctx.path), "bench_q6_%d.tmp", (int) getpid());
+    ctx.order = (int *) malloc(ctx.members * sizeof(int));
+    ctx.suite = suite;
+    ctx.reportMembers = (size_t) benchScaled(suite, 500000);
+    ctx.reportReady = 0;
+    snprintf(ctx.reportPath, sizeof(ctx.reportPath), "bench_q6_report_%d.tmp", (int) getpid());
+    memset(&ctx.spec, 0, sizeof(ctx.spec));
+    ctx.spec.key = SORT_BY_NAME;
+    long long deletes = (long long) ctx.members / 2, churn = (long long) ctx.members / 10;
+
+    fillDb(&ctx);
+    saveDatabase(&ctx.db, ctx.path);
+
+    /* per-op time is per student for add/lookup/delete, per report or file
+     * otherwise; delete cases remove half the table, so compaction (at 1/4
+     * tombstones) runs inside the timed loop */
+    BenchCase cases[] = {
+        {"addStudent", fillDb, runAdd, NULL, &ctx, 1000},
+        {"findStudentIndex", fillDb, runLookup, NULL, &ctx, 2000},
+        {"displayAll", fillDb, runDisplayAll, NULL, &ctx, 1},
+        {"displayAll/printf", fillDb, runDisplayAllPrintf, NULL, &ctx, 1},
+        {"displayBatchReport", fillDb, runBatchReport, NULL, &ctx, 1},
+        {"saveDatabase", fillDb, runSave, NULL, &ctx, 1},
+        {"loadDatabase", NULL, runLoad, NULL, &ctx, 1},
+        {"delete/front", fillShuffled, runDeleteFront, resetDb, &ctx, deletes},
+        {"delete/random", fillShuffled, runDeleteRandom, resetDb, &ctx, deletes},
+        {"delete/random-background", fillBackground, runDeleteRandom, resetDb, &ctx, deletes},
+        {"churn/delete-add", fillShuffled, runChurn, resetDb, &ctx, churn},
+        {"delete+saveRecord", fillSaved, runDeleteSaveRecord, resetDb, &ctx, 200},
+        {"delete+saveDatabase", fillSaved, runDeleteSaveAll, resetDb, &ctx, 200},
+        {"compactDatabase/half-dead", fillHalfDead, runCompact, resetDb, &ctx, 1},
+        {"report/table-first-page-topN", fillTable, runTableTopN, NULL, &ctx, 20},
+        {"report/table-first-page-sorted", fillTable, runTableSorted, NULL, &ctx, 20},
+        {"report/file-first-page-topN", makeReportFile, runFirstPageTopN, NULL, &ctx, 1},
+        {"report/file-first-page-sorted", makeReportFile, runFirstPageSorted, NULL, &ctx, 1},
+        {"report/file-all-pages-sorted", makeReportFile, runAllPagesSorted, NULL, &ctx, 1},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) benchRun(suite, &cases[i]);
+    benchRate(suite, "displayAll", (double) ctx.members, "rows/s");
+    benchRate(suite, "displayAll/printf", (double) ctx.members, "rows/s");
+
+    freeDatabase(&ctx.db);
+    free(ctx.order);
+    remove(ctx.path);
+    if (ctx.reportReady) remove(ctx.reportPath);
+    return benchClose(suite);
+}
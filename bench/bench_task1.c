@@ -0,0 +1,295 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "bench.h"
+#include "task1.h"
+
+/* task1: sales against the book store, next to the parallel arrays and
+ * linear ISBN scan of the original 100-book catalogue */
+
+#define CATALOGUE 100
+
+typedef struct {
+    BookStore books;
+    int *isbns;         /* the original layout, for the linear baselines */
+    int *quantities;
+    int count;
+    unsigned long long seed;
+    int savedStdout;
+} StoreCtx;
+
+static int findIsbnLinear(const int isbns[], int count, int isbn) {
+    for (int i = 0; i < count; i++)
+        if (isbns[i] == isbn) return i;
+    return -1;
+}
+
+static void stock(void *p) {
+    StoreCtx *c = (StoreCtx *) p;
+    bookStoreFree(&c->books);
+    for (int i = 0; i < c->count; i++) {
+        Book b;
+        b.isbn = 100000 + i * 7;
+        b.quantity = 1 << 30;
+        b.price = 10.0f + (float) i;
+        snprintf(b.title, sizeof(b.title), "Book title %d", i);
+        bookStorePush(&c->books, &b);
+        c->isbns[i] = b.isbn;
+        c->quantities[i] = b.quantity;
+    }
+}
+
+static void runSale(void *p, long long iters) {
+    StoreCtx *c = (StoreCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        int isbn = 100000 + (int) (benchRand(&c->seed) % (unsigned long long) c->count) * 7;
+        int idx = findIsbn(&c->books, isbn);
+        if (idx >= 0) sellCopies(&c->books.items[idx], 1);
+    }
+}
+
+static void runSaleLinear(void *p, long long iters) {
+    StoreCtx *c = (StoreCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        int isbn = 100000 + (int) (benchRand(&c->seed) % (unsigned long long) c->count) * 7;
+        int idx = findIsbnLinear(c->isbns, c->count, isbn);
+        if (idx >= 0 && c->quantities[idx] >= 1) c->quantities[idx]--;
+    }
+}
+
+static void runMissingLookup(void *p, long long iters) {
+    StoreCtx *c = (StoreCtx *) p;
+    int misses = 0;
+    for (long long i = 0; i < iters; i++) misses += findIsbn(&c->books, -1 - (int) (i & 1023)) < 0;
+    benchKeep(&misses);
+}
+
+static void runMissingLookupLinear(void *p, long long iters) {
+    StoreCtx *c = (StoreCtx *) p;
+    int misses = 0;
+    for (long long i = 0; i < iters; i++) misses += findIsbnLinear(c->isbns, c->count, -1 - (int) (i & 1023)) < 0;
+    benchKeep(&misses);
+}
+
+static void lowStockSetup(void *p) {
+    StoreCtx *c = (StoreCtx *) p;
+    stock(c);
+    for (int i = 0; i < c->count; i += 2) c->books.items[i].quantity = i % 5;
+    c->savedStdout = benchMuteStdout();
+}
+
+static void lowStockTeardown(void *p) {
+    benchUnmuteStdout(((StoreCtx *) p)->savedStdout);
+}
+
+static void runLowStock(void *p, long long iters) {
+    StoreCtx *c = (StoreCtx *) p;
+    for (long long i = 0; i < iters; i++) lowStock(&c->books);
+}
+
+/* the per-row printf lowStock used before the buffered output */
+static void runLowStockPrintf(void *p, long long iters) {
+    StoreCtx *c = (StoreCtx *) p;
+    for (long long i = 0; i < iters; i++) {
+        int found = 0;
+        for (size_t j = 0; j < c->books.size; j++) {
+            const Book *b = &c->books.items[j];
+            if (b->quantity < 5) {
+                printf("ISBN: %d Title: %s Price: %.2f Quantity: %d\n", b->isbn, b->title, b->price, b->quantity);
+                found = 1;
+            }
+        }
+        if (!found) printf("No low stock books\n");
+        fflush(stdout);
+    }
+}
+
+static void openStore(StoreCtx *c, int count, unsigned long long seed) {
+    bookStoreInit(&c->books);
+    c->count = count;
+    c->seed = seed;
+    c->isbns = (int *) malloc((size_t) count * sizeof(int));
+    c->quantities = (int *) malloc((size_t) count * sizeof(int));
+    if (!c->isbns || !c->quantities) {
+        perror("malloc failed");
+        exit(1);
+    }
+    stock(c);
+}
+
+static void closeStore(StoreCtx *c) {
+    bookStoreFree(&c->books);
+    free(c->isbns);
+    free(c->quantities);
+}
+
+/* ---- title search over a large catalogue ---- */
+
+#define VOCABULARY 8192
+#define QUERIES 256
+
+typedef struct {
+    char (*titles)[50];
+    int count;
+    TitleIndex *index;
+    char queries[QUERIES][50];
+    int prefix;
+    int results[TITLE_TOP_K];
+    int next;
+} SearchCtx;
+
+/* Capitalised words of 2-4 syllables, drawn with a skew so that some words
+ * are common and most are rare */
+static void makeTitles(SearchCtx *c, unsigned long long *seed) {
+    static const char *syllables[] = {"ka", "ri", "ver", "the", "sto", "ne", "mor", "lin", "da", "shi",
+                                      "el", "to", "ran", "qu", "ea", "ber", "os", "wy", "nd", "ha",
+                                      "gle", "fu", "zo", "pen", "cri", "ux", "mb", "jo", "ight", "vi",
+                                      "str", "ow", "ack", "ph", "ing", "ly", "bo", "ce", "dr", "ent"};
+    static char words[VOCABULARY][12];
+    for (int w = 0; w < VOCABULARY; w++) {
+        int n = 2 + (int) (benchRand(seed) % 3);
+        words[w][0] = '\0';
+        for (int i = 0; i < n; i++) strcat(words[w], syllables[benchRand(seed) % 40]);
+        words[w][0] = (char) toupper((unsigned char) words[w][0]);
+    }
+    for (int i = 0; i < c->count; i++) {
+        char *t = c->titles[i];
+        int n = 2 + (int) (benchRand(seed) % 5), len = 0;
+        t[0] = '\0';
+        for (int j = 0; j < n; j++) {
+            unsigned long long r = benchRand(seed) % VOCABULARY;
+            const char *w = words[r * r / VOCABULARY];
+            int wl = (int) strlen(w);
+            if (len + wl + 1 > 49) break;
+            if (len) t[len++] = ' ';
+            memcpy(t + len, w, (size_t) wl + 1);
+            len += wl;
+        }
+    }
+}
+
+/* Pieces of random titles: substrings of 4-10 characters or prefixes of 3-8 */
+static void makeQueries(SearchCtx *c, int prefix, unsigned long long *seed) {
+    c->prefix = prefix;
+    c->next = 0;
+    for (int i = 0; i < QUERIES; i++) {
+        const char *t = c->titles[benchRand(seed) % (unsigned long long) c->count];
+        int tl = (int) strlen(t);
+        int len = prefix ? 3 + (int) (benchRand(seed) % 6) : 4 + (int) (benchRand(seed) % 7);
+        if (len > tl) len = tl;
+        int off = prefix ? 0 : (int) (benchRand(seed) % (unsigned long long) (tl - len + 1));
+        memcpy(c->queries[i], t + off, (size_t) len);
+        c->queries[i][len] = '\0';
+    }
+}
+
+static void runIndexSearch(void *p, long long iters) {
+    SearchCtx *c = (SearchCtx *) p;
+    int found = 0;
+    for (long long i = 0; i < iters; i++) {
+        const char *q = c->queries[c->next++ % QUERIES];
+        found += titleIndexSearch(c->index, c->titles[0], sizeof(c->titles[0]), c->count, q, c->prefix, c->results, TITLE_TOP_K);
+    }
+    benchKeep(&found);
+}
+
+/* Brute force: strcasestr over every title, then the same top-K ranking */
+static void runScanSearch(void *p, long long iters) {
+    SearchCtx *c = (SearchCtx *) p;
+    long long found = 0;
+    for (long long i = 0; i < iters; i++) {
+        const char *q = c->queries[c->next++ % QUERIES];
+        size_t ql = strlen(q);
+        int best[TITLE_TOP_K], bestKey[TITLE_TOP_K], n = 0;
+        for (int b = 0; b < c->count; b++) {
+            const char *t = c->titles[b];
+            const char *m = c->prefix ? (strncasecmp(t, q, ql) == 0 ? t : NULL) : strcasestr(t, q);
+            if (!m) continue;
+            size_t tl = strlen(t);
+            int tier = m == t ? (tl == ql ? 0 : 1) : (isalnum((unsigned char) m[-1]) ? 3 : 2);
+            int key = tier * 64 + (int) tl;
+            int j = n < TITLE_TOP_K ? n++ : TITLE_TOP_K;
+            for (; j > 0 && bestKey[j - 1] > key; j--)
+                if (j < TITLE_TOP_K) {
+                    best[j] = best[j - 1];
+                    bestKey[j] = bestKey[j - 1];
+                }
+            if (j < TITLE_TOP_K) {
+                best[j] = b;
+                bestKey[j] = key;
+            }
+        }
+        found += n;
+        benchKeep(best);
+    }
+    benchKeep(&found);
+}
+
+static void measureIndex(BenchSuite *suite, SearchCtx *c) {
+    long long start = benchNow();
+    c->index = titleIndexCreate();
+    for (int i = 0; i < c->count; i++) titleIndexAdd(c->index, i, c->titles[i]);
+    double seconds = (double) (benchNow() - start) * 1e-9;
+    size_t textBytes = 0;
+    for (int i = 0; i < c->count; i++) textBytes += strlen(c->titles[i]);
+    benchMetric(suite, "search/build", seconds, "s");
+    benchMetric(suite, "search/add-per-title", seconds * 1e9 / c->count, "ns");
+    benchMetric(suite, "search/index-bytes-per-title", (double) titleIndexBytes(c->index) / c->count, "B");
+    benchMetric(suite, "search/title-bytes-per-title", (double) textBytes / c->count, "B");
+}
+
+int main(int argc, char **argv) {
+    BenchSuite *suite = benchOpen("task1", argc, argv);
+    StoreCtx ctx, large;
+    openStore(&ctx, CATALOGUE, 0x2545F4914F6CDD1DULL);
+    /* without the 100-book cap: 100000 books by default */
+    openStore(&large, (int) benchScaled(suite, 100000), 0x2545F4914F6CDD1DULL);
+
+    BenchCase cases[] = {
+        {"sale", stock, runSale, NULL, &ctx, benchScaled(suite, 1000000)},
+        {"sale/linear", stock, runSaleLinear, NULL, &ctx, benchScaled(suite, 1000000)},
+        {"lookup/miss", stock, runMissingLookup, NULL, &ctx, benchScaled(suite, 1000000)},
+        {"lookup/miss/linear", stock, runMissingLookupLinear, NULL, &ctx, benchScaled(suite, 1000000)},
+        {"lowStock", lowStockSetup, runLowStock, lowStockTeardown, &ctx, 1000},
+        {"lowStock/printf", lowStockSetup, runLowStockPrintf, lowStockTeardown, &ctx, 1000},
+        {"sale/large", stock, runSale, NULL, &large, 1000000},
+        {"sale/large/linear", stock, runSaleLinear, NULL, &large, 1000},
+        {"lookup/miss/large", stock, runMissingLookup, NULL, &large, 1000000},
+        {"lookup/miss/large/linear", stock, runMissingLookupLinear, NULL, &large, 1000},
+        {"lowStock/large", lowStockSetup, runLowStock, lowStockTeardown, &large, 10},
+        {"lowStock/large/printf", lowStockSetup, runLowStockPrintf, lowStockTeardown, &large, 10},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) benchRun(suite, &cases[i]);
+    /* lowStockSetup puts every other book under 5 copies */
+    benchRate(suite, "lowStock/large", large.count / 2, "rows/s");
+    benchRate(suite, "lowStock/large/printf", large.count / 2, "rows/s");
+    closeStore(&ctx);
+    closeStore(&large);
+
+    /* 5M titles by default */
+    static SearchCtx search, prefix;
+    unsigned long long seed = 77;
+    search.count = (int) benchScaled(suite, 5000000);
+    search.titles = (char (*)[50]) malloc((size_t) search.count * sizeof(search.titles[0]));
+    if (!search.titles) {
+        perror("malloc failed");
+        return 1;
+    }
+    makeTitles(&search, &seed);
+    measureIndex(suite, &search);
+    prefix = search;
+    makeQueries(&search, 0, &seed);
+    makeQueries(&prefix, 1, &seed);
+    BenchCase searchCases[] = {
+        {"search/substring/index", NULL, runIndexSearch, NULL, &search, 256},
+        {"search/substring/strstr", NULL, runScanSearch, NULL, &search, 4},
+        {"search/prefix/index", NULL, runIndexSearch, NULL, &prefix, 256},
+        {"search/prefix/strstr", NULL, runScanSearch, NULL, &prefix, 4},
+    };
+    for (size_t i = 0; i < sizeof(searchCases) / sizeof(searchCases[0]); i++) benchRun(suite, &searchCases[i]);
+    titleIndexFree(search.index);
+    free(search.titles);
+    return benchClose(suite);
+}
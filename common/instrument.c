@@ -0,0 +1,200 @@
+#include "instrument.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+static volatile sig_atomic_t dumpRequested = 0;
+
+static int wantJson(void) {
+    const char *fmt = getenv("PF_METRICS_FORMAT");
+    return fmt && strcmp(fmt, "json") == 0;
+}
+
+static void onDumpSignal(int signo) {
+    (void) signo;
+    dumpRequested = 1;
+}
+
+static void dumpAtExit(void) {
+    pfMetricsDump(stderr, wantJson());
+}
+
+void pfMetricsInstall(int signo) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onDumpSignal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(signo, &sa, NULL);
+    if (getenv("PF_METRICS_AT_EXIT")) atexit(dumpAtExit);
+}
+
+void pfMetricsPoll(void) {
+    if (dumpRequested) {
+        dumpRequested = 0;
+        pfMetricsDump(stderr, wantJson());
+    }
+}
+
+#ifndef PF_INSTRUMENT
+
+void pfMetricsDump(FILE *out, int json) {
+    if (json) fprintf(out, "{\"instrumented\":false,\"metrics\":[]}\n");
+    else fprintf(out, "metrics: not built in (configure with -DPFTHEORY_INSTRUMENT=ON)\n");
+}
+
+#else
+
+#include <pthread.h>
+#include <time.h>
+
+#define PF_MAX_PROBES 32
+#define PF_LINEAR 16                               /* values 0..15 get a bucket each */
+#define PF_BUCKETS (PF_LINEAR + (64 - 4) * 8)
+
+typedef struct PfThreadStats {
+    struct PfThreadStats *next;
+    unsigned long long count[PF_MAX_PROBES];
+    unsigned long long sum[PF_MAX_PROBES];
+    unsigned long long max[PF_MAX_PROBES];
+    unsigned long long hist[PF_MAX_PROBES][PF_BUCKETS];
+} PfThreadStats;
+
+static pthread_mutex_t registryLock = PTHREAD_MUTEX_INITIALIZER;
+static PfProbe *probes[PF_MAX_PROBES + 1];         /* indexed by id, 1-based */
+static int probeCount = 0;
+static PfThreadStats *allThreads = NULL;
+static __thread PfThreadStats *myStats = NULL;
+
+static long long nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int bucketOf(unsigned long long v) {
+    if (v < PF_LINEAR) return (int) v;
+    int e = 63 - __builtin_clzll(v);               /* e >= 4 */
+    return PF_LINEAR + (e - 4) * 8 + (int) ((v >> (e - 3)) & 7);
+}
+
+/* upper bound of a bucket, used when reporting percentiles */
+static unsigned long long bucketTop(int b) {
+    if (b < PF_LINEAR) return (unsigned long long) b;
+    int e = (b - PF_LINEAR) / 8 + 4, sub = (b - PF_LINEAR) % 8;
+    return ((8ULL + (unsigned long long) sub + 1) << (e - 3)) - 1;
+}
+
+/* Slow path: register the probe and/or this thread's storage */
+static int registerProbe(PfProbe *probe) {
+    pthread_mutex_lock(&registryLock);
+    if (probe->id == 0) {
+        if (probeCount < PF_MAX_PROBES) {
+            probes[++probeCount] = probe;
+            probe->id = probeCount;
+        } else {
+            probe->id = -1;                        /* table full: probe ignored */
+        }
+    }
+    pthread_mutex_unlock(&registryLock);
+    return probe->id;
+}
+
+static PfThreadStats *threadStats(void) {
+    if (!myStats) {
+        PfThreadStats *s = (PfThreadStats *) calloc(1, sizeof(PfThreadStats));
+        if (!s) return NULL;
+        pthread_mutex_lock(&registryLock);
+        s->next = allThreads;
+        allThreads = s;
+        pthread_mutex_unlock(&registryLock);
+        myStats = s;
+    }
+    return myStats;
+}
+
+static void record(PfProbe *probe, unsigned long long v) {
+    int id = probe->id ? probe->id : registerProbe(probe);
+    PfThreadStats *s = threadStats();
+    if (id <= 0 || !s) return;
+    id--;
+    s->count[id]++;
+    s->sum[id] += v;
+    if (v > s->max[id]) s->max[id] = v;
+    if (!probe->isCounter) s->hist[id][bucketOf(v)]++;
+}
+
+PfScope pfScopeBegin(PfProbe *probe) {
+    PfScope scope;
+    scope.probe = probe;
+    scope.start = nowNs();
+    return scope;
+}
+
+void pfScopeEnd(PfScope *scope) {
+    long long elapsed = nowNs() - scope->start;
+    record(scope->probe, elapsed > 0 ? (unsigned long long) elapsed : 0);
+}
+
+void pfCount(PfProbe *probe, long long n) {
+    record(probe, n > 0 ? (unsigned long long) n : 0);
+}
+
+static unsigned long long percentile(const unsigned long long *hist, unsigned long long total, double q) {
+    unsigned long long rank = (unsigned long long) (q * (double) total + 0.5), seen = 0;
+    if (rank < 1) rank = 1;
+    for (int b = 0; b < PF_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen >= rank) return bucketTop(b);
+    }
+    return 0;
+}
+
+void pfMetricsDump(FILE *out, int json) {
+    static unsigned long long hist[PF_BUCKETS];
+    pthread_mutex_lock(&registryLock);
+
+    if (json) fprintf(out, "{\"instrumented\":true,\"metrics\":[");
+    else fprintf(out, "%-36s %10s %14s %10s %10s %10s %10s %10s\n", "metric", "count", "total",
+                 "mean", "p50", "p90", "p99", "max");
+
+    for (int id = 0; id < probeCount; id++) {
+        const PfProbe *probe = probes[id + 1];
+        unsigned long long count = 0, sum = 0, max = 0;
+        memset(hist, 0, sizeof(hist));
+        /* per-thread values are read without synchronisation: a snapshot
+         * taken while other threads run may be off by the samples in flight */
+        for (PfThreadStats *s = allThreads; s; s = s->next) {
+            count += s->count[id];
+            sum += s->sum[id];
+            if (s->max[id] > max) max = s->max[id];
+            for (int b = 0; b < PF_BUCKETS; b++) hist[b] += s->hist[id][b];
+        }
+        double mean = count ? (double) sum / (double) count : 0.0;
+
+        if (json) {
+            fprintf(out, "%s{\"name\":\"%s\",\"kind\":\"%s\",\"count\":%llu,\"total\":%llu,"
+                         "\"mean\":%.1f,\"max\":%llu", id ? "," : "", probe->name,
+                    probe->isCounter ? "counter" : "latency_ns", count, sum, mean, max);
+            if (!probe->isCounter)
+                fprintf(out, ",\"p50\":%llu,\"p90\":%llu,\"p99\":%llu",
+                        percentile(hist, count, 0.50), percentile(hist, count, 0.90),
+                        percentile(hist, count, 0.99));
+            fputc('}', out);
+        } else if (probe->isCounter) {
+            fprintf(out, "%-36s %10llu %14llu %10.1f %10s %10s %10s %10llu\n",
+                    probe->name, count, sum, mean, "-", "-", "-", max);
+        } else {
+            fprintf(out, "%-36s %10llu %12.3fms %8.0fns %8lluns %8lluns %8lluns %8lluns\n",
+                    probe->name, count, (double) sum / 1e6, mean,
+                    percentile(hist, count, 0.50), percentile(hist, count, 0.90),
+                    percentile(hist, count, 0.99), max);
+        }
+    }
+    if (json) fprintf(out, "]}\n");
+    fflush(out);
+    pthread_mutex_unlock(&registryLock);
+}
+
+#endif
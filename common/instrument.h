@@ -0,0 +1,70 @@
+#ifndef PFTHEORY_INSTRUMENT_H
+#define PFTHEORY_INSTRUMENT_H
+
+#include <stdio.h>
+
+/* ---- Hot-path instrumentation: counters and latency histograms ----
+ *
+ * Built in only when PF_INSTRUMENT is defined (CMake option
+ * PFTHEORY_INSTRUMENT); otherwise every macro below expands to nothing.
+ *
+ *   PF_TIMED("question6.saveDatabase");    time the enclosing scope
+ *   PF_COUNT("question4.findLRA.scanned", n);   add n to a counter
+ *
+ * Each site owns a static probe that is registered on first use. Samples go
+ * to per-thread storage (no locks or atomics on the hot path) and are merged
+ * when a snapshot is taken. Latencies are kept in log-linear buckets with
+ * 8 sub-buckets per power of two (about 12% relative precision), so
+ * percentiles can be reported without storing samples.
+ */
+
+/* Snapshot of all probes to 'out' as aligned text or one JSON object.
+ * Without PF_INSTRUMENT it prints a one-line note instead. */
+void pfMetricsDump(FILE *out, int json);
+
+/* Dump (to stderr) when 'signo' arrives; the dump happens at the next
+ * pfMetricsPoll() call, outside the signal handler. PF_METRICS_FORMAT=json
+ * in the environment selects JSON. Also dumps at exit if PF_METRICS_AT_EXIT
+ * is set. */
+void pfMetricsInstall(int signo);
+void pfMetricsPoll(void);
+
+#ifdef PF_INSTRUMENT
+
+typedef struct {
+    const char *name;
+    int id;          /* 0 until registered */
+    int isCounter;
+} PfProbe;
+
+typedef struct {
+    PfProbe *probe;
+    long long start;
+} PfScope;
+
+PfScope pfScopeBegin(PfProbe *probe);
+void pfScopeEnd(PfScope *scope);
+void pfCount(PfProbe *probe, long long n);
+
+#define PF_CONCAT_(a, b) a##b
+#define PF_CONCAT(a, b) PF_CONCAT_(a, b)
+
+#define PF_TIMED(name)                                                           \
+    static PfProbe PF_CONCAT(pfProbe_, __LINE__) = {name, 0, 0};                 \
+    PfScope PF_CONCAT(pfScope_, __LINE__) __attribute__((cleanup(pfScopeEnd))) = \
+        pfScopeBegin(&PF_CONCAT(pfProbe_, __LINE__))
+
+#define PF_COUNT(name, n)                                                        \
+    do {                                                                         \
+        static PfProbe pfCounterProbe_ = {name, 0, 1};                           \
+        pfCount(&pfCounterProbe_, (long long) (n));                              \
+    } while (0)
+
+#else
+
+#define PF_TIMED(name) ((void) 0)
+#define PF_COUNT(name, n) ((void) 0)
+
+#endif
+
+#endif
@@ -0,0 +1,202 @@
+#include "outbuf.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+static const char digitPairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const double powersOf10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+#define FIXED_MAX_DECIMALS 9
+#define SPACES 64
+
+static OutBuf shared;
+
+OutBuf *outBegin(void) {
+    fflush(stdout);
+    if (!shared.buf) {
+        shared.buf = (char *) malloc(OUTBUF_SIZE);
+        if (!shared.buf) {
+            perror("malloc failed");
+            exit(1);
+        }
+        shared.cap = OUTBUF_SIZE;
+    }
+    shared.fd = STDOUT_FILENO;
+    shared.len = 0;
+    shared.failed = 0;
+    return &shared;
+}
+
+void outEnd(OutBuf *o) {
+    outFlush(o);
+}
+
+/* write every byte of iov[0..count), resuming after short writes */
+static void writeAll(OutBuf *o, struct iovec *iov, int count) {
+    while (count > 0 && !o->failed) {
+        ssize_t n = writev(o->fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            o->failed = 1;
+            return;
+        }
+        while (count > 0 && (size_t) n >= iov->iov_len) {
+            n -= (ssize_t) iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *) iov->iov_base + n;
+            iov->iov_len -= (size_t) n;
+        }
+    }
+}
+
+void outFlush(OutBuf *o) {
+    struct iovec iov = {o->buf, o->len};
+    if (o->len > 0) writeAll(o, &iov, 1);
+    o->len = 0;
+}
+
+void outWrite(OutBuf *o, const void *p, size_t n) {
+    if (n <= o->cap - o->len) {
+        memcpy(o->buf + o->len, p, n);
+        o->len += n;
+        return;
+    }
+    struct iovec iov[2] = {{o->buf, o->len}, {(void *) p, n}};
+    writeAll(o, o->len > 0 ? iov : iov + 1, o->len > 0 ? 2 : 1);
+    o->len = 0;
+}
+
+static void outSpaces(OutBuf *o, int n) {
+    static const char spaces[SPACES + 1] = "                                                                ";
+    while (n > 0) {
+        int k = n < SPACES ? n : SPACES;
+        outBytes(o, spaces, (size_t) k);
+        n -= k;
+    }
+}
+
+/* digits of v, right-aligned so they end at 'end'; returns the first */
+static char *formatUInt(char *end, unsigned long long v) {
+    char *p = end;
+    while (v >= 100) {
+        unsigned d = (unsigned) (v % 100) * 2;
+        v /= 100;
+        *--p = digitPairs[d + 1];
+        *--p = digitPairs[d];
+    }
+    if (v >= 10) {
+        *--p = digitPairs[v * 2 + 1];
+        *--p = digitPairs[v * 2];
+    } else {
+        *--p = (char) ('0' + v);
+    }
+    return p;
+}
+
+static char *formatInt(char *end, long long v) {
+    if (v >= 0) return formatUInt(end, (unsigned long long) v);
+    char *p = formatUInt(end, 0ULL - (unsigned long long) v);
+    *--p = '-';
+    return p;
+}
+
+static void outPadded(OutBuf *o, const char *s, size_t n, int width, int left) {
+    int pad = width > (int) n ? width - (int) n : 0;
+    if (!left) outSpaces(o, pad);
+    outBytes(o, s, n);
+    if (left) outSpaces(o, pad);
+}
+
+void outInt(OutBuf *o, long long v) {
+    char tmp[24], *end = tmp + sizeof(tmp), *p = formatInt(end, v);
+    outBytes(o, p, (size_t) (end - p));
+}
+
+void outUInt(OutBuf *o, unsigned long long v) {
+    char tmp[24], *end = tmp + sizeof(tmp), *p = formatUInt(end, v);
+    outBytes(o, p, (size_t) (end - p));
+}
+
+void outPadInt(OutBuf *o, long long v, int width, int left) {
+    char tmp[24], *end = tmp + sizeof(tmp), *p = formatInt(end, v);
+    outPadded(o, p, (size_t) (end - p), width, left);
+}
+
+void outPadUInt(OutBuf *o, unsigned long long v, int width, int left) {
+    char tmp[24], *end = tmp + sizeof(tmp), *p = formatUInt(end, v);
+    outPadded(o, p, (size_t) (end - p), width, left);
+}
+
+void outPadStr(OutBuf *o, const char *s, int width, int left) {
+    outPadded(o, s, strlen(s), width, left);
+}
+
+/* v rounded to 'decimals' places as text ending at 'end', or NULL when the
+ * rounding cannot be decided from a double product (a tie or nearly one,
+ * too large, not finite): printf rounds the exact binary value, so those
+ * go to snprintf */
+static char *fixedText(char *end, double v, int decimals) {
+    if (decimals < 0 || decimals > FIXED_MAX_DECIMALS || !isfinite(v)) return NULL;
+    double a = fabs(v) * powersOf10[decimals];
+    if (a >= 4503599627370496.0) return NULL;   /* 2^52: no fraction bits left */
+    double whole = floor(a), frac = a - whole;
+    /* the product is within half an ulp of the exact value */
+    if (fabs(frac - 0.5) <= a * 1e-15) return NULL;
+    unsigned long long q = (unsigned long long) whole + (frac > 0.5);
+    char *p = end;
+    if (decimals > 0) {
+        unsigned long long scale = (unsigned long long) powersOf10[decimals];
+        unsigned long long f = q % scale;
+        q /= scale;
+        for (int i = 0; i < decimals; i++) {
+            *--p = (char) ('0' + f % 10);
+            f /= 10;
+        }
+        *--p = '.';
+    }
+    p = formatUInt(p, q);
+    if (signbit(v)) *--p = '-';
+    return p;
+}
+
+static void outFixedPadded(OutBuf *o, double v, int decimals, int width, int left) {
+    char tmp[48], *end = tmp + sizeof(tmp), *p = fixedText(end, v, decimals);
+    if (p) {
+        outPadded(o, p, (size_t) (end - p), width, left);
+        return;
+    }
+    char small[512];
+    int n = snprintf(small, sizeof(small), "%.*f", decimals, v);
+    if (n < 0) return;
+    if ((size_t) n < sizeof(small)) {
+        outPadded(o, small, (size_t) n, width, left);
+        return;
+    }
+    char *big = (char *) malloc((size_t) n + 1);
+    if (!big) {
+        perror("malloc failed");
+        exit(1);
+    }
+    snprintf(big, (size_t) n + 1, "%.*f", decimals, v);
+    outPadded(o, big, (size_t) n, width, left);
+    free(big);
+}
+
+void outFixed(OutBuf *o, double v, int decimals) {
+    outFixedPadded(o, v, decimals, 0, OUT_RIGHT);
+}
+
+void outPadFixed(OutBuf *o, double v, int decimals, int width, int left) {
+    outFixedPadded(o, v, decimals, width, left);
+}
@@ -0,0 +1,74 @@
+#ifndef PFTHEORY_OUTBUF_H
+#define PFTHEORY_OUTBUF_H
+
+#include <stddef.h>
+#include <string.h>
+
+/* ---- Buffered report output ----
+ *
+ * Report loops format their rows into one large buffer and hand it to the
+ * kernel with write(2) when it fills, instead of one printf per row:
+ *
+ *   OutBuf *o = outBegin();          flushes stdout, so prompts come first
+ *   outPadInt(o, id, 10, OUT_LEFT);  same bytes as printf("%-10d", id)
+ *   outChar(o, ' ');
+ *   outFixed(o, salary, 2);          same bytes as printf("%.2f", salary)
+ *   outEnd(o);                       writes what is left
+ *
+ * The output is byte for byte what the printf formats in the comments
+ * below produce. outBegin() hands out one buffer shared by the process, on
+ * standard output; it is not for use from several threads at once. A write
+ * error is remembered in 'failed' and the rest of the report is dropped.
+ */
+
+#define OUTBUF_SIZE (256u << 10)
+#define OUT_LEFT 1      /* pad on the right, like "%-10d" */
+#define OUT_RIGHT 0
+
+typedef struct {
+    int fd;
+    char *buf;
+    size_t len, cap;
+    int failed;
+} OutBuf;
+
+OutBuf *outBegin(void);
+void outEnd(OutBuf *o);
+void outFlush(OutBuf *o);
+
+/* blocks larger than the free space are written straight from the caller's
+ * memory (writev with the buffer) rather than copied */
+void outWrite(OutBuf *o, const void *p, size_t n);
+
+/* %d, %lld, %zu */
+void outInt(OutBuf *o, long long v);
+void outUInt(OutBuf *o, unsigned long long v);
+/* %-*d / %*d, %*zu */
+void outPadInt(OutBuf *o, long long v, int width, int left);
+void outPadUInt(OutBuf *o, unsigned long long v, int width, int left);
+/* %-*s / %*s */
+void outPadStr(OutBuf *o, const char *s, int width, int left);
+/* %.*f, %-*.*f: fixed point from integers when that is exact, else snprintf */
+void outFixed(OutBuf *o, double v, int decimals);
+void outPadFixed(OutBuf *o, double v, int decimals, int width, int left);
+
+static inline void outChar(OutBuf *o, char c) {
+    if (o->len == o->cap) outFlush(o);
+    o->buf[o->len++] = c;
+}
+
+static inline void outBytes(OutBuf *o, const char *p, size_t n) {
+    if (n <= o->cap - o->len) {
+        memcpy(o->buf + o->len, p, n);
+        o->len += n;
+    } else {
+        outWrite(o, p, n);
+    }
+}
+
+/* %s */
+static inline void outStr(OutBuf *o, const char *s) {
+    outBytes(o, s, strlen(s));
+}
+
+#endif
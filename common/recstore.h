@@ -0,0 +1,241 @@
+#ifndef PFTHEORY_RECSTORE_H
+#define PFTHEORY_RECSTORE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/* ---- Record store: a growable array of records with a hash index ----
+ *
+ * RECSTORE_DEFINE generates the store type and its functions for one record
+ * type, so the key, hash and comparison below are inlined into every probe:
+ *
+ *   #define BOOK_ISBN(b) ((b)->isbn)
+ *   RECSTORE_DEFINE(BookStore, bookStore, Book, int, BOOK_ISBN,
+ *                   recstoreHashInt, RECSTORE_EQ, RECSTORE_ALL)
+ *
+ *   Store        the type: items[0..size) in insertion order, capacity
+ *   prefix       of the functions (bookStoreFind, bookStorePush, ...)
+ *   Type, Key    record type and key type
+ *   KEY(r)       key of the record at r
+ *   HASH(k)      32-bit hash of a key: recstoreHashInt, recstoreHashStr
+ *   EQUAL(a, b)  RECSTORE_EQ for scalars, RECSTORE_STREQ for strings
+ *   INDEXED(r)   whether the record is indexed at all (RECSTORE_ALL, or
+ *                e.g. not a tombstone)
+ *
+ * The index is open addressing with linear probing, at most half full. A
+ * slot keeps the hash next to the item number, so a probe only touches the
+ * record when the hashes agree. When two records share a key the first one
+ * is indexed, so Find agrees with a front-to-back scan (until that one is
+ * forgotten: the next is only found again after Reindex). Items are numbered
+ * with 32 bits.
+ *
+ * Records are plain data: Save writes items[] as they are in memory and
+ * Load appends what a file holds. Code that moves records or changes a key
+ * in place keeps the index right with Forget (before), Remember (after) or,
+ * after bulk moves, Reindex.
+ */
+
+#define RECSTORE_NONE ((size_t) -1)
+
+typedef struct {
+    uint32_t hash;
+    uint32_t ref;       /* item + 1, 0 for an empty slot */
+} RecstoreSlot;
+
+static inline uint32_t recstoreHashInt(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    return (uint32_t) (k ^ (k >> 33));
+}
+
+static inline uint32_t recstoreHashStr(const char *s) {
+    uint32_t h = 2166136261u;
+    while (*s) h = (h ^ (unsigned char) *s++) * 16777619u;
+    return h;
+}
+
+#define RECSTORE_EQ(a, b) ((a) == (b))
+#define RECSTORE_STREQ(a, b) (strcmp((a), (b)) == 0)
+#define RECSTORE_ALL(r) 1
+
+static inline void *recstoreRealloc(void *p, size_t n) {
+    void *q = realloc(p, n);
+    if (!q) {
+        perror("realloc failed");
+        exit(1);
+    }
+    return q;
+}
+
+#define RECSTORE_DEFINE(Store, prefix, Type, Key, KEY, HASH, EQUAL, INDEXED)          \
+typedef struct {                                                                      \
+    Type *items;                                                                      \
+    size_t size, capacity;                                                            \
+    RecstoreSlot *index;                                                              \
+    size_t mask;        /* index slots - 1 */                                         \
+    size_t indexed;                                                                   \
+} Store;                                                                              \
+                                                                                      \
+static inline void prefix##Init(Store *s) {                                           \
+    memset(s, 0, sizeof(*s));                                                         \
+}                                                                                     \
+                                                                                      \
+static inline void prefix##Free(Store *s) {                                           \
+    free(s->items);                                                                   \
+    free(s->index);                                                                   \
+    prefix##Init(s);                                                                  \
+}                                                                                     \
+                                                                                      \
+static __attribute__((noinline, unused)) void prefix##Grow(Store *s, size_t min) {    \
+    size_t cap = s->capacity ? s->capacity * 2 : 8;                                   \
+    while (cap < min) cap *= 2;                                                       \
+    if (min >= UINT32_MAX) {                                                          \
+        fprintf(stderr, #Store ": too many records\n");                               \
+        exit(1);                                                                      \
+    }                                                                                 \
+    s->items = (Type *) recstoreRealloc(s->items, cap * sizeof(Type));                \
+    s->capacity = cap;                                                                \
+}                                                                                     \
+                                                                                      \
+/* room for at least min records */                                                   \
+static inline void prefix##Reserve(Store *s, size_t min) {                            \
+    if (__builtin_expect(min > s->capacity, 0)) prefix##Grow(s, min);                 \
+}                                                                                     \
+                                                                                      \
+/* the slot holding key, or the empty slot where it would go */                       \
+static inline size_t prefix##Slot(const Store *s, Key key, uint32_t h) {              \
+    size_t i = h & s->mask;                                                           \
+    for (;;) {                                                                        \
+        RecstoreSlot e = s->index[i];                                                 \
+        if (!e.ref) return i;                                                         \
+        if (e.hash == h && EQUAL(KEY(&s->items[e.ref - 1]), key)) return i;           \
+        i = (i + 1) & s->mask;                                                        \
+    }                                                                                 \
+}                                                                                     \
+                                                                                      \
+static __attribute__((noinline, unused)) void prefix##Rehash(Store *s, size_t need) { \
+    size_t slots = 16, old = s->index ? s->mask + 1 : 0;                              \
+    RecstoreSlot *from = s->index;                                                    \
+    while (slots < 2 * need) slots *= 2;                                              \
+    s->index = (RecstoreSlot *) recstoreRealloc(NULL, slots * sizeof(RecstoreSlot));  \
+    memset(s->index, 0, slots * sizeof(RecstoreSlot));                                \
+    s->mask = slots - 1;                                                              \
+    for (size_t j = 0; j < old; j++) {                                                \
+        if (!from[j].ref) continue;                                                   \
+        size_t i = from[j].hash & s->mask;                                            \
+        while (s->index[i].ref) i = (i + 1) & s->mask;                                \
+        s->index[i] = from[j];                                                        \
+    }                                                                                 \
+    free(from);                                                                       \
+}                                                                                     \
+                                                                                      \
+/* Index of the first record with this key, or RECSTORE_NONE */                       \
+static inline size_t prefix##Find(const Store *s, Key key) {                          \
+    if (!s->indexed) return RECSTORE_NONE;                                            \
+    RecstoreSlot e = s->index[prefix##Slot(s, key, HASH(key))];                       \
+    return e.ref ? (size_t) e.ref - 1 : RECSTORE_NONE;                                \
+}                                                                                     \
+                                                                                      \
+/* Index items[i] under its key unless the key is indexed already; returns the        \
+ * item the key now finds (i, the earlier one, or i if not INDEXED) */                \
+static inline size_t prefix##Remember(Store *s, size_t i) {                           \
+    const Type *r = &s->items[i];                                                     \
+    if (!(INDEXED(r))) return i;                                                      \
+    if (__builtin_expect(!s->index || 2 * (s->indexed + 1) > s->mask + 1, 0))         \
+        prefix##Rehash(s, s->indexed + 1);                                            \
+    uint32_t h = HASH(KEY(r));                                                        \
+    size_t slot = prefix##Slot(s, KEY(r), h);                                         \
+    if (s->index[slot].ref) return (size_t) s->index[slot].ref - 1;                   \
+    s->index[slot].hash = h;                                                          \
+    s->index[slot].ref = (uint32_t) (i + 1);                                          \
+    s->indexed++;                                                                     \
+    return i;                                                                         \
+}                                                                                     \
+                                                                                      \
+/* Drop items[i] from the index, before its key changes or it is overwritten */       \
+static inline void prefix##Forget(Store *s, size_t i) {                               \
+    const Type *r = &s->items[i];                                                     \
+    if (!s->indexed || !(INDEXED(r))) return;                                         \
+    size_t slot = prefix##Slot(s, KEY(r), HASH(KEY(r)));                              \
+    if (s->index[slot].ref != i + 1) return;                                          \
+    /* close the gap: pull back each later entry the hole is not past */              \
+    for (size_t j = (slot + 1) & s->mask; s->index[j].ref; j = (j + 1) & s->mask) {   \
+        size_t home = s->index[j].hash & s->mask;                                     \
+        if (((j - home) & s->mask) >= ((j - slot) & s->mask)) {                       \
+            s->index[slot] = s->index[j];                                             \
+            slot = j;                                                                 \
+        }                                                                             \
+    }                                                                                 \
+    s->index[slot].ref = 0;                                                           \
+    s->indexed--;                                                                     \
+}                                                                                     \
+                                                                                      \
+/* Append a record (even if its key is taken); returns its index */                   \
+static inline size_t prefix##Push(Store *s, const Type *rec) {                        \
+    prefix##Reserve(s, s->size + 1);                                                  \
+    s->items[s->size] = *rec;                                                         \
+    prefix##Remember(s, s->size);                                                     \
+    return s->size++;                                                                 \
+}                                                                                     \
+                                                                                      \
+/* Append a record whose key is not in the store yet; its index, or                   \
+ * RECSTORE_NONE for a duplicate */                                                   \
+static inline size_t prefix##Add(Store *s, const Type *rec) {                         \
+    prefix##Reserve(s, s->size + 1);                                                  \
+    s->items[s->size] = *rec;                                                         \
+    if (prefix##Remember(s, s->size) != s->size) return RECSTORE_NONE;                \
+    return s->size++;                                                                 \
+}                                                                                     \
+                                                                                      \
+/* Append n records at once, growing the array and the index once */                  \
+static inline void prefix##PushMany(Store *s, const Type *recs, size_t n) {           \
+    prefix##Reserve(s, s->size + n);                                                  \
+    if (2 * (s->indexed + n) > (s->index ? s->mask + 1 : 0))                          \
+        prefix##Rehash(s, s->indexed + n);                                            \
+    memcpy(s->items + s->size, recs, n * sizeof(Type));                               \
+    for (size_t i = s->size; i < s->size + n; i++) prefix##Remember(s, i);            \
+    s->size += n;                                                                     \
+}                                                                                     \
+                                                                                      \
+/* Index every record again, after they were moved or rewritten in bulk */            \
+static inline void prefix##Reindex(Store *s) {                                        \
+    if (s->index) memset(s->index, 0, (s->mask + 1) * sizeof(RecstoreSlot));          \
+    s->indexed = 0;                                                                   \
+    if (2 * s->size > (s->index ? s->mask + 1 : 0)) prefix##Rehash(s, s->size);       \
+    for (size_t i = 0; i < s->size; i++) prefix##Remember(s, i);                      \
+}                                                                                     \
+                                                                                      \
+/* Write the records; 0, or -1 on a short write */                                    \
+static inline int prefix##Save(const Store *s, FILE *f) {                             \
+    return fwrite(s->items, sizeof(Type), s->size, f) == s->size ? 0 : -1;            \
+}                                                                                     \
+                                                                                      \
+/* Append every whole record left in f; returns how many were read */                 \
+static inline size_t prefix##Load(Store *s, FILE *f) {                                \
+    size_t first = s->size, want = 1024;                                              \
+    int sized = 0;                                                                    \
+    long at = ftell(f);                                                               \
+    if (at >= 0 && fseek(f, 0, SEEK_END) == 0) {                                      \
+        long end = ftell(f);                                                          \
+        fseek(f, at, SEEK_SET);                                                       \
+        want = end > at ? (size_t) (end - at) / sizeof(Type) : 0;                     \
+        sized = 1;                                                                    \
+    }                                                                                 \
+    while (want > 0) {                                                                \
+        prefix##Reserve(s, s->size + want);                                           \
+        size_t got = fread(s->items + s->size, sizeof(Type), want, f);                \
+        s->size += got;                                                               \
+        if (got < want || sized) break;                                               \
+        want = s->size - first;         /* a pipe: double as it goes */               \
+    }                                                                                 \
+    if (2 * (s->indexed + s->size - first) > (s->index ? s->mask + 1 : 0))            \
+        prefix##Rehash(s, s->indexed + s->size - first);                              \
+    for (size_t i = first; i < s->size; i++) prefix##Remember(s, i);                  \
+    return s->size - first;                                                           \
+}
+
+#endif
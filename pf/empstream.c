@@ -0,0 +1,478 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include "empstream.h"
+#include "instrument.h"
+
+#define LINE_BYTES 512   // longest CSV line; longer ones are bad records
+
+// ------------------------------------------------------------
+// Double-buffered reader: a thread fills buf[0], buf[1], buf[0], ...
+// while the caller works on the other one
+// ------------------------------------------------------------
+struct Reader {
+    int fd;
+    off_t offset;        // where the next read starts
+    size_t chunk;
+    char *buf[2];
+    size_t len[2];       // 0 = end of file
+    off_t at[2];         // file offset of each buffer
+    int full[2];
+    int error;           // errno of a failed read
+    int stop;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+};
+
+static void *readerMain(void *arg) {
+    struct Reader *r = (struct Reader *) arg;
+    for (int i = 0;; i ^= 1) {
+        pthread_mutex_lock(&r->lock);
+        while (r->full[i] && !r->stop) pthread_cond_wait(&r->cond, &r->lock);
+        int stop = r->stop;
+        off_t offset = r->offset;
+        pthread_mutex_unlock(&r->lock);
+        if (stop) break;
+
+        size_t got = 0;
+        int error = 0;
+        while (got < r->chunk) {
+            ssize_t n = pread(r->fd, r->buf[i] + got, r->chunk - got, offset + (off_t) got);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                error = errno;
+                break;
+            }
+            if (n == 0) break;
+            got += (size_t) n;
+        }
+
+        pthread_mutex_lock(&r->lock);
+        r->len[i] = got;
+        r->at[i] = offset;
+        r->full[i] = 1;
+        r->error = error;
+        r->offset = offset + (off_t) got;
+        pthread_cond_broadcast(&r->cond);
+        pthread_mutex_unlock(&r->lock);
+        if (got == 0 || error) break;
+    }
+    return NULL;
+}
+
+static int readerStart(struct Reader *r, int fd, off_t offset, size_t chunk) {
+    memset(r, 0, sizeof(*r));
+    r->fd = fd;
+    r->offset = offset;
+    r->chunk = chunk;
+    r->buf[0] = (char *) malloc(chunk);
+    r->buf[1] = (char *) malloc(chunk);
+    if (!r->buf[0] || !r->buf[1]) {
+        perror("malloc failed");
+        exit(1);
+    }
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->cond, NULL);
+    if (pthread_create(&r->thread, NULL, readerMain, r) != 0) {
+        fprintf(stderr, "cannot start the reader thread\n");
+        free(r->buf[0]);
+        free(r->buf[1]);
+        return -1;
+    }
+    return 0;
+}
+
+// Wait for buffer i; its length, 0 at the end of the file, -1 on a read error
+static long long readerWait(struct Reader *r, int i) {
+    pthread_mutex_lock(&r->lock);
+    while (!r->full[i]) pthread_cond_wait(&r->cond, &r->lock);
+    long long len = r->error ? -1 : (long long) r->len[i];
+    pthread_mutex_unlock(&r->lock);
+    return len;
+}
+
+// Hand buffer i back to the reader for the chunk after next
+static void readerRelease(struct Reader *r, int i) {
+    pthread_mutex_lock(&r->lock);
+    r->full[i] = 0;
+    pthread_cond_broadcast(&r->cond);
+    pthread_mutex_unlock(&r->lock);
+}
+
+static void readerStop(struct Reader *r) {
+    pthread_mutex_lock(&r->lock);
+    r->stop = 1;
+    pthread_cond_broadcast(&r->cond);
+    pthread_mutex_unlock(&r->lock);
+    pthread_join(r->thread, NULL);
+    pthread_mutex_destroy(&r->lock);
+    pthread_cond_destroy(&r->cond);
+    free(r->buf[0]);
+    free(r->buf[1]);
+}
+
+// ------------------------------------------------------------
+// Per-record work
+// ------------------------------------------------------------
+static void account(struct StreamStats *st, const struct Employee *e) {
+    // strictly greater, so the first of equal salaries wins as in findHighestSalary
+    if (st->records == 0 || e->salary > st->highest.salary) st->highest = *e;
+    if (st->records == 0 || e->salary < st->minSalary) st->minSalary = e->salary;
+    if (st->records == 0 || e->salary > st->maxSalary) st->maxSalary = e->salary;
+    st->totalSalary += e->salary;
+    st->records++;
+}
+
+// The raise of giveBonus(); 1 if the employee got it
+static int bonus(struct Employee *e, const struct StreamOptions *opt, struct StreamStats *st) {
+    if (!opt->applyBonus || !(e->salary < opt->threshold)) return 0;
+    float before = e->salary;
+    e->salary += e->salary * 0.10;  // increase by 10%
+    st->bonused++;
+    st->bonusPaid += e->salary - before;
+    return 1;
+}
+
+static int writeAllAt(int fd, const char *p, size_t n, off_t off) {
+    while (n > 0) {
+        ssize_t w = pwrite(fd, p, n, off);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        n -= (size_t) w;
+        off += w;
+    }
+    return 0;
+}
+
+// ------------------------------------------------------------
+// Binary files
+// ------------------------------------------------------------
+static int streamBinary(int fd, const struct StreamOptions *opt, struct StreamStats *st) {
+    const size_t rec = sizeof(struct Employee);
+    size_t chunk = opt->chunkBytes / rec * rec;
+    if (chunk == 0) chunk = rec;
+    struct Reader r;
+    if (readerStart(&r, fd, (off_t) sizeof(struct EmpFileHeader), chunk) != 0) return -1;
+
+    int failed = 0, dirty = 0;
+    for (int i = 0;; i ^= 1) {
+        long long len = readerWait(&r, i);
+        if (len < 0) {
+            errno = r.error;
+            perror("read failed");
+            failed = 1;
+            break;
+        }
+        if (len == 0) break;
+        PF_TIMED("question3.stream.chunk");
+        char *buf = r.buf[i];
+        size_t n = (size_t) len / rec, first = n, last = 0;
+        st->badRecords += (size_t) len % rec != 0;  // a cut-off last record
+        st->bytes += len;
+        for (size_t k = 0; k < n; k++) {
+            struct Employee e;
+            memcpy(&e, buf + k * rec, rec);
+            account(st, &e);
+            if (bonus(&e, opt, st)) {
+                memcpy(buf + k * rec, &e, rec);
+                if (first == n) first = k;
+                last = k;
+            }
+        }
+        if (first < n) {
+            // only the span that changed goes back, at the same place
+            if (writeAllAt(fd, buf + first * rec, (last - first + 1) * rec, r.at[i] + (off_t) (first * rec)) != 0) {
+                perror("write failed");
+                failed = 1;
+                break;
+            }
+            dirty = 1;
+        } else {
+            // a read-only pass should not push the rest of the page cache out
+            posix_fadvise(fd, r.at[i], (off_t) len, POSIX_FADV_DONTNEED);
+        }
+        readerRelease(&r, i);
+    }
+    readerStop(&r);
+    if (!failed && dirty && fsync(fd) != 0) {
+        perror("fsync failed");
+        failed = 1;
+    }
+    return failed ? -1 : 0;
+}
+
+// ------------------------------------------------------------
+// CSV files
+// ------------------------------------------------------------
+// Copy one comma-separated field (truncated to fit) and move past the comma
+static const char *field(const char *s, const char *end, char *out, size_t cap) {
+    size_t n = 0;
+    while (s < end && *s != ',') {
+        if (n + 1 < cap) out[n++] = *s;
+        s++;
+    }
+    out[n] = '\0';
+    return s < end ? s + 1 : NULL;
+}
+
+static int parseLine(const char *s, size_t n, struct Employee *e) {
+    char id[32], salary[64];
+    const char *end = s + n;
+    if (n > 0 && end[-1] == '\r') end--;
+    if (!(s = field(s, end, id, sizeof(id)))) return -1;
+    if (!(s = field(s, end, e->name, sizeof(e->name)))) return -1;
+    if (!(s = field(s, end, e->designation, sizeof(e->designation)))) return -1;
+    if (field(s, end, salary, sizeof(salary))) return -1;   // a fifth field
+    char *stop;
+    long v = strtol(id, &stop, 10);
+    if (stop == id || *stop) return -1;
+    e->id = (int) v;
+    e->salary = strtof(salary, &stop);
+    if (stop == salary || *stop) return -1;
+    return 0;
+}
+
+struct CsvState {
+    const struct StreamOptions *opt;
+    struct StreamStats *st;
+    FILE *out;            // rewritten file, or NULL
+    long long lines;
+    char carry[LINE_BYTES];   // start of a line cut by the end of a chunk
+    size_t carryLen;
+    int carryTooLong;
+};
+
+static void csvLine(struct CsvState *cs, const char *s, size_t n, int newline) {
+    struct Employee e;
+    if (parseLine(s, n, &e) == 0) {
+        account(cs->st, &e);
+        if (bonus(&e, cs->opt, cs->st) && cs->out) {
+            fprintf(cs->out, "%d,%s,%s,%.2f%s", e.id, e.name, e.designation, e.salary, newline ? "\n" : "");
+            cs->lines++;
+            return;
+        }
+    } else if (cs->lines > 0 && n > 0) {
+        // not a record (the first line may be a header)
+        cs->st->badRecords++;
+    }
+    cs->lines++;
+    if (cs->out) {
+        fwrite(s, 1, n, cs->out);
+        if (newline) fputc('\n', cs->out);
+    }
+}
+
+static void csvChunk(struct CsvState *cs, const char *buf, size_t len) {
+    const char *p = buf, *end = buf + len;
+    while (p < end) {
+        const char *nl = (const char *) memchr(p, '\n', (size_t) (end - p));
+        size_t n = (size_t) ((nl ? nl : end) - p);
+        if (cs->carryTooLong || cs->carryLen + n > sizeof(cs->carry)) {
+            // too long to be a record: copied through as it is
+            if (cs->out) {
+                if (!cs->carryTooLong) fwrite(cs->carry, 1, cs->carryLen, cs->out);
+                fwrite(p, 1, n, cs->out);
+                if (nl) fputc('\n', cs->out);
+            }
+            cs->carryTooLong = 1;
+            cs->carryLen = 0;
+            if (!nl) return;
+            cs->st->badRecords++;
+            cs->lines++;
+            cs->carryTooLong = 0;
+        } else if (!nl) {
+            // keep the start of the line for the next chunk
+            memcpy(cs->carry + cs->carryLen, p, n);
+            cs->carryLen += n;
+            return;
+        } else if (cs->carryLen) {
+            memcpy(cs->carry + cs->carryLen, p, n);
+            csvLine(cs, cs->carry, cs->carryLen + n, 1);
+            cs->carryLen = 0;
+        } else {
+            csvLine(cs, p, n, 1);
+        }
+        p = nl + 1;
+    }
+}
+
+static int streamCsv(int fd, const char *path, const struct StreamOptions *opt, struct StreamStats *st) {
+    struct CsvState cs;
+    memset(&cs, 0, sizeof(cs));
+    cs.opt = opt;
+    cs.st = st;
+    char *tmp = NULL;
+    if (opt->applyBonus) {
+        size_t len = strlen(path);
+        tmp = (char *) malloc(len + 5);
+        if (!tmp) {
+            perror("malloc failed");
+            exit(1);
+        }
+        memcpy(tmp, path, len);
+        memcpy(tmp + len, ".tmp", 5);
+        cs.out = fopen(tmp, "w");
+        if (!cs.out) {
+            perror("cannot write the rewritten file");
+            free(tmp);
+            return -1;
+        }
+        // the new file replaces the old one, permissions and all
+        struct stat src;
+        if (fstat(fd, &src) != 0 || fchmod(fileno(cs.out), src.st_mode & 07777) != 0) {
+            perror("cannot copy the file's permissions");
+            fclose(cs.out);
+            unlink(tmp);
+            free(tmp);
+            return -1;
+        }
+        setvbuf(cs.out, NULL, _IOFBF, 1 << 20);
+    }
+
+    struct Reader r;
+    if (readerStart(&r, fd, 0, opt->chunkBytes) != 0) {
+        if (cs.out) fclose(cs.out);
+        if (tmp) unlink(tmp);
+        free(tmp);
+        return -1;
+    }
+    int failed = 0;
+    for (int i = 0;; i ^= 1) {
+        long long len = readerWait(&r, i);
+        if (len < 0) {
+            errno = r.error;
+            perror("read failed");
+            failed = 1;
+            break;
+        }
+        if (len == 0) break;
+        PF_TIMED("question3.stream.chunk");
+        csvChunk(&cs, r.buf[i], (size_t) len);
+        st->bytes += len;
+        posix_fadvise(fd, r.at[i], (off_t) len, POSIX_FADV_DONTNEED);
+        readerRelease(&r, i);
+    }
+    readerStop(&r);
+    // a last line without a newline
+    if (!failed && cs.carryTooLong) st->badRecords++;
+    else if (!failed && cs.carryLen) csvLine(&cs, cs.carry, cs.carryLen, 0);
+
+    if (cs.out) {
+        if (fflush(cs.out) != 0 || ferror(cs.out) || fsync(fileno(cs.out)) != 0) failed = 1;
+        if (fclose(cs.out) != 0) failed = 1;
+        if (!failed && rename(tmp, path) != 0) failed = 1;
+        if (failed) {
+            perror("cannot rewrite the file");
+            unlink(tmp);
+        }
+        free(tmp);
+    }
+    return failed ? -1 : 0;
+}
+
+// ------------------------------------------------------------
+// Entry points
+// ------------------------------------------------------------
+int saveEmployees(const char *path, const EmployeeStore *staff) {
+    struct EmpFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, EMP_FILE_MAGIC, sizeof(h.magic));
+    h.recordSize = (int) sizeof(struct Employee);
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror("cannot open file");
+        return -1;
+    }
+    int failed = fwrite(&h, sizeof(h), 1, f) != 1 || employeeStoreSave(staff, f) != 0;
+    if (fclose(f) != 0) failed = 1;
+    if (failed) {
+        perror("write failed");
+        return -1;
+    }
+    return 0;
+}
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+int streamEmployees(const char *path, const struct StreamOptions *opt, struct StreamStats *st) {
+    struct StreamOptions o = *opt;
+    if (o.chunkBytes == 0) o.chunkBytes = STREAM_CHUNK;
+    memset(st, 0, sizeof(*st));
+    double start = nowSeconds();
+
+    // CSV is only read (the bonus goes to a new file); a binary file is
+    // opened again for writing once its header says it is one
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("cannot open file");
+        return -1;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    struct EmpFileHeader h;
+    ssize_t got = pread(fd, &h, sizeof(h), 0);
+    int result;
+    if (got == (ssize_t) sizeof(h) && memcmp(h.magic, EMP_FILE_MAGIC, sizeof(h.magic)) == 0) {
+        if (h.recordSize != (int) sizeof(struct Employee)) {
+            fprintf(stderr, "%s: records of %d bytes, expected %d\n", path, h.recordSize,
+                    (int) sizeof(struct Employee));
+            close(fd);
+            return -1;
+        }
+        if (o.applyBonus) {
+            int rw = open(path, O_RDWR);
+            close(fd);
+            if (rw < 0) {
+                perror("cannot open file for writing");
+                return -1;
+            }
+            fd = rw;
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+        result = streamBinary(fd, &o, st);
+    } else {
+        result = streamCsv(fd, path, &o, st);
+    }
+    close(fd);
+
+    st->seconds = nowSeconds() - start;
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) st->peakRssKb = ru.ru_maxrss;
+    return result;
+}
+
+void printStreamStats(const struct StreamStats *st, const struct StreamOptions *opt, FILE *out) {
+    double rate = st->seconds > 0 ? (double) st->records / st->seconds : 0;
+    double mb = (double) st->bytes / (1 << 20);
+    fprintf(out, "\nStreamed %lld employees (%.1f MB) in %.2f s: %.0f records/s, %.1f MB/s, peak RSS %.1f MB\n",
+            st->records, mb, st->seconds, rate, st->seconds > 0 ? mb / st->seconds : 0,
+            (double) st->peakRssKb / 1024);
+    if (st->badRecords) fprintf(out, "Skipped %lld malformed records\n", st->badRecords);
+    if (st->records == 0) return;
+
+    fprintf(out, "\nEmployee with Highest Salary:\n");
+    fprintf(out, "ID: %d\n", st->highest.id);
+    fprintf(out, "Name: %s\n", st->highest.name);
+    fprintf(out, "Designation: %s\n", st->highest.designation);
+    fprintf(out, "Salary: %.2f\n", st->highest.salary);
+
+    fprintf(out, "\nSalaries: total %.2f, mean %.2f, min %.2f, max %.2f\n", st->totalSalary,
+            st->totalSalary / (double) st->records, st->minSalary, st->maxSalary);
+    if (opt->applyBonus)
+        fprintf(out, "Bonus: 10%% to %lld employees below %.2f (%.2f in total); file rewritten\n",
+                st->bonused, opt->threshold, st->bonusPaid);
+}
@@ -0,0 +1,56 @@
+#ifndef PF_EMPSTREAM_H
+#define PF_EMPSTREAM_H
+
+#include <stdio.h>
+#include "question3.h"
+
+// ------------------------------------------------------------
+// Streaming mode: one pass over an employee file of any size
+// ------------------------------------------------------------
+// The file is read in fixed-size chunks by a reader thread into two
+// buffers, so the next chunk is being read while this one is processed.
+// Memory stays at two chunks whatever the size of the file.
+//
+// Two formats are understood:
+// - binary: an EmpFileHeader followed by struct Employee records as they
+//   are in memory. The bonus is written back in place, one chunk at a time.
+// - CSV: "id,name,designation,salary" lines (a first line that is not a
+//   record is taken as a header). A raise can change the length of a line,
+//   so the bonus pass writes the file anew next to it and renames it over.
+
+#define EMP_FILE_MAGIC "PFEMPLY1"
+#define STREAM_CHUNK (8u << 20)    // default bytes per chunk
+
+struct EmpFileHeader {
+    char magic[8];
+    int recordSize;       // sizeof(struct Employee) of the writer
+    int reserved;
+};
+
+struct StreamOptions {
+    size_t chunkBytes;    // 0 for STREAM_CHUNK
+    int applyBonus;       // give the giveBonus() raise and rewrite the file
+    float threshold;
+};
+
+struct StreamStats {
+    long long records;
+    long long badRecords;     // CSV lines that do not parse, a cut-off last record
+    long long bytes;
+    struct Employee highest;  // first employee with the highest salary
+    double totalSalary;       // salaries as read, before any bonus
+    float minSalary;
+    float maxSalary;
+    long long bonused;
+    double bonusPaid;
+    double seconds;
+    long peakRssKb;
+};
+
+// Write employees as a binary employee file. 0 or -1 (message printed)
+int saveEmployees(const char *path, const EmployeeStore *staff);
+// One pass over 'path'. 0 on success, -1 on error (message printed)
+int streamEmployees(const char *path, const struct StreamOptions *opt, struct StreamStats *st);
+void printStreamStats(const struct StreamStats *st, const struct StreamOptions *opt, FILE *out);
+
+#endif
@@ -0,0 +1,196 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "lazyfile.h"
+#include "linetree.h"
+#include "instrument.h"
+
+struct LazyFile {
+    int fd;
+    const char *data;         /* the mapping, NULL for an empty file */
+    size_t size;
+    struct stat st;           /* of the mapped file, taken at open */
+
+    pthread_t indexer;
+    int indexerStarted;
+    pthread_mutex_t lock;     /* guards everything below */
+    pthread_cond_t grown;     /* signalled whenever a checkpoint is added */
+    size_t *checkpoints;      /* checkpoints[i] = offset of line i * LAZY_CHECKPOINT */
+    size_t cpCount, cpCap;
+    size_t lines;             /* lines scanned so far */
+    int complete;
+    int cancel;
+};
+
+/* append a checkpoint; called with the lock held */
+static int addCheckpoint(LazyFile *lf, size_t offset) {
+    if (lf->cpCount == lf->cpCap) {
+        size_t cap = lf->cpCap ? lf->cpCap * 2 : 1024;
+        size_t *grown = (size_t *) realloc(lf->checkpoints, cap * sizeof(size_t));
+        if (!grown) return -1;
+        lf->checkpoints = grown;
+        lf->cpCap = cap;
+    }
+    lf->checkpoints[lf->cpCount++] = offset;
+    return 0;
+}
+
+static void *indexerMain(void *arg) {
+    LazyFile *lf = (LazyFile *) arg;
+    size_t pos = 0, line = 0;
+    int failed = 0;
+
+    while (pos < lf->size && !failed) {
+        const char *nl = (const char *) memchr(lf->data + pos, '\n', lf->size - pos);
+        pos = nl ? (size_t) (nl - lf->data) + 1 : lf->size;
+        line++;
+        if (line % LAZY_CHECKPOINT == 0 && pos < lf->size) {
+            pthread_mutex_lock(&lf->lock);
+            failed = addCheckpoint(lf, pos) != 0 || lf->cancel;
+            lf->lines = line;
+            pthread_cond_broadcast(&lf->grown);
+            pthread_mutex_unlock(&lf->lock);
+        }
+    }
+
+    pthread_mutex_lock(&lf->lock);
+    /* without the full index lookups fall back to walking from the last checkpoint */
+    lf->lines = line;
+    lf->complete = 1;
+    pthread_cond_broadcast(&lf->grown);
+    pthread_mutex_unlock(&lf->lock);
+    return NULL;
+}
+
+LazyFile *lazyOpen(const char *filename) {
+    PF_TIMED("question5.lazyOpen");
+    LazyFile *lf = (LazyFile *) calloc(1, sizeof(LazyFile));
+    if (!lf) {
+        perror("calloc failed");
+        return NULL;
+    }
+    lf->fd = open(filename, O_RDONLY);
+    if (lf->fd < 0) {
+        perror("open for read failed");
+        free(lf);
+        return NULL;
+    }
+    if (fstat(lf->fd, &lf->st) != 0) {
+        perror("fstat failed");
+        close(lf->fd);
+        free(lf);
+        return NULL;
+    }
+    lf->size = (size_t) lf->st.st_size;
+    if (lf->size > 0) {
+        void *map = mmap(NULL, lf->size, PROT_READ, MAP_PRIVATE, lf->fd, 0);
+        if (map == MAP_FAILED) {
+            perror("mmap failed");
+            close(lf->fd);
+            free(lf);
+            return NULL;
+        }
+        lf->data = (const char *) map;
+    }
+    pthread_mutex_init(&lf->lock, NULL);
+    pthread_cond_init(&lf->grown, NULL);
+    addCheckpoint(lf, 0);
+
+    if (lf->size == 0) {
+        lf->complete = 1;
+    } else if (pthread_create(&lf->indexer, NULL, indexerMain, lf) == 0) {
+        lf->indexerStarted = 1;
+    } else {
+        /* no thread: index synchronously, the file is still usable */
+        indexerMain(lf);
+    }
+    return lf;
+}
+
+void lazyClose(LazyFile *lf) {
+    if (!lf) return;
+    if (lf->indexerStarted) {
+        pthread_mutex_lock(&lf->lock);
+        lf->cancel = 1;
+        pthread_mutex_unlock(&lf->lock);
+        pthread_join(lf->indexer, NULL);
+    }
+    if (lf->data) munmap((void *) lf->data, lf->size);
+    close(lf->fd);
+    pthread_mutex_destroy(&lf->lock);
+    pthread_cond_destroy(&lf->grown);
+    free(lf->checkpoints);
+    free(lf);
+}
+
+const char *lazyLine(LazyFile *lf, size_t index, size_t *len) {
+    size_t cp = index / LAZY_CHECKPOINT, offset;
+
+    pthread_mutex_lock(&lf->lock);
+    while (lf->cpCount <= cp && !lf->complete) pthread_cond_wait(&lf->grown, &lf->lock);
+    if (lf->cpCount <= cp) {
+        /* scan finished early: the file ends before that checkpoint (or
+         * the index could not grow), walk from the last one we have */
+        cp = lf->cpCount - 1;
+    }
+    offset = lf->checkpoints[cp];
+    pthread_mutex_unlock(&lf->lock);
+
+    /* walk to the line from its checkpoint */
+    size_t line = cp * LAZY_CHECKPOINT;
+    while (line < index && offset < lf->size) {
+        const char *nl = (const char *) memchr(lf->data + offset, '\n', lf->size - offset);
+        offset = nl ? (size_t) (nl - lf->data) + 1 : lf->size;
+        line++;
+    }
+    if (offset >= lf->size) return NULL;
+
+    const char *nl = (const char *) memchr(lf->data + offset, '\n', lf->size - offset);
+    size_t end = nl ? (size_t) (nl - lf->data) : lf->size;
+    if (len) *len = end - offset;
+    return lf->data + offset;
+}
+
+size_t lazyLinesIndexed(LazyFile *lf, int *complete) {
+    pthread_mutex_lock(&lf->lock);
+    size_t lines = lf->lines;
+    if (complete) *complete = lf->complete;
+    pthread_mutex_unlock(&lf->lock);
+    return lines;
+}
+
+size_t lazyLineCount(LazyFile *lf) {
+    pthread_mutex_lock(&lf->lock);
+    while (!lf->complete) pthread_cond_wait(&lf->grown, &lf->lock);
+    size_t lines = lf->lines;
+    pthread_mutex_unlock(&lf->lock);
+    return lines;
+}
+
+size_t lazyFileSize(const LazyFile *lf) {
+    return lf->size;
+}
+
+const struct stat *lazyFileStat(const LazyFile *lf) {
+    return &lf->st;
+}
+
+LtNode *lazyBuildTree(LazyFile *lf) {
+    PF_TIMED("question5.lazyBuildTree");
+    LtBuilder b;
+    ltBuilderInit(&b);
+    size_t pos = 0;
+    while (pos < lf->size) {
+        const char *nl = (const char *) memchr(lf->data + pos, '\n', lf->size - pos);
+        size_t end = nl ? (size_t) (nl - lf->data) : lf->size;
+        ltBuilderAdd(&b, lf->data + pos, end - pos);
+        pos = end + 1;
+    }
+    return ltBuilderFinish(&b);
+}
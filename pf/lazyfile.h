@@ -0,0 +1,44 @@
+#ifndef PF_LAZYFILE_H
+#define PF_LAZYFILE_H
+
+#include <stddef.h>
+#include <sys/stat.h>
+
+/* ---- Lazily opened file ----
+ *
+ * The file is mapped into memory and can be read at once: the first lines
+ * need no index. A background thread scans the mapping and records the
+ * byte offset of every LAZY_CHECKPOINT-th line. Looking up line N waits
+ * only until the scan has passed the checkpoint before N, then walks at
+ * most LAZY_CHECKPOINT lines from there.
+ */
+
+#define LAZY_CHECKPOINT 1024   /* lines between two index entries */
+
+typedef struct LazyFile LazyFile;
+typedef struct LtNode LtNode;
+
+/* NULL on error (message printed) */
+LazyFile *lazyOpen(const char *filename);
+void lazyClose(LazyFile *lf);
+
+/* Line 'index' (0-based, not NUL-terminated, without its '\n'). Blocks
+ * until the index covers it; NULL if the file has fewer lines. The text
+ * stays valid until lazyClose(). */
+const char *lazyLine(LazyFile *lf, size_t index, size_t *len);
+
+/* Lines indexed so far; *complete (if not NULL) is set once the scan is done */
+size_t lazyLinesIndexed(LazyFile *lf, int *complete);
+
+/* Total number of lines (waits for the scan to finish) */
+size_t lazyLineCount(LazyFile *lf);
+
+size_t lazyFileSize(const LazyFile *lf);
+
+/* fstat() of the file as it was mapped, whatever has happened at its path since */
+const struct stat *lazyFileStat(const LazyFile *lf);
+
+/* Copy the whole file into a line tree (see linetree.h) */
+LtNode *lazyBuildTree(LazyFile *lf);
+
+#endif
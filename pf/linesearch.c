@@ -0,0 +1,415 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "linesearch.h"
+#include "linetree.h"
+#include "instrument.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PF_HAVE_X86 1
+#endif
+
+/* below this many lines per worker a thread costs more than it saves */
+#define MIN_LINES_PER_THREAD 32768
+#define MAX_THREADS 64
+
+/* ---- Helper: safe allocation wrappers ---- */
+
+static void *xmalloc(size_t n) {
+    void *p = malloc(n);
+    if (!p) {
+        perror("malloc failed");
+        fprintf(stderr, "Fatal: allocation of %zu bytes failed\n", n);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static void *xrealloc(void *ptr, size_t n) {
+    void *p = realloc(ptr, n);
+    if (!p) {
+        perror("realloc failed");
+        fprintf(stderr, "Fatal: reallocation to %zu bytes failed\n", n);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+/* ---- Search kernels ----
+ * All kernels need m >= 2 (single bytes go to memchr) and only load whole
+ * vectors while they stay inside hay[0..n). The last, partial block is
+ * covered by one more vector that ends exactly at the end of the haystack,
+ * with the candidates already checked masked off, so short lines (the
+ * common case in an editor buffer) never fall back to a byte loop.
+ */
+
+typedef const char *(*FindFn)(const char *, size_t, const char *, size_t);
+
+static const char *findScalar(const char *s, size_t n, const char *needle, size_t m) {
+    const char first = needle[0], last = needle[m - 1];
+    for (size_t i = 0; i + m <= n; ++i) {
+        if (s[i] == first && s[i + m - 1] == last && memcmp(s + i + 1, needle + 1, m - 2) == 0)
+            return s + i;
+    }
+    return NULL;
+}
+
+#ifdef PF_HAVE_X86
+
+/* verify candidates at s + i + bit for every set bit, lowest first */
+static inline const char *verify(const char *s, size_t i, unsigned mask, const char *needle, size_t m) {
+    while (mask) {
+        unsigned bit = (unsigned) __builtin_ctz(mask);
+        if (memcmp(s + i + bit + 1, needle + 1, m - 2) == 0) return s + i + bit;
+        mask &= mask - 1;
+    }
+    return NULL;
+}
+
+static const char *findSse2(const char *s, size_t n, const char *needle, size_t m) {
+    size_t positions = n - m + 1;
+    if (positions < 16) return findScalar(s, n, needle, m);
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[m - 1]);
+    const char *hit;
+    size_t i = 0;
+    for (;; i += 16) {
+        unsigned drop = 0;
+        if (i + 16 > positions) {          /* final block, overlapping the previous one */
+            size_t j = positions - 16;
+            drop = (unsigned) (i - j);
+            i = j;
+        }
+        __m128i bf = _mm_loadu_si128((const __m128i *) (s + i));
+        __m128i bl = _mm_loadu_si128((const __m128i *) (s + i + m - 1));
+        unsigned mask = (unsigned) _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(first, bf), _mm_cmpeq_epi8(last, bl)));
+        mask &= ~((1u << drop) - 1);
+        if (mask && (hit = verify(s, i, mask, needle, m))) return hit;
+        if (i + 16 >= positions) return NULL;
+    }
+}
+
+__attribute__((target("avx2")))
+static const char *findAvx2(const char *s, size_t n, const char *needle, size_t m) {
+    size_t positions = n - m + 1;
+    if (positions < 32) return findSse2(s, n, needle, m);
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+    const char *hit;
+    size_t i = 0;
+    for (;; i += 32) {
+        unsigned drop = 0;
+        if (i + 32 > positions) {          /* final block, overlapping the previous one */
+            size_t j = positions - 32;
+            drop = (unsigned) (i - j);
+            i = j;
+        }
+        __m256i bf = _mm256_loadu_si256((const __m256i *) (s + i));
+        __m256i bl = _mm256_loadu_si256((const __m256i *) (s + i + m - 1));
+        unsigned mask = (unsigned) _mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(first, bf), _mm256_cmpeq_epi8(last, bl)));
+        mask &= ~((1u << drop) - 1);
+        if (mask && (hit = verify(s, i, mask, needle, m))) return hit;
+        if (i + 32 >= positions) return NULL;
+    }
+}
+
+#endif
+
+static FindFn kernel = NULL;
+static pthread_once_t kernelOnce = PTHREAD_ONCE_INIT;
+
+/* picked once; the CPU does not change under us */
+static void initKernel(void) {
+#ifdef PF_HAVE_X86
+    __builtin_cpu_init();
+    kernel = __builtin_cpu_supports("avx2") ? findAvx2 : findSse2;
+#else
+    kernel = findScalar;
+#endif
+}
+
+static FindFn currentKernel(void) {
+    pthread_once(&kernelOnce, initKernel);
+    return kernel;
+}
+
+/* m >= 1; the kernel is passed in so per-chunk calls skip the dispatch */
+static inline const char *findWith(FindFn fn, const char *hay, size_t n, const char *needle, size_t m) {
+    if (m > n) return NULL;
+    if (m == 1) return (const char *) memchr(hay, needle[0], n);
+    return fn(hay, n, needle, m);
+}
+
+const char *findSubstring(const char *hay, size_t n, const char *needle, size_t m) {
+    if (m == 0) return hay;
+    return findWith(currentKernel(), hay, n, needle, m);
+}
+
+/* ---- Work split across line ranges ---- */
+
+int searchThreads(size_t lines) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    size_t byLines = lines / MIN_LINES_PER_THREAD;
+    size_t t = byLines < (size_t) cpus ? byLines : (size_t) cpus;
+    if (t > MAX_THREADS) t = MAX_THREADS;
+    return t < 1 ? 1 : (int) t;
+}
+
+enum { SEARCH_FIRST, SEARCH_ALL, SEARCH_REPLACE };
+
+typedef struct {
+    const LtLeafList *leaves;
+    size_t lo, hi;                 /* leaf range [lo, hi) */
+    size_t fromLine;               /* SEARCH_FIRST: skip lines before this one */
+    const char *needle, *repl;
+    size_t m, r;
+    int mode;
+    size_t *bestLine;              /* SEARCH_FIRST: lowest line found by any worker */
+    LtNode **rebuilt;              /* SEARCH_REPLACE: new leaf per changed leaf, else NULL */
+    /* results */
+    MatchList found;
+    size_t replaced, linesChanged;
+} SearchJob;
+
+static void pushMatch(MatchList *list, size_t line, size_t col) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 16;
+        list->items = (LineMatch *) xrealloc(list->items, list->capacity * sizeof(LineMatch));
+    }
+    list->items[list->count].line = line;
+    list->items[list->count].col = col;
+    list->count++;
+}
+
+/* Rebuild one chunk with every match replaced. 'hits' holds the k match
+ * offsets already found, so the new size is known before copying; line
+ * starts move by the size change of the matches before them. */
+static LtNode *rebuildLeaf(const LtNode *leaf, const char *old, const size_t *off, const size_t *hits,
+                           size_t k, const char *repl, size_t m, size_t r) {
+    size_t count = ltLeafLines(leaf), len = off[count];
+    char *out = (char *) xmalloc(len - k * m + k * r + 1);
+    size_t *newOff = (size_t *) xmalloc((count + 1) * sizeof(size_t));
+
+    char *w = out;
+    size_t from = 0, j = 0;
+    for (size_t h = 0; h < k; ++h) {
+        memcpy(w, old + from, hits[h] - from);
+        w += hits[h] - from;
+        memcpy(w, repl, r);
+        w += r;
+        from = hits[h] + m;
+    }
+    memcpy(w, old + from, len - from);
+
+    for (size_t li = 0; li <= count; ++li) {
+        while (j < k && hits[j] < off[li]) j++;
+        newOff[li] = off[li] - j * m + j * r;
+    }
+    LtNode *fresh = ltNewLeaf(out, newOff, count);
+    free(newOff);
+    return fresh;
+}
+
+static void *searchWorker(void *arg) {
+    SearchJob *job = (SearchJob *) arg;
+    FindFn fn = currentKernel();
+    size_t *hits = NULL, hitCap = 0;
+    LtScratch scratch = {NULL, 0};
+
+    for (size_t j = job->lo; j < job->hi; ++j) {
+        const LtNode *leaf = job->leaves->leaf[j];
+        size_t first = job->leaves->firstLine[j];
+        if (job->mode == SEARCH_FIRST && __atomic_load_n(job->bestLine, __ATOMIC_RELAXED) < first) break;
+
+        /* a chunk is searched as one block: the needle holds no '\n', so
+         * a match never spans two lines */
+        const size_t *off;
+        const char *text = ltLeafScan(leaf, &scratch, &off);
+        size_t count = ltLeafLines(leaf), end = off[count], li = 0, k = 0, lastLine = SIZE_MAX;
+        size_t pos = 0;
+        if (job->mode == SEARCH_FIRST && job->fromLine > first) {
+            li = job->fromLine - first;
+            pos = off[li];
+        }
+        const char *hit;
+        while ((hit = findWith(fn, text + pos, end - pos, job->needle, job->m))) {
+            size_t at = (size_t) (hit - text);
+            while (off[li + 1] <= at) li++;
+            if (job->mode == SEARCH_FIRST) {
+                pushMatch(&job->found, first + li, at - off[li]);
+                /* publish so workers on later ranges can stop */
+                size_t line = first + li;
+                size_t cur = __atomic_load_n(job->bestLine, __ATOMIC_RELAXED);
+                while (line < cur && !__atomic_compare_exchange_n(job->bestLine, &cur, line, 0,
+                                                                  __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+                free(hits);
+                free(scratch.buf);
+                return NULL;
+            }
+            if (job->mode == SEARCH_ALL) {
+                pushMatch(&job->found, first + li, at - off[li]);
+            } else {
+                if (k == hitCap) {
+                    hitCap = hitCap ? hitCap * 2 : 8;
+                    hits = (size_t *) xrealloc(hits, hitCap * sizeof(size_t));
+                }
+                hits[k] = at;
+                if (li != lastLine) job->linesChanged++;
+                lastLine = li;
+            }
+            k++;
+            pos = at + job->m;
+        }
+        if (job->mode == SEARCH_REPLACE && k > 0) {
+            job->rebuilt[j] = rebuildLeaf(leaf, text, off, hits, k, job->repl, job->m, job->r);
+            job->replaced += k;
+        }
+    }
+    free(hits);
+    free(scratch.buf);
+    return NULL;
+}
+
+/* Run 'mode' over every chunk of 'leaves' and leave per-range results in jobs[] */
+static int runJobs(const LtLeafList *leaves, size_t lines, size_t fromLine, const char *needle,
+                   const char *repl, int mode, size_t *bestLine, LtNode **rebuilt, SearchJob *jobs) {
+    int t = searchThreads(lines);
+    size_t n = leaves->count;
+    size_t span = (n + (size_t) t - 1) / (size_t) t;
+    pthread_t tids[MAX_THREADS];
+
+    for (int j = 0; j < t; ++j) {
+        SearchJob *job = &jobs[j];
+        memset(job, 0, sizeof(*job));
+        job->leaves = leaves;
+        job->lo = (size_t) j * span < n ? (size_t) j * span : n;
+        job->hi = job->lo + span < n ? job->lo + span : n;
+        job->fromLine = fromLine;
+        job->needle = needle;
+        job->m = strlen(needle);
+        job->repl = repl;
+        job->r = repl ? strlen(repl) : 0;
+        job->mode = mode;
+        job->bestLine = bestLine;
+        job->rebuilt = rebuilt;
+    }
+    /* the calling thread takes the first range itself */
+    int started = 1;
+    for (int j = 1; j < t; ++j) {
+        if (pthread_create(&tids[j], NULL, searchWorker, &jobs[j]) != 0) break;
+        started++;
+    }
+    searchWorker(&jobs[0]);
+    for (int j = 1; j < started; ++j) pthread_join(tids[j], NULL);
+    /* ranges whose thread could not be started are finished here */
+    for (int j = started; j < t; ++j) searchWorker(&jobs[j]);
+    return t;
+}
+
+static int validNeedle(const char *needle) {
+    return needle && *needle && !strchr(needle, '\n');
+}
+
+int findFirst(const LineBuffer *buf, const char *needle, size_t fromLine, LineMatch *out) {
+    PF_TIMED("question5.findFirst");
+    if (!buf || !validNeedle(needle) || fromLine >= buf->size) return 0;
+    LtLeafList leaves;
+    ltCollectLeaves(buf->root, &leaves);
+    /* start at the chunk holding fromLine */
+    size_t skip = 0;
+    while (skip + 1 < leaves.count && leaves.firstLine[skip + 1] <= fromLine) skip++;
+    LtLeafList tail = {leaves.leaf + skip, leaves.firstLine + skip, leaves.count - skip};
+
+    SearchJob jobs[MAX_THREADS];
+    size_t best = SIZE_MAX;
+    int t = runJobs(&tail, buf->size - fromLine, fromLine, needle, NULL, SEARCH_FIRST, &best, NULL, jobs);
+
+    int found = 0;
+    for (int j = 0; j < t; ++j) {
+        if (!found && jobs[j].found.count > 0) {
+            *out = jobs[j].found.items[0];
+            found = 1;
+        }
+        free(jobs[j].found.items);
+    }
+    ltFreeLeafList(&leaves);
+    return found;
+}
+
+size_t findAll(const LineBuffer *buf, const char *needle, MatchList *out) {
+    PF_TIMED("question5.findAll");
+    out->items = NULL;
+    out->count = out->capacity = 0;
+    if (!buf || !validNeedle(needle) || buf->size == 0) return 0;
+    LtLeafList leaves;
+    ltCollectLeaves(buf->root, &leaves);
+    SearchJob jobs[MAX_THREADS];
+    int t = runJobs(&leaves, buf->size, 0, needle, NULL, SEARCH_ALL, NULL, NULL, jobs);
+    ltFreeLeafList(&leaves);
+
+    /* ranges are in line order, so concatenating keeps buffer order */
+    size_t total = 0;
+    for (int j = 0; j < t; ++j) total += jobs[j].found.count;
+    if (t == 1) {
+        *out = jobs[0].found;
+        return total;
+    }
+    out->items = total ? (LineMatch *) xmalloc(total * sizeof(LineMatch)) : NULL;
+    out->capacity = total;
+    for (int j = 0; j < t; ++j) {
+        if (jobs[j].found.count)
+            memcpy(out->items + out->count, jobs[j].found.items, jobs[j].found.count * sizeof(LineMatch));
+        out->count += jobs[j].found.count;
+        free(jobs[j].found.items);
+    }
+    return total;
+}
+
+void freeMatches(MatchList *list) {
+    if (!list) return;
+    free(list->items);
+    list->items = NULL;
+    list->count = list->capacity = 0;
+}
+
+size_t replaceAll(LineBuffer *buf, const char *needle, const char *repl, size_t *linesChanged) {
+    PF_TIMED("question5.replaceAll");
+    if (linesChanged) *linesChanged = 0;
+    if (!buf || !validNeedle(needle) || !repl || strchr(repl, '\n') || buf->size == 0) return 0;
+    LtLeafList leaves;
+    ltCollectLeaves(buf->root, &leaves);
+    LtNode **rebuilt = (LtNode **) calloc(leaves.count, sizeof(LtNode *));
+    if (!rebuilt) {
+        perror("calloc failed");
+        exit(EXIT_FAILURE);
+    }
+    SearchJob jobs[MAX_THREADS];
+    int t = runJobs(&leaves, buf->size, 0, needle, repl, SEARCH_REPLACE, NULL, rebuilt, jobs);
+
+    size_t replaced = 0, changed = 0;
+    for (int j = 0; j < t; ++j) {
+        replaced += jobs[j].replaced;
+        changed += jobs[j].linesChanged;
+    }
+    /* one new version: rebuilt chunks in place of the old ones, all other
+     * chunks shared with the previous version */
+    if (replaced > 0) {
+        for (size_t j = 0; j < leaves.count; ++j)
+            if (!rebuilt[j]) rebuilt[j] = ltRetain((LtNode *) leaves.leaf[j]);
+        commitVersion(buf, ltFromLeaves(rebuilt, leaves.count));
+        for (size_t j = 0; j < leaves.count; ++j) ltRelease(rebuilt[j]);
+    }
+    free(rebuilt);
+    ltFreeLeafList(&leaves);
+    PF_COUNT("question5.replaceAll.lines", changed);
+    if (linesChanged) *linesChanged = changed;
+    return replaced;
+}
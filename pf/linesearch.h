@@ -0,0 +1,47 @@
+#ifndef PF_LINESEARCH_H
+#define PF_LINESEARCH_H
+
+#include <stddef.h>
+#include "question5.h"
+
+/* ---- Substring search over a LineBuffer ----
+ *
+ * The kernel compares the first and last byte of the needle against 32
+ * (AVX2) or 16 (SSE2) candidate positions at once and only verifies the
+ * positions where both match. Each chunk of the buffer is searched as one
+ * block of text. Buffer-wide operations split the chunks into contiguous
+ * ranges, one per thread, once the buffer is large enough.
+ */
+
+typedef struct {
+    size_t line;   /* 0-based line index */
+    size_t col;    /* 0-based byte offset within the line */
+} LineMatch;
+
+typedef struct {
+    LineMatch *items;
+    size_t count;
+    size_t capacity;
+} MatchList;
+
+/* First occurrence of needle[0..m) in hay[0..n), or NULL */
+const char *findSubstring(const char *hay, size_t n, const char *needle, size_t m);
+
+/* Number of worker threads used for a buffer of 'lines' lines */
+int searchThreads(size_t lines);
+
+/* First match at or after line 'fromLine'. Returns 1 and fills 'out' if found. */
+int findFirst(const LineBuffer *buf, const char *needle, size_t fromLine, LineMatch *out);
+
+/* Every non-overlapping match, in buffer order. Returns the number of matches. */
+size_t findAll(const LineBuffer *buf, const char *needle, MatchList *out);
+void freeMatches(MatchList *list);
+
+/* Replace every non-overlapping occurrence of 'needle' by 'repl'. Each
+ * changed chunk is rebuilt once, with its final length known up front, and
+ * the result is committed as a single new version (one undo step).
+ * Returns the number of replacements; *linesChanged (if not NULL) gets the
+ * number of lines that were rewritten. */
+size_t replaceAll(LineBuffer *buf, const char *needle, const char *repl, size_t *linesChanged);
+
+#endif
@@ -0,0 +1,820 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include "linetree.h"
+#include "lz.h"
+
+struct LtNode {
+    int refs;
+    int isLeaf;
+    size_t count;         /* lines in a leaf, children in a branch */
+    size_t lines;         /* lines in the subtree */
+    size_t bytes;         /* text bytes in the subtree */
+    size_t allocated;     /* bytes charged to this node in ltMemoryInUse() */
+    char *text;           /* leaf: the body, NULL while cold (see below) */
+    char *packed;         /* leaf: compressed text, kept once made (see ltTrim) */
+    size_t packedLen;
+    int referenced;       /* leaf: read since the clock hand last passed it */
+    int incompressible;   /* leaf: packing it would not save enough */
+    LtNode *prev, *next;  /* leaf: ring of leaves whose text is in memory */
+    LtNode *child[];      /* branch: up to LT_FANOUT children */
+};
+
+/* A leaf's body is one block: its count lines, each ending in '\n', then
+ * (8-byte aligned) the count + 1 line start offsets. Packing drops the
+ * whole body; the offsets are found again when the text is unpacked. */
+#define ALIGN8(n) (((n) + 7) & ~(size_t) 7)
+
+static size_t bodySize(size_t bytes, size_t count) {
+    return ALIGN8(bytes) + (count + 1) * sizeof(size_t);
+}
+
+static size_t *bodyOffsets(const LtNode *leaf, const char *body) {
+    return (size_t *) (body + ALIGN8(leaf->bytes));
+}
+
+static size_t liveBytes = 0;
+
+#define TRIM_RETURN_BYTES (16u << 20)
+
+/* Leaves whose text is in memory form a ring that ltTrim() sweeps like a
+ * clock: a leaf read since the hand last passed gets another round, the
+ * others are packed. Leaves join the ring when built or unpacked. */
+static struct {
+    pthread_mutex_t lock;         /* guards the ring, the counters and packing */
+    LtNode *hand;                 /* next leaf to look at, NULL if the ring is empty */
+    size_t leaves, bytes;         /* leaves in the ring and their text */
+    size_t coldLeaves, coldText;  /* leaves with only packed text */
+    size_t coldPacked;            /* ... and the size it is packed to */
+    size_t packedBytes;           /* all packed copies, cold or not */
+    size_t limit;                 /* text to keep in memory, 0: all of it */
+    size_t untrimmed;             /* freed since the heap was last trimmed */
+    char *scratch;                /* compression output, grown as needed */
+    size_t scratchCap;
+} hot = {PTHREAD_MUTEX_INITIALIZER};
+
+/* ---- Helper: safe allocation wrappers ---- */
+
+static void *xmalloc(size_t n) {
+    void *p = malloc(n);
+    if (!p) {
+        perror("malloc failed");
+        fprintf(stderr, "Fatal: allocation of %zu bytes failed\n", n);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static void *xrealloc(void *ptr, size_t n) {
+    void *p = realloc(ptr, n);
+    if (!p) {
+        perror("realloc failed");
+        fprintf(stderr, "Fatal: reallocation to %zu bytes failed\n", n);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+/* ---- Nodes ----
+ * Nodes come from pools of their own, mapped apart from the heap, so the
+ * heap holds little but leaf bodies: the bodies freed by packing then
+ * leave whole pages free that can go back to the system.
+ */
+
+#define POOL_CHUNK (1u << 20)
+
+typedef struct {
+    size_t size;
+    void *free;           /* free slots, linked through their first word */
+} NodePool;
+
+static NodePool leafPool = {sizeof(LtNode), NULL};
+static NodePool branchPool = {sizeof(LtNode) + LT_FANOUT * sizeof(LtNode *), NULL};
+
+/* with hot.lock held */
+static void *poolGet(NodePool *p) {
+    if (!p->free) {
+        char *chunk = (char *) mmap(NULL, POOL_CHUNK, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (chunk == MAP_FAILED) {
+            perror("mmap failed");
+            fprintf(stderr, "Fatal: allocation of %u bytes failed\n", POOL_CHUNK);
+            exit(EXIT_FAILURE);
+        }
+        for (size_t at = 0; at + p->size <= POOL_CHUNK; at += p->size) {
+            *(void **) (chunk + at) = p->free;
+            p->free = chunk + at;
+        }
+    }
+    void *slot = p->free;
+    p->free = *(void **) slot;
+    return slot;
+}
+
+static void poolPut(NodePool *p, void *slot) {
+    *(void **) slot = p->free;
+    p->free = slot;
+}
+
+static LtNode *allocNode(int isLeaf, size_t count) {
+    NodePool *pool = isLeaf ? &leafPool : &branchPool;
+    pthread_mutex_lock(&hot.lock);
+    LtNode *n = (LtNode *) poolGet(pool);
+    pthread_mutex_unlock(&hot.lock);
+    n->refs = 1;
+    n->isLeaf = isLeaf;
+    n->count = count;
+    n->lines = 0;
+    n->bytes = 0;
+    n->allocated = pool->size;
+    n->text = NULL;
+    n->packed = NULL;
+    n->packedLen = 0;
+    n->referenced = 0;
+    n->incompressible = 0;
+    n->prev = n->next = NULL;
+    return n;
+}
+
+LtNode *ltRetain(LtNode *node) {
+    if (node) __atomic_add_fetch(&node->refs, 1, __ATOMIC_RELAXED);
+    return node;
+}
+
+/* ---- Packing cold leaves ---- */
+
+/* with hot.lock held */
+static void ringAdd(LtNode *n) {
+    if (!hot.hand) {
+        n->prev = n->next = n;
+        hot.hand = n;
+    } else {
+        /* just behind the hand: the last leaf the sweep gets to */
+        n->next = hot.hand;
+        n->prev = hot.hand->prev;
+        n->prev->next = n;
+        hot.hand->prev = n;
+    }
+    hot.leaves++;
+    hot.bytes += n->bytes;
+}
+
+static void ringRemove(LtNode *n) {
+    if (n->next == n) {
+        hot.hand = NULL;
+    } else {
+        n->prev->next = n->next;
+        n->next->prev = n->prev;
+        if (hot.hand == n) hot.hand = n->next;
+    }
+    n->prev = n->next = NULL;
+    hot.leaves--;
+    hot.bytes -= n->bytes;
+}
+
+/* Drop a leaf's text, compressing it first if that has not been done.
+ * With hot.lock held, and no other thread may be reading the leaf.
+ * Returns 0 if the leaf is not worth packing. */
+static int packLeaf(LtNode *n) {
+    if (!n->packed) {
+        size_t bound = lzBound(n->bytes);
+        if (bound > hot.scratchCap) {
+            hot.scratch = (char *) xrealloc(hot.scratch, bound);
+            hot.scratchCap = bound;
+        }
+        size_t len = lzCompress(n->text, n->bytes, hot.scratch);
+        if (len > n->bytes - n->bytes / 8) {
+            n->incompressible = 1;
+            return 0;
+        }
+        n->packed = (char *) xmalloc(len);
+        memcpy(n->packed, hot.scratch, len);
+        n->packedLen = len;
+        hot.packedBytes += len;
+        n->allocated += len;
+        __atomic_add_fetch(&liveBytes, len, __ATOMIC_RELAXED);
+    }
+    ringRemove(n);
+    free(n->text);
+    n->text = NULL;
+    hot.coldLeaves++;
+    hot.coldText += n->bytes;
+    hot.coldPacked += n->packedLen;
+    n->allocated -= bodySize(n->bytes, n->count);
+    __atomic_sub_fetch(&liveBytes, bodySize(n->bytes, n->count), __ATOMIC_RELAXED);
+    return 1;
+}
+
+/* unpack into body, which has room for bodySize() bytes */
+static void unpackInto(const LtNode *n, char *body) {
+    if (lzDecompress(n->packed, n->packedLen, body, n->bytes) != 0) {
+        fprintf(stderr, "Fatal: packed line chunk is corrupt\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t *off = bodyOffsets(n, body);
+    off[0] = 0;
+    for (size_t k = 0; k < n->count; ++k) {
+        const char *nl = (const char *) memchr(body + off[k], '\n', n->bytes - off[k]);
+        off[k + 1] = (size_t) (nl - body) + 1;
+    }
+}
+
+/* bring a cold leaf's text back; safe against other readers doing the same */
+static char *unpackLeaf(LtNode *n) {
+    char *text = (char *) xmalloc(bodySize(n->bytes, n->count));
+    unpackInto(n, text);
+    char *none = NULL;
+    if (!__atomic_compare_exchange_n(&n->text, &none, text, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(text);
+        return none;
+    }
+    pthread_mutex_lock(&hot.lock);
+    ringAdd(n);
+    hot.coldLeaves--;
+    hot.coldText -= n->bytes;
+    hot.coldPacked -= n->packedLen;
+    n->allocated += bodySize(n->bytes, n->count);
+    pthread_mutex_unlock(&hot.lock);
+    __atomic_add_fetch(&liveBytes, bodySize(n->bytes, n->count), __ATOMIC_RELAXED);
+    return text;
+}
+
+void ltSetHotLimit(size_t bytes) {
+    pthread_mutex_lock(&hot.lock);
+    hot.limit = bytes;
+    pthread_mutex_unlock(&hot.lock);
+}
+
+size_t ltTrim(void) {
+    size_t freed = 0;
+    pthread_mutex_lock(&hot.lock);
+    /* two rounds: every leaf can use up its second chance */
+    size_t visits = 2 * hot.leaves;
+    while (hot.limit && hot.bytes > hot.limit && hot.hand && visits-- > 0) {
+        LtNode *n = hot.hand;
+        if (n->referenced || n->incompressible) {
+            n->referenced = 0;
+            hot.hand = n->next;
+            continue;
+        }
+        size_t bytes = n->bytes;
+        if (packLeaf(n)) freed += bytes;
+        else hot.hand = n->next;
+    }
+#ifdef __GLIBC__
+    /* the freed blocks are small and stay in the heap; hand them back to
+     * the system once there are enough to be worth a walk over the heap */
+    hot.untrimmed += freed;
+    int giveBack = hot.untrimmed >= TRIM_RETURN_BYTES;
+    if (giveBack) hot.untrimmed = 0;
+    pthread_mutex_unlock(&hot.lock);
+    if (giveBack) malloc_trim(0);
+#else
+    pthread_mutex_unlock(&hot.lock);
+#endif
+    return freed;
+}
+
+void ltPackStats(LtPackStats *out) {
+    pthread_mutex_lock(&hot.lock);
+    out->hotLeaves = hot.leaves;
+    out->hotText = hot.bytes;
+    out->coldLeaves = hot.coldLeaves;
+    out->coldText = hot.coldText;
+    out->coldPacked = hot.coldPacked;
+    out->packedBytes = hot.packedBytes;
+    pthread_mutex_unlock(&hot.lock);
+}
+
+void ltRelease(LtNode *node) {
+    if (!node || __atomic_sub_fetch(&node->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    char *text = NULL, *packed = NULL;
+    if (!node->isLeaf)
+        for (size_t i = 0; i < node->count; ++i) ltRelease(node->child[i]);
+    __atomic_sub_fetch(&liveBytes, node->allocated, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&hot.lock);
+    if (node->isLeaf) {
+        if (node->text) {
+            ringRemove(node);
+        } else {
+            hot.coldLeaves--;
+            hot.coldText -= node->bytes;
+            hot.coldPacked -= node->packedLen;
+        }
+        hot.packedBytes -= node->packedLen;
+        text = node->text;
+        packed = node->packed;
+        poolPut(&leafPool, node);
+    } else {
+        poolPut(&branchPool, node);
+    }
+    pthread_mutex_unlock(&hot.lock);
+    free(text);
+    free(packed);
+}
+
+size_t ltMemoryInUse(void) {
+    return __atomic_load_n(&liveBytes, __ATOMIC_RELAXED);
+}
+
+LtNode *ltNewLeaf(char *text, const size_t *offsets, size_t count) {
+    LtNode *n = allocNode(1, count);
+    n->lines = count;
+    n->bytes = offsets[count] - offsets[0];
+    /* the offsets go behind the text; callers leave room for them */
+    n->text = (char *) xrealloc(text, bodySize(n->bytes, count));
+    memcpy(bodyOffsets(n, n->text), offsets, (count + 1) * sizeof(size_t));
+    n->allocated += bodySize(n->bytes, count);
+    __atomic_add_fetch(&liveBytes, n->allocated, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&hot.lock);
+    ringAdd(n);
+    pthread_mutex_unlock(&hot.lock);
+    return n;
+}
+
+/* branch over children[0..count); every child is retained */
+static LtNode *makeBranch(LtNode *const *children, size_t count) {
+    LtNode *n = allocNode(0, count);
+    for (size_t i = 0; i < count; ++i) {
+        n->child[i] = ltRetain(children[i]);
+        n->lines += children[i]->lines;
+        n->bytes += children[i]->bytes;
+    }
+    __atomic_add_fetch(&liveBytes, n->allocated, __ATOMIC_RELAXED);
+    return n;
+}
+
+size_t ltLines(const LtNode *root) {
+    return root ? root->lines : 0;
+}
+
+size_t ltBytes(const LtNode *root) {
+    return root ? root->bytes : 0;
+}
+
+static int leafOversize(const LtNode *leaf) {
+    return leaf->count > LT_LEAF_MAX || (leaf->count > 1 && leaf->bytes > 2 * LT_LEAF_BYTES);
+}
+
+static int underfull(const LtNode *n) {
+    if (n->isLeaf) return n->count < LT_LEAF_MAX / 4 && n->bytes < LT_LEAF_BYTES / 4;
+    return n->count < LT_FANOUT / 4;
+}
+
+/* ---- Leaf writer: new leaves are assembled from ranges of old ones ---- */
+
+typedef struct {
+    char *text;
+    size_t len, cap;
+    size_t off[2 * LT_LEAF_MAX + 2];   /* a merge of two full leaves plus one line */
+    size_t count;
+} LeafWriter;
+
+static void wInit(LeafWriter *w, size_t capHint) {
+    w->cap = capHint + sizeof(w->off);   /* room for ltNewLeaf's offsets */
+    w->text = (char *) xmalloc(w->cap);
+    w->len = 0;
+    w->count = 0;
+    w->off[0] = 0;
+}
+
+static void wReserve(LeafWriter *w, size_t extra) {
+    if (w->len + extra <= w->cap) return;
+    while (w->len + extra > w->cap) w->cap *= 2;
+    w->text = (char *) xrealloc(w->text, w->cap);
+}
+
+static void wRange(LeafWriter *w, const LtNode *leaf, size_t from, size_t to) {
+    const char *text = ltLeafText(leaf);
+    const size_t *off = bodyOffsets(leaf, text);
+    size_t a = off[from], b = off[to];
+    wReserve(w, b - a);
+    memcpy(w->text + w->len, text + a, b - a);
+    for (size_t i = from; i < to; ++i) {
+        w->off[w->count + 1] = w->len + (off[i + 1] - a);
+        w->count++;
+    }
+    w->len += b - a;
+}
+
+static void wLine(LeafWriter *w, const char *text, size_t len) {
+    wReserve(w, len + 1);
+    memcpy(w->text + w->len, text, len);
+    w->text[w->len + len] = '\n';
+    w->len += len + 1;
+    w->off[++w->count] = w->len;
+}
+
+static LtNode *wFinish(LeafWriter *w) {
+    if (w->count == 0) {
+        free(w->text);
+        return NULL;
+    }
+    return ltNewLeaf(w->text, w->off, w->count);
+}
+
+/* split an oversized leaf in two, near the middle of its text */
+static void splitLeaf(const LtNode *leaf, LtNode *out[2]) {
+    const size_t *off = ltLeafOffsets(leaf);
+    size_t h = 1;
+    while (h + 1 < leaf->count && off[h] < leaf->bytes / 2) h++;
+    if (leaf->count > LT_LEAF_MAX && (h < leaf->count - LT_LEAF_MAX || h > LT_LEAF_MAX))
+        h = leaf->count / 2;
+    LeafWriter w;
+    wInit(&w, off[h]);
+    wRange(&w, leaf, 0, h);
+    out[0] = wFinish(&w);
+    wInit(&w, leaf->bytes - off[h]);
+    wRange(&w, leaf, h, leaf->count);
+    out[1] = wFinish(&w);
+}
+
+/* one branch, or two halves if there are more than LT_FANOUT children */
+static int packBranches(LtNode *const *kids, size_t count, LtNode *out[2]) {
+    if (count <= LT_FANOUT) {
+        out[0] = makeBranch(kids, count);
+        return 1;
+    }
+    size_t h = count / 2;
+    out[0] = makeBranch(kids, h);
+    out[1] = makeBranch(kids + h, count - h);
+    return 2;
+}
+
+/* a and b are siblings (same depth): join them, re-split if too big */
+static int mergeNodes(const LtNode *a, const LtNode *b, LtNode *out[2]) {
+    if (a->isLeaf) {
+        LeafWriter w;
+        wInit(&w, a->bytes + b->bytes);
+        wRange(&w, a, 0, a->count);
+        wRange(&w, b, 0, b->count);
+        LtNode *full = wFinish(&w);
+        if (!leafOversize(full)) {
+            out[0] = full;
+            return 1;
+        }
+        splitLeaf(full, out);
+        ltRelease(full);
+        return 2;
+    }
+    LtNode *kids[2 * LT_FANOUT];
+    memcpy(kids, a->child, a->count * sizeof(LtNode *));
+    memcpy(kids + a->count, b->child, b->count * sizeof(LtNode *));
+    return packBranches(kids, a->count + b->count, out);
+}
+
+/* child holding line 'index' of a branch; *sub gets the index inside it.
+ * With 'atEnd', an index equal to a child's line count stays in that child
+ * (insert position after its last line). */
+static size_t childFor(const LtNode *n, size_t index, size_t *sub, int atEnd) {
+    size_t k = 0;
+    while (k + 1 < n->count && (atEnd ? index > n->child[k]->lines : index >= n->child[k]->lines)) {
+        index -= n->child[k]->lines;
+        k++;
+    }
+    *sub = index;
+    return k;
+}
+
+/* ---- Edits (path copying) ---- */
+
+enum { EDIT_INSERT, EDIT_REPLACE };
+
+static int editRec(const LtNode *n, size_t index, int op, const char *text, size_t len, LtNode *out[2]) {
+    if (n->isLeaf) {
+        LeafWriter w;
+        wInit(&w, n->bytes + len + 1);
+        wRange(&w, n, 0, index);
+        wLine(&w, text, len);
+        wRange(&w, n, op == EDIT_INSERT ? index : index + 1, n->count);
+        LtNode *full = wFinish(&w);
+        if (!leafOversize(full)) {
+            out[0] = full;
+            return 1;
+        }
+        splitLeaf(full, out);
+        ltRelease(full);
+        return 2;
+    }
+
+    size_t sub;
+    size_t k = childFor(n, index, &sub, op == EDIT_INSERT);
+    LtNode *got[2];
+    int r = editRec(n->child[k], sub, op, text, len, got);
+
+    LtNode *kids[LT_FANOUT + 1] = {NULL};
+    size_t c = 0;
+    for (size_t j = 0; j < k; ++j) kids[c++] = n->child[j];
+    for (int g = 0; g < r; ++g) kids[c++] = got[g];
+    for (size_t j = k + 1; j < n->count; ++j) kids[c++] = n->child[j];
+    int res = packBranches(kids, c, out);
+    for (int g = 0; g < r; ++g) ltRelease(got[g]);
+    return res;
+}
+
+static LtNode *editRoot(const LtNode *root, size_t index, int op, const char *text, size_t len) {
+    LtNode *out[2];
+    if (editRec(root, index, op, text, len, out) == 1) return out[0];
+    LtNode *top = makeBranch(out, 2);
+    ltRelease(out[0]);
+    ltRelease(out[1]);
+    return top;
+}
+
+LtNode *ltInsert(const LtNode *root, size_t index, const char *text, size_t len) {
+    if (!root) {
+        LeafWriter w;
+        wInit(&w, len + 1);
+        wLine(&w, text, len);
+        return wFinish(&w);
+    }
+    if (index > root->lines) index = root->lines;
+    return editRoot(root, index, EDIT_INSERT, text, len);
+}
+
+LtNode *ltReplace(const LtNode *root, size_t index, const char *text, size_t len) {
+    if (!root || index >= root->lines) return ltRetain((LtNode *) root);
+    return editRoot(root, index, EDIT_REPLACE, text, len);
+}
+
+/* returns the node without line 'index', NULL if nothing is left */
+static LtNode *deleteRec(const LtNode *n, size_t index) {
+    if (n->isLeaf) {
+        LeafWriter w;
+        wInit(&w, n->bytes);
+        wRange(&w, n, 0, index);
+        wRange(&w, n, index + 1, n->count);
+        return wFinish(&w);
+    }
+
+    size_t sub;
+    size_t k = childFor(n, index, &sub, 0);
+    LtNode *c = deleteRec(n->child[k], sub);
+    LtNode *fresh[3] = {c, NULL, NULL};
+
+    LtNode *kids[LT_FANOUT];
+    size_t cnt = 0;
+    for (size_t j = 0; j < n->count; ++j) {
+        if (j != k) kids[cnt++] = n->child[j];
+        else if (c) kids[cnt++] = c;
+    }
+
+    /* an underfull child is merged with a neighbour so the tree stays balanced */
+    if (c && cnt >= 2 && underfull(c)) {
+        size_t a = k + 1 < cnt ? k : k - 1;
+        LtNode *m[2];
+        int r = mergeNodes(kids[a], kids[a + 1], m);
+        fresh[1] = m[0];
+        fresh[2] = r == 2 ? m[1] : NULL;
+        kids[a] = m[0];
+        if (r == 2) {
+            kids[a + 1] = m[1];
+        } else {
+            memmove(&kids[a + 1], &kids[a + 2], (cnt - a - 2) * sizeof(LtNode *));
+            cnt--;
+        }
+    }
+
+    LtNode *res = cnt ? makeBranch(kids, cnt) : NULL;
+    for (int i = 0; i < 3; ++i) ltRelease(fresh[i]);
+    return res;
+}
+
+LtNode *ltDelete(const LtNode *root, size_t index) {
+    if (!root || index >= root->lines) return ltRetain((LtNode *) root);
+    LtNode *r = deleteRec(root, index);
+    /* drop branches left with a single child at the top */
+    while (r && !r->isLeaf && r->count == 1) {
+        LtNode *only = ltRetain(r->child[0]);
+        ltRelease(r);
+        r = only;
+    }
+    return r;
+}
+
+/* ---- Lookup ---- */
+
+const LtNode *ltLeafAt(const LtNode *root, size_t index, size_t *firstLine) {
+    if (!root || index >= root->lines) return NULL;
+    size_t base = index;
+    while (!root->isLeaf) {
+        size_t sub;
+        size_t k = childFor(root, index, &sub, 0);
+        root = root->child[k];
+        index = sub;
+    }
+    if (firstLine) *firstLine = base - index;
+    return root;
+}
+
+const char *ltLine(const LtNode *root, size_t index, size_t *len) {
+    size_t first;
+    const LtNode *leaf = ltLeafAt(root, index, &first);
+    if (!leaf) return NULL;
+    size_t i = index - first;
+    const char *text = ltLeafText(leaf);
+    const size_t *off = bodyOffsets(leaf, text);
+    if (len) *len = off[i + 1] - off[i] - 1;
+    return text + off[i];
+}
+
+size_t ltLeafLines(const LtNode *leaf) {
+    return leaf->count;
+}
+
+const char *ltLeafText(const LtNode *leaf) {
+    LtNode *n = (LtNode *) leaf;   /* unpacking does not change the contents */
+    char *text = __atomic_load_n(&n->text, __ATOMIC_ACQUIRE);
+    if (!text) text = unpackLeaf(n);
+    if (!__atomic_load_n(&n->referenced, __ATOMIC_RELAXED)) __atomic_store_n(&n->referenced, 1, __ATOMIC_RELAXED);
+    return text;
+}
+
+const char *ltLeafScan(const LtNode *leaf, LtScratch *scratch, const size_t **offsets) {
+    const char *text = __atomic_load_n(&leaf->text, __ATOMIC_ACQUIRE);
+    if (!text) {
+        size_t need = bodySize(leaf->bytes, leaf->count);
+        if (need > scratch->cap) {
+            scratch->buf = (char *) xrealloc(scratch->buf, need);
+            scratch->cap = need;
+        }
+        unpackInto(leaf, scratch->buf);
+        text = scratch->buf;
+    }
+    if (offsets) *offsets = bodyOffsets(leaf, text);
+    return text;
+}
+
+const size_t *ltLeafOffsets(const LtNode *leaf) {
+    return bodyOffsets(leaf, ltLeafText(leaf));
+}
+
+static void collect(const LtNode *n, LtLeafList *out, size_t *cap, size_t *line) {
+    if (!n->isLeaf) {
+        for (size_t i = 0; i < n->count; ++i) collect(n->child[i], out, cap, line);
+        return;
+    }
+    if (out->count == *cap) {
+        *cap = *cap ? *cap * 2 : 64;
+        out->leaf = (const LtNode **) xrealloc(out->leaf, *cap * sizeof(LtNode *));
+        out->firstLine = (size_t *) xrealloc(out->firstLine, *cap * sizeof(size_t));
+    }
+    out->leaf[out->count] = n;
+    out->firstLine[out->count] = *line;
+    out->count++;
+    *line += n->count;
+}
+
+void ltCollectLeaves(const LtNode *root, LtLeafList *out) {
+    size_t cap = 0, line = 0;
+    out->leaf = NULL;
+    out->firstLine = NULL;
+    out->count = 0;
+    if (root) collect(root, out, &cap, &line);
+}
+
+void ltFreeLeafList(LtLeafList *list) {
+    free(list->leaf);
+    free(list->firstLine);
+    list->leaf = NULL;
+    list->firstLine = NULL;
+    list->count = 0;
+}
+
+/* ---- Differences between two versions ---- */
+
+/* does 'base' hold the very node 'n' starting at byte 'offset'? */
+static int sharedAt(const LtNode *base, const LtNode *n, size_t offset) {
+    size_t start = 0;
+    while (base && offset < start + base->bytes) {
+        if (base == n) return start == offset;
+        if (base->isLeaf) return 0;
+        size_t k = 0;
+        while (k + 1 < base->count && offset >= start + base->child[k]->bytes) start += base->child[k++]->bytes;
+        base = base->child[k];
+    }
+    return 0;
+}
+
+static int dirtyRec(const LtNode *base, const LtNode *n, size_t offset, size_t limit,
+                    LtDirtyList *out, size_t *cap) {
+    if (sharedAt(base, n, offset)) return 0;
+    if (!n->isLeaf) {
+        for (size_t i = 0; i < n->count; ++i) {
+            if (dirtyRec(base, n->child[i], offset, limit, out, cap) != 0) return -1;
+            offset += n->child[i]->bytes;
+        }
+        return 0;
+    }
+    out->bytes += n->bytes;
+    if (out->bytes > limit) return -1;
+    if (out->count == *cap) {
+        *cap = *cap ? *cap * 2 : 64;
+        out->leaf = (const LtNode **) xrealloc(out->leaf, *cap * sizeof(LtNode *));
+        out->offset = (size_t *) xrealloc(out->offset, *cap * sizeof(size_t));
+    }
+    out->leaf[out->count] = n;
+    out->offset[out->count] = offset;
+    out->count++;
+    return 0;
+}
+
+int ltDirtyLeaves(const LtNode *base, const LtNode *root, size_t limit, LtDirtyList *out) {
+    size_t cap = 0;
+    memset(out, 0, sizeof(*out));
+    if (root && dirtyRec(base, root, 0, limit, out, &cap) != 0) {
+        ltFreeDirtyList(out);
+        return -1;
+    }
+    return 0;
+}
+
+void ltFreeDirtyList(LtDirtyList *list) {
+    free(list->leaf);
+    free(list->offset);
+    memset(list, 0, sizeof(*list));
+}
+
+/* ---- Bulk construction ---- */
+
+LtNode *ltFromLeaves(LtNode *const *leaves, size_t count) {
+    if (count == 0) return NULL;
+    if (count == 1) return ltRetain(leaves[0]);
+
+    LtNode **level = (LtNode **) xmalloc(count * sizeof(LtNode *));
+    memcpy(level, leaves, count * sizeof(LtNode *));
+    int owned = 0;   /* level 0 belongs to the caller */
+    while (count > 1) {
+        /* spread the nodes evenly so every branch is at least half full */
+        size_t groups = (count + LT_FANOUT - 1) / LT_FANOUT;
+        size_t next = 0, pos = 0;
+        LtNode **up = (LtNode **) xmalloc(groups * sizeof(LtNode *));
+        for (size_t g = 0; g < groups; ++g) {
+            size_t take = count / groups + (g < count % groups ? 1 : 0);
+            up[next++] = makeBranch(level + pos, take);
+            pos += take;
+        }
+        if (owned)
+            for (size_t i = 0; i < count; ++i) ltRelease(level[i]);
+        free(level);
+        level = up;
+        count = next;
+        owned = 1;
+    }
+    LtNode *root = level[0];
+    free(level);
+    return root;
+}
+
+void ltBuilderInit(LtBuilder *b) {
+    memset(b, 0, sizeof(*b));
+}
+
+static void builderFlush(LtBuilder *b) {
+    if (b->count == 0) return;
+    char *text = b->text;
+    if (b->leafCount == b->leafCap) {
+        b->leafCap = b->leafCap ? b->leafCap * 2 : 64;
+        b->leaves = (LtNode **) xrealloc(b->leaves, b->leafCap * sizeof(LtNode *));
+    }
+    LtNode *leaf = ltNewLeaf(text, b->off, b->count);
+    b->leaves[b->leafCount++] = leaf;
+    /* nobody else can see the leaf yet, so it may be packed right away:
+     * loading a large file does not first need all of it in memory */
+    pthread_mutex_lock(&hot.lock);
+    if (hot.limit && hot.bytes > hot.limit) packLeaf(leaf);
+    pthread_mutex_unlock(&hot.lock);
+    b->text = NULL;
+    b->len = b->cap = 0;
+    b->count = 0;
+}
+
+void ltBuilderAdd(LtBuilder *b, const char *text, size_t len) {
+    if (b->count == LT_LEAF_MAX || (b->count > 0 && b->len + len + 1 > LT_LEAF_BYTES)) builderFlush(b);
+    if (b->len + len + 1 > b->cap) {
+        size_t cap = b->cap ? b->cap : bodySize(LT_LEAF_BYTES, LT_LEAF_MAX);   /* with room for the offsets */
+        while (b->len + len + 1 > cap) cap *= 2;
+        b->text = (char *) xrealloc(b->text, cap);
+        b->cap = cap;
+    }
+    memcpy(b->text + b->len, text, len);
+    b->text[b->len + len] = '\n';
+    b->len += len + 1;
+    b->off[0] = 0;
+    b->off[++b->count] = b->len;
+}
+
+LtNode *ltBuilderFinish(LtBuilder *b) {
+    builderFlush(b);
+    LtNode *root = ltFromLeaves(b->leaves, b->leafCount);
+    for (size_t i = 0; i < b->leafCount; ++i) ltRelease(b->leaves[i]);
+    free(b->leaves);
+    free(b->text);
+    ltBuilderInit(b);
+    return root;
+}
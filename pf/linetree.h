@@ -0,0 +1,136 @@
+#ifndef PF_LINETREE_H
+#define PF_LINETREE_H
+
+#include <stddef.h>
+
+/* ---- Persistent tree of line chunks ----
+ *
+ * A B+tree whose leaves hold up to LT_LEAF_MAX lines as one text block
+ * (every line followed by '\n') plus the start offset of each line. Nodes
+ * are never changed after they are built: an edit copies the leaf and the
+ * branches on the path to it and shares everything else with the previous
+ * version, so every version is an immutable snapshot that stays valid as
+ * long as a reference to its root is held. Reference counts are atomic, so
+ * a snapshot may be read by another thread while editing continues.
+ *
+ * The empty tree is NULL. Functions returning a tree return a new
+ * reference that the caller must ltRelease(); arguments are only borrowed.
+ */
+
+#define LT_LEAF_MAX 64       /* lines per leaf */
+#define LT_LEAF_BYTES 4096   /* text per leaf the builder aims for */
+#define LT_FANOUT 32         /* children per branch */
+
+typedef struct LtNode LtNode;
+
+LtNode *ltRetain(LtNode *node);
+void ltRelease(LtNode *node);
+
+size_t ltLines(const LtNode *root);
+size_t ltBytes(const LtNode *root);   /* text bytes including one '\n' per line */
+
+/* Line 'index' (not NUL-terminated, without its '\n'); *len gets its length.
+ * The pointer stays valid while the caller holds a reference to 'root'. */
+const char *ltLine(const LtNode *root, size_t index, size_t *len);
+
+LtNode *ltInsert(const LtNode *root, size_t index, const char *text, size_t len);
+LtNode *ltDelete(const LtNode *root, size_t index);
+LtNode *ltReplace(const LtNode *root, size_t index, const char *text, size_t len);
+
+/* ---- Leaves ---- */
+
+/* Leaf holding line 'index'; *firstLine gets the index of its first line */
+const LtNode *ltLeafAt(const LtNode *root, size_t index, size_t *firstLine);
+size_t ltLeafLines(const LtNode *leaf);
+const char *ltLeafText(const LtNode *leaf);   /* unpacks a cold leaf, see below */
+const size_t *ltLeafOffsets(const LtNode *leaf);   /* ltLeafLines() + 1 entries */
+
+/* New leaf that takes ownership of 'text' (malloc'ed, 'count' lines each
+ * ending in '\n'); the offsets are copied. */
+LtNode *ltNewLeaf(char *text, const size_t *offsets, size_t count);
+
+/* All leaves in order, with the index of each leaf's first line */
+typedef struct {
+    const LtNode **leaf;
+    size_t *firstLine;
+    size_t count;
+} LtLeafList;
+
+void ltCollectLeaves(const LtNode *root, LtLeafList *out);
+void ltFreeLeafList(LtLeafList *list);
+
+/* Leaves of 'root' whose text is not found at the same byte offset in
+ * 'base', i.e. what has to be rewritten to turn a file holding 'base' into
+ * one holding 'root'. Subtrees the two versions share are skipped without
+ * being visited. Returns -1 (and an empty list) once more than 'limit'
+ * bytes are dirty. */
+typedef struct {
+    const LtNode **leaf;
+    size_t *offset;             /* byte offset of each leaf in 'root' */
+    size_t count;
+    size_t bytes;               /* text in all listed leaves */
+} LtDirtyList;
+
+int ltDirtyLeaves(const LtNode *base, const LtNode *root, size_t limit, LtDirtyList *out);
+void ltFreeDirtyList(LtDirtyList *list);
+
+/* Balanced tree over the given leaves, in order (each leaf is retained) */
+LtNode *ltFromLeaves(LtNode *const *leaves, size_t count);
+
+/* ---- Bulk building, e.g. while loading a file ---- */
+
+typedef struct {
+    char *text;                 /* leaf being filled */
+    size_t len, cap;
+    size_t off[LT_LEAF_MAX + 1];
+    size_t count;
+    LtNode **leaves;            /* finished leaves */
+    size_t leafCount, leafCap;
+} LtBuilder;
+
+void ltBuilderInit(LtBuilder *b);
+void ltBuilderAdd(LtBuilder *b, const char *text, size_t len);   /* one line, no '\n' */
+LtNode *ltBuilderFinish(LtBuilder *b);                           /* resets the builder */
+
+/* Bytes currently allocated for nodes and text, over all live versions */
+size_t ltMemoryInUse(void);
+
+/* ---- Packing cold leaves ----
+ *
+ * With a limit set, ltTrim() compresses (lz.h) the text of the leaves read
+ * least recently until at most 'limit' bytes of text are left in memory;
+ * the builder also packs new leaves once the limit is reached. A cold leaf
+ * keeps only the packed text; ltLeafText(), ltLeafOffsets() and ltLine()
+ * unpack it and keep the text until a later trim. A packed leaf keeps its
+ * compressed copy, so packing it again only frees the text.
+ *
+ * ltTrim() frees text that readers may hold pointers to: it must not run
+ * while another thread reads any tree, and text pointers obtained before
+ * it are invalid afterwards.
+ */
+
+void ltSetHotLimit(size_t bytes);   /* 0 (the default): never pack */
+size_t ltTrim(void);                /* returns the bytes of text freed */
+
+/* Text of a leaf (and its offsets, if 'offsets' is not NULL) for one pass
+ * over it, e.g. while saving or searching: a cold leaf is unpacked into
+ * 'scratch' (free scratch.buf when done) and stays cold, so a pass over a
+ * whole tree does not push out the leaves in use. Valid until the next
+ * call with the same scratch. */
+typedef struct {
+    char *buf;
+    size_t cap;
+} LtScratch;
+
+const char *ltLeafScan(const LtNode *leaf, LtScratch *scratch, const size_t **offsets);
+
+typedef struct {
+    size_t hotLeaves, hotText;      /* leaves with their text in memory */
+    size_t coldLeaves, coldText;    /* leaves with only packed text */
+    size_t coldPacked;              /* what their text is packed to */
+    size_t packedBytes;             /* every packed copy, cold or not */
+} LtPackStats;
+
+void ltPackStats(LtPackStats *out);
+
+#endif
@@ -0,0 +1,315 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "loanschedule.h"
+#include "outbuf.h"
+
+// A segment starts at period 1 and at every period with a change
+struct Segment {
+    int period;           // first period
+    int setsRate;         // the rate was set here, not carried from before
+    double rate;
+    double extra;         // prepaid in the first period
+    // loan state before the first period (kept for seg[0..fresh))
+    double before;
+    double paid;
+    int run;
+};
+
+struct LoanSchedule {
+    int periods;
+    double installment;
+    struct Segment *seg;
+    int count;
+    int capacity;
+    int fresh;            // seg[0..fresh) know their start state
+    int answered;         // the totals below are up to date
+    double totalPaid;
+    double finalBalance;
+    int periodsRun;
+    double loan;
+    double *bal;          // bal[k]: balance after period k (allocated when first asked)
+    int balValid;         // bal[0..balValid] are up to date
+};
+
+static void *allocOrDie(void *p, size_t n) {
+    p = realloc(p, n);
+    if (!p) {
+        perror("malloc failed");
+        exit(1);
+    }
+    return p;
+}
+
+struct LoanSchedule *scheduleCreate(double loan, double rate, int periods, double installment) {
+    struct LoanSchedule *s = (struct LoanSchedule *) allocOrDie(NULL, sizeof(*s));
+    if (periods < 0) periods = 0;
+    s->periods = periods;
+    s->installment = installment;
+    s->capacity = 8;
+    s->seg = (struct Segment *) allocOrDie(NULL, s->capacity * sizeof(struct Segment));
+    s->seg[0] = (struct Segment) {1, 1, rate, 0, loan, 0, 0};
+    s->count = 1;
+    s->fresh = 1;
+    s->answered = 0;
+    s->loan = loan;
+    s->bal = NULL;
+    s->balValid = 0;
+    return s;
+}
+
+void scheduleFree(struct LoanSchedule *s) {
+    if (!s) return;
+    free(s->seg);
+    free(s->bal);
+    free(s);
+}
+
+// ------------------------------------------------------------
+// Crossing a segment
+// ------------------------------------------------------------
+
+// Balance after the first period of g, which pays the prepayment too
+static double firstPeriod(const struct LoanSchedule *s, const struct Segment *g, double before) {
+    return before + before * g->rate - (s->installment + g->extra);
+}
+
+// j more periods paying the installment at rate r (lg = log1p(r))
+static double jump(double b, double r, double lg, double pay, int j) {
+    if (r == 0) return b - pay * j;
+    double grow = expm1(lg * j);   // (1+r)^j - 1
+    return b + b * grow - pay * (grow / r);
+}
+
+// First j in 1..n with B(j) <= 0, given that B(n) is. Solving the closed
+// form for j gives the period up to rounding; the steps after it settle
+// which side of zero it falls on, as jump() computes it
+static int payoffWithin(double b, double r, double lg, double pay, int n) {
+    double x = r == 0 ? b / pay : -log1p(-r * b / pay) / lg;
+    if (!(x >= 0 && x < n)) {
+        int lo = 1, hi = n;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (jump(b, r, lg, pay, mid) <= 0) hi = mid;
+            else lo = mid + 1;
+        }
+        return lo;
+    }
+    int j = (int) ceil(x);
+    if (j < 1) j = 1;
+    while (j > 1 && jump(b, r, lg, pay, j - 1) <= 0) j--;
+    while (jump(b, r, lg, pay, j) > 0) j++;
+    return j;
+}
+
+static int segmentEnd(const struct LoanSchedule *s, int i) {
+    return i + 1 < s->count ? s->seg[i + 1].period : s->periods + 1;
+}
+
+// Run segment i on the state (balance, paid, periods run) it starts from
+static void runSegment(const struct LoanSchedule *s, int i, double *bal, double *paid, int *run) {
+    const struct Segment *g = &s->seg[i];
+    int len = segmentEnd(s, i) - g->period;
+    if (*bal <= 0 || len <= 0) return;   // paid off already
+
+    double b = firstPeriod(s, g, *bal);
+    double pay = s->installment;
+    *paid += pay + g->extra;
+    (*run)++;
+
+    int n = len - 1;
+    if (b > 0 && n > 0) {
+        // The balance moves one way within a segment (each step's change is
+        // the last one times 1+r), so it is paid off inside only if the end is
+        double lg = log1p(g->rate);
+        double end = jump(b, g->rate, lg, pay, n);
+        if (end <= 0) {
+            n = payoffWithin(b, g->rate, lg, pay, n);
+            end = jump(b, g->rate, lg, pay, n);
+        }
+        b = end;
+        *paid += pay * n;
+        *run += n;
+    }
+    *bal = b;
+}
+
+// Bring the totals up to date, from the first segment without a start state
+static void answer(struct LoanSchedule *s) {
+    if (s->answered) return;
+    int i = s->fresh - 1;
+    double bal = s->seg[i].before, paid = s->seg[i].paid;
+    int run = s->seg[i].run;
+    for (; i < s->count; i++) {
+        runSegment(s, i, &bal, &paid, &run);
+        if (i + 1 < s->count) {
+            s->seg[i + 1].before = bal;
+            s->seg[i + 1].paid = paid;
+            s->seg[i + 1].run = run;
+        }
+    }
+    s->fresh = s->count;
+    s->finalBalance = bal;
+    s->totalPaid = paid;
+    s->periodsRun = run;
+    s->answered = 1;
+}
+
+// ------------------------------------------------------------
+// Changes
+// ------------------------------------------------------------
+
+// Last segment starting at or before 'period' (seg[0] starts at 1)
+static int findSegment(const struct LoanSchedule *s, int period) {
+    int lo = 0, hi = s->count - 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo + 1) / 2;
+        if (s->seg[mid].period <= period) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+// The segment starting at 'period', cut from the one it falls in if needed
+static int segmentAt(struct LoanSchedule *s, int period) {
+    int i = findSegment(s, period);
+    if (s->seg[i].period == period) return i;
+    if (s->count == s->capacity) {
+        s->capacity *= 2;
+        s->seg = (struct Segment *) allocOrDie(s->seg, s->capacity * sizeof(struct Segment));
+    }
+    i++;
+    memmove(&s->seg[i + 1], &s->seg[i], (s->count - i) * sizeof(struct Segment));
+    s->seg[i] = (struct Segment) {period, 0, s->seg[i - 1].rate, 0, 0, 0, 0};
+    s->count++;
+    return i;
+}
+
+// Segment i changed (or went): what starts at it or later is stale
+static void changed(struct LoanSchedule *s, int i, int period) {
+    if (i < 1) i = 1;
+    if (s->fresh > i) s->fresh = i;
+    if (s->balValid > period - 1) s->balValid = period - 1;
+    s->answered = 0;
+}
+
+// Merge segment i back into the one before if nothing starts there any more
+static void dropIfPlain(struct LoanSchedule *s, int i) {
+    if (i == 0 || s->seg[i].setsRate || s->seg[i].extra != 0) return;
+    memmove(&s->seg[i], &s->seg[i + 1], (s->count - i - 1) * sizeof(struct Segment));
+    s->count--;
+}
+
+static void carryRate(struct LoanSchedule *s, int i) {
+    for (int j = i + 1; j < s->count && !s->seg[j].setsRate; j++) s->seg[j].rate = s->seg[i].rate;
+}
+
+int scheduleSetRate(struct LoanSchedule *s, int period, double rate) {
+    if (period < 1 || period > s->periods || !(rate > -1)) return -1;
+    int i = segmentAt(s, period);
+    s->seg[i].setsRate = 1;
+    s->seg[i].rate = rate;
+    carryRate(s, i);
+    changed(s, i, period);
+    return 0;
+}
+
+int scheduleClearRate(struct LoanSchedule *s, int period) {
+    if (period < 2 || period > s->periods) return -1;
+    int i = findSegment(s, period);
+    if (s->seg[i].period != period || !s->seg[i].setsRate) return 0;
+    s->seg[i].setsRate = 0;
+    s->seg[i].rate = s->seg[i - 1].rate;
+    carryRate(s, i);
+    dropIfPlain(s, i);
+    changed(s, i, period);
+    return 0;
+}
+
+int schedulePrepay(struct LoanSchedule *s, int period, double amount) {
+    if (period < 1 || period > s->periods) return -1;
+    int i = findSegment(s, period);
+    if (s->seg[i].period != period) {
+        if (amount == 0) return 0;
+        i = segmentAt(s, period);
+    }
+    s->seg[i].extra = amount;
+    dropIfPlain(s, i);
+    changed(s, i, period);
+    return 0;
+}
+
+// ------------------------------------------------------------
+// Answers
+// ------------------------------------------------------------
+
+double scheduleTotalPaid(struct LoanSchedule *s) {
+    answer(s);
+    return s->totalPaid;
+}
+
+int schedulePeriodsRun(struct LoanSchedule *s) {
+    answer(s);
+    return s->periodsRun;
+}
+
+double scheduleFinalBalance(struct LoanSchedule *s) {
+    answer(s);
+    return s->finalBalance;
+}
+
+double scheduleBalance(struct LoanSchedule *s, int period) {
+    answer(s);
+    if (period <= 0) return s->loan;
+    if (period > s->periodsRun) return s->finalBalance;
+    if (!s->bal) {
+        s->bal = (double *) allocOrDie(NULL, ((size_t) s->periods + 1) * sizeof(double));
+        s->bal[0] = s->loan;
+    }
+    if (period <= s->balValid) return s->bal[period];
+
+    // Fill the cache up to 'period' from the start of each segment, with the
+    // same steps runSegment took
+    int p = s->balValid + 1;
+    int i = findSegment(s, p);
+    while (p <= period) {
+        const struct Segment *g = &s->seg[i];
+        int end = segmentEnd(s, i);
+        double b1 = firstPeriod(s, g, g->before);
+        double lg = log1p(g->rate);
+        for (; p < end && p <= period; p++)
+            s->bal[p] = p == g->period ? b1 : jump(b1, g->rate, lg, s->installment, p - g->period);
+        i++;
+    }
+    s->balValid = period;
+    return s->bal[period];
+}
+
+void schedulePrint(struct LoanSchedule *s) {
+    int run = schedulePeriodsRun(s);
+    scheduleBalance(s, run);
+
+    OutBuf *o = outBegin();
+    int i = 0;
+    for (int p = 1; p <= run; p++) {
+        outStr(o, "Year ");
+        outInt(o, p);
+        outStr(o, ": Remaining loan = ");
+        outFixed(o, s->bal[p], 2);
+        while (i + 1 < s->count && s->seg[i + 1].period <= p) i++;
+        const struct Segment *g = &s->seg[i];
+        if (g->period == p && p > 1 && g->setsRate) {
+            outStr(o, "  (rate ");
+            outFixed(o, g->rate * 100, 2);
+            outStr(o, "%)");
+        }
+        if (g->period == p && g->extra != 0) {
+            outStr(o, "  (prepaid ");
+            outFixed(o, g->extra, 2);
+            outChar(o, ')');
+        }
+        outChar(o, '\n');
+    }
+    outEnd(o);
+}
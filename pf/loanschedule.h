@@ -0,0 +1,46 @@
+#ifndef PF_LOANSCHEDULE_H
+#define PF_LOANSCHEDULE_H
+
+// Repayment schedule for "what if" questions: the loan of calculateRepayment
+// (interest added each period, then the installment paid, until the balance
+// is gone or the periods run out) with rate changes and extra payments.
+//
+// Periods are numbered from 1. A period pays the rate set at or before it,
+// and a prepayment is paid in its period on top of the installment. The
+// changes cut the schedule into segments with one rate and one payment, and
+// a segment is crossed in one step with the closed form
+//     B(j) = B * (1+r)^j - P * ((1+r)^j - 1) / r
+// (the period a loan is paid off in is found by bisecting the segment). The
+// balance at the start of every segment is kept, so after a change only the
+// segments from it onward are worked out again, when an answer is next
+// asked for. Balances of single periods are cached as they are asked for,
+// until a change at or before them.
+//
+// As in calculateRepayment the last installment is paid in full, so the
+// final balance can be below zero. Results agree with the period-by-period
+// recursion up to rounding.
+
+struct LoanSchedule;
+
+struct LoanSchedule *scheduleCreate(double loan, double rate, int periods, double installment);
+void scheduleFree(struct LoanSchedule *s);
+
+// Changes: 0, or -1 for a period outside 1..periods (or a rate of -100% or less)
+// The rate from 'period' on, up to the next period that sets one
+int scheduleSetRate(struct LoanSchedule *s, int period, double rate);
+// Drop the rate set at 'period' (not 1): it pays the earlier rate again
+int scheduleClearRate(struct LoanSchedule *s, int period);
+// Pay 'amount' extra in 'period', replacing what was prepaid there (0: nothing)
+int schedulePrepay(struct LoanSchedule *s, int period, double amount);
+
+// Answers, worked out from the first change since the last answer
+double scheduleTotalPaid(struct LoanSchedule *s);     // installments and prepayments
+int schedulePeriodsRun(struct LoanSchedule *s);       // until paid off, or all of them
+double scheduleFinalBalance(struct LoanSchedule *s);
+// Balance after 'period' (0: the loan); past the payoff it stays at the final balance
+double scheduleBalance(struct LoanSchedule *s, int period);
+
+// "Year N: Remaining loan = X" for every period run, noting the changes
+void schedulePrint(struct LoanSchedule *s);
+
+#endif
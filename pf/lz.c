@@ -0,0 +1,160 @@
+
+#include <stdint.h>
+#include <string.h>
+#include "lz.h"
+
+#define HASH_BITS 12
+#define MAX_DISTANCE 65535
+#define LAST_LITERALS 5     /* a block always ends in a few literals */
+
+static uint32_t read32(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t read64(const char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* bytes in which a and b agree, stopping at 'end' (the end of b) */
+static size_t commonLength(const char *a, const char *b, const char *end) {
+    const char *start = b;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (end - b >= 8) {
+        uint64_t diff = read64(a) ^ read64(b);
+        if (diff) return (size_t) (b - start) + (size_t) (__builtin_ctzll(diff) >> 3);
+        a += 8;
+        b += 8;
+    }
+#endif
+    while (b < end && *a == *b) {
+        a++;
+        b++;
+    }
+    return (size_t) (b - start);
+}
+
+static uint32_t hash4(uint32_t v) {
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+size_t lzBound(size_t n) {
+    return n + n / 255 + 16;
+}
+
+/* 15 in the token, the rest in 255-steps */
+static char *putLength(char *out, size_t len) {
+    while (len >= 255) {
+        *out++ = (char) 255;
+        len -= 255;
+    }
+    *out++ = (char) len;
+    return out;
+}
+
+static char *putSequence(char *out, const char *lit, size_t litLen, size_t distance, size_t matchLen) {
+    char *token = out++;
+    unsigned t = (litLen >= 15 ? 15u : (unsigned) litLen) << 4;
+    if (litLen >= 15) out = putLength(out, litLen - 15);
+    memcpy(out, lit, litLen);
+    out += litLen;
+    if (matchLen) {
+        size_t m = matchLen - LZ_MIN_MATCH;
+        *out++ = (char) (distance & 0xff);
+        *out++ = (char) (distance >> 8);
+        t |= m >= 15 ? 15u : (unsigned) m;
+        if (m >= 15) out = putLength(out, m - 15);
+    }
+    *token = (char) t;
+    return out;
+}
+
+size_t lzCompress(const char *src, size_t n, char *dst) {
+    uint32_t table[1 << HASH_BITS];
+    char *out = dst;
+    size_t anchor = 0, pos = 0;
+
+    if (n > LAST_LITERALS + LZ_MIN_MATCH) {
+        size_t limit = n - LAST_LITERALS - LZ_MIN_MATCH;
+        memset(table, 0, sizeof(table));
+        /* table entries hold position + 1, 0 is empty */
+        while (pos <= limit) {
+            uint32_t v = read32(src + pos);
+            uint32_t h = hash4(v);
+            size_t cand = table[h];
+            table[h] = (uint32_t) (pos + 1);
+            if (cand == 0 || pos - (cand - 1) > MAX_DISTANCE || read32(src + cand - 1) != v) {
+                /* skip faster through text that does not repeat */
+                pos += 1 + ((pos - anchor) >> 5);
+                continue;
+            }
+            size_t from = cand - 1;
+            size_t len = LZ_MIN_MATCH + commonLength(src + from + LZ_MIN_MATCH, src + pos + LZ_MIN_MATCH,
+                                                     src + n - LAST_LITERALS);
+            /* extend backwards into the pending literals */
+            while (pos > anchor && from > 0 && src[pos - 1] == src[from - 1]) {
+                pos--;
+                from--;
+                len++;
+            }
+            out = putSequence(out, src + anchor, pos - anchor, pos - from, len);
+            pos += len;
+            anchor = pos;
+            if (pos - 2 <= limit) table[hash4(read32(src + pos - 2))] = (uint32_t) (pos - 1);
+        }
+    }
+    return (size_t) (putSequence(out, src + anchor, n - anchor, 0, 0) - dst);
+}
+
+/* read an extended length; -1 on running off the end */
+static int getLength(const unsigned char **in, const unsigned char *end, size_t *len) {
+    unsigned char b;
+    do {
+        if (*in >= end) return -1;
+        b = *(*in)++;
+        *len += b;
+    } while (b == 255);
+    return 0;
+}
+
+int lzDecompress(const char *src, size_t packedLen, char *dst, size_t n) {
+    const unsigned char *in = (const unsigned char *) src, *end = in + packedLen;
+    size_t out = 0;
+
+    while (in < end) {
+        unsigned token = *in++;
+        size_t lit = token >> 4;
+        if (lit == 15 && getLength(&in, end, &lit) != 0) return -1;
+        if (lit > (size_t) (end - in) || lit > n - out) return -1;
+        if (lit <= 16 && end - in >= 16 && n - out >= 16) memcpy(dst + out, in, 16);   /* short runs: one fixed copy */
+        else memcpy(dst + out, in, lit);
+        in += lit;
+        out += lit;
+        if (in == end) break;   /* the last sequence has no match */
+
+        if (end - in < 2) return -1;
+        size_t distance = (size_t) in[0] | (size_t) in[1] << 8;
+        in += 2;
+        size_t len = token & 15;
+        if (len == 15 && getLength(&in, end, &len) != 0) return -1;
+        len += LZ_MIN_MATCH;
+        if (distance == 0 || distance > out || len > n - out) return -1;
+        char *to = dst + out;
+        const char *from = to - distance;
+        if (distance >= 8 && n - out >= len + 8) {
+            /* 8 bytes at a time, possibly past the match: a later
+             * sequence overwrites the excess */
+            for (size_t i = 0; i < len; i += 8) memcpy(to + i, from + i, 8);
+        } else if (distance >= len) {
+            memcpy(to, from, len);
+        } else {
+            /* overlapping copy repeats the last 'distance' bytes */
+            for (size_t i = 0; i < len; ++i) to[i] = from[i];
+        }
+        out += len;
+    }
+    return out == n ? 0 : -1;
+}
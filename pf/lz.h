@@ -0,0 +1,30 @@
+#ifndef PF_LZ_H
+#define PF_LZ_H
+
+#include <stddef.h>
+
+/* ---- Small LZ77 codec for blocks of text ----
+ *
+ * Byte-oriented, in the spirit of LZ4: a compressed block is a series of
+ * sequences, each a token byte (high nibble: literal count, low nibble:
+ * match length - LZ_MIN_MATCH; 15 means more length bytes follow, each
+ * adding up to 255), the literals, and then - except in the last sequence -
+ * a two-byte little-endian distance back into the output (1..65535) and
+ * any extra match length bytes. No framing and no checksum: the caller
+ * keeps the original length.
+ */
+
+#define LZ_MIN_MATCH 4
+
+/* Largest possible compressed size of n bytes */
+size_t lzBound(size_t n);
+
+/* Compress src[0..n) into dst, which must hold lzBound(n) bytes; returns
+ * the compressed size */
+size_t lzCompress(const char *src, size_t n, char *dst);
+
+/* Decompress a block of packedLen bytes that expands to exactly n bytes.
+ * Returns 0 on success, -1 if the block is corrupt. */
+int lzDecompress(const char *src, size_t packedLen, char *dst, size_t n);
+
+#endif
@@ -0,0 +1,459 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "memberreport.h"
+#include "instrument.h"
+
+#define SCAN_BLOCK 4096          // records read from a data file at a time
+#define SMALL_GROUP 32           // insertion sort below this many entries
+#define RUN_BUFFER (1u << 20)    // stdio buffer of each run file
+
+// ----- Fields and filter -----
+static const char *sortField(const Student *s, SortKey key) {
+    switch (key) {
+    case SORT_BY_REGDATE: return s->registrationDate;
+    case SORT_BY_DOB: return s->dob;
+    default: return s->name;
+    }
+}
+
+static size_t fieldLen(SortKey key) {
+    return key == SORT_BY_NAME ? NAME_LEN : DATE_LEN;
+}
+
+static int compareRows(const Student *a, const Student *b, SortKey key) {
+    return strncmp(sortField(a, key), sortField(b, key), fieldLen(key));
+}
+
+static int passes(const Student *s, const ReportSpec *spec) {
+    if (spec->batch && spec->batch[0] && strcmp(s->batch, spec->batch) != 0) return 0;
+    if (spec->membership && spec->membership[0] && !hasMembership(s, spec->membership)) return 0;
+    return 1;
+}
+
+// ----- Scanning a table or a data file -----
+typedef struct {
+    const ReportSpec *spec;
+    const Database *db;      // either the table...
+    size_t next;
+    FILE *f;                 // ...or a data file, read a block at a time
+    Student *block;
+    size_t blockCount, blockPos;
+} Scan;
+
+// Next live member that passes the filter, NULL at the end. The pointer is
+// valid until the next call.
+static const Student *scanNext(Scan *s) {
+    for (;;) {
+        const Student *row;
+        if (s->db) {
+            if (s->next >= s->db->members.size) return NULL;
+            size_t i = s->next++;
+            if (isTombstone(s->db, i)) continue;
+            row = &s->db->members.items[i];
+        } else {
+            if (s->blockPos == s->blockCount) {
+                s->blockCount = fread(s->block, sizeof(Student), SCAN_BLOCK, s->f);
+                s->blockPos = 0;
+                if (s->blockCount == 0) return NULL;
+            }
+            row = &s->block[s->blockPos++];
+            if (row->id == TOMBSTONE_ID) continue;
+        }
+        if (passes(row, s->spec)) return row;
+    }
+}
+
+// ----- In-memory sort -----
+// index: position of the record in 'base'; hi/lo: 16 bytes of its field
+typedef struct {
+    uint64_t hi, lo;
+    size_t index;
+} SortEntry;
+
+static void loadKey(SortEntry *e, const char *f, size_t len, size_t offset) {
+    unsigned char k[16];
+    size_t i = 0;
+    for (; i < 16 && offset + i < len && f[offset + i]; ++i) k[i] = (unsigned char)f[offset + i];
+    memset(k + i, 0, 16 - i);
+    e->hi = e->lo = 0;
+    for (i = 0; i < 8; ++i) {
+        e->hi = e->hi << 8 | k[i];
+        e->lo = e->lo << 8 | k[8 + i];
+    }
+}
+
+static unsigned keyByte(const SortEntry *e, int p) {
+    return p < 8 ? (unsigned)(e->hi >> (56 - 8 * p)) & 255 : (unsigned)(e->lo >> (120 - 8 * p)) & 255;
+}
+
+// Stable LSD radix sort on the 16 key bytes; skips bytes all keys share
+static void radixSort(SortEntry *a, SortEntry *tmp, size_t n) {
+    size_t count[16][256] = {{0}};
+    for (size_t i = 0; i < n; ++i)
+        for (int p = 0; p < 16; ++p) count[p][keyByte(&a[i], p)]++;
+
+    SortEntry *src = a, *dst = tmp;
+    for (int p = 15; p >= 0; --p) {
+        if (count[p][keyByte(&src[0], p)] == n) continue;
+        size_t sum = 0;
+        for (int b = 0; b < 256; ++b) {
+            size_t c = count[p][b];
+            count[p][b] = sum;
+            sum += c;
+        }
+        for (size_t i = 0; i < n; ++i) dst[count[p][keyByte(&src[i], p)]++] = src[i];
+        SortEntry *t = src; src = dst; dst = t;
+    }
+    if (src != a) memcpy(a, src, n * sizeof(SortEntry));
+}
+
+static void insertionSort(SortEntry *a, size_t n, const Student *base, SortKey key, size_t offset) {
+    size_t len = fieldLen(key) - offset;
+    for (size_t i = 1; i < n; ++i) {
+        SortEntry e = a[i];
+        const char *f = sortField(&base[e.index], key) + offset;
+        size_t j = i;
+        while (j > 0) {
+            int c = strncmp(f, sortField(&base[a[j - 1].index], key) + offset, len);
+            if (c > 0 || (c == 0 && e.index > a[j - 1].index)) break;
+            a[j] = a[j - 1];
+            j--;
+        }
+        a[j] = e;
+    }
+}
+
+// Sort a[0..n) by the field from byte 'offset' on; the entries tie on
+// everything before it and are in table order
+static void sortRange(SortEntry *a, SortEntry *tmp, size_t n, const Student *base, SortKey key, size_t offset) {
+    if (n < SMALL_GROUP) {
+        insertionSort(a, n, base, key, offset);
+        return;
+    }
+    size_t len = fieldLen(key);
+    for (size_t i = 0; i < n; ++i) loadKey(&a[i], sortField(&base[a[i].index], key), len, offset);
+    radixSort(a, tmp, n);
+    if (offset + 16 >= len) return;
+    for (size_t i = 0; i < n;) {
+        size_t j = i + 1;
+        while (j < n && a[j].hi == a[i].hi && a[j].lo == a[i].lo) j++;
+        // a slice ending in NUL padding already holds the rest of the field
+        if (j - i > 1 && (a[i].lo & 255)) sortRange(a + i, tmp + i, j - i, base, key, offset + 16);
+        i = j;
+    }
+}
+
+// ----- Reports -----
+typedef struct {
+    FILE *f;
+    Student head;      // next record of the run
+} Run;
+
+struct Report {
+    SortKey key;
+    // sorted in memory: the rows are base[order[next..count).index]
+    const Student *base;
+    Student *owned;
+    SortEntry *order;
+    size_t count, next;
+    // merged from run files: heap of run numbers, smallest head on top
+    Run *runs;
+    size_t runCount;
+    size_t *heap;
+    size_t heapCount;
+};
+
+static Report *newReport(const ReportSpec *spec) {
+    Report *r = (Report *) xmalloc(sizeof(Report));
+    memset(r, 0, sizeof(*r));
+    r->key = spec->key;
+    return r;
+}
+
+void reportClose(Report *r) {
+    if (!r) return;
+    for (size_t i = 0; i < r->runCount; ++i) fclose(r->runs[i].f);
+    free(r->runs);
+    free(r->heap);
+    free(r->order);
+    free(r->owned);
+    free(r);
+}
+
+// equal heads come out in run order, and runs are in table order
+static int runBefore(const Report *r, size_t a, size_t b) {
+    int c = compareRows(&r->runs[a].head, &r->runs[b].head, r->key);
+    return c < 0 || (c == 0 && a < b);
+}
+
+static void runSiftDown(Report *r, size_t i) {
+    for (;;) {
+        size_t best = i, left = 2 * i + 1, right = left + 1;
+        if (left < r->heapCount && runBefore(r, r->heap[left], r->heap[best])) best = left;
+        if (right < r->heapCount && runBefore(r, r->heap[right], r->heap[best])) best = right;
+        if (best == i) return;
+        size_t t = r->heap[i]; r->heap[i] = r->heap[best]; r->heap[best] = t;
+        i = best;
+    }
+}
+
+static void mergeStart(Report *r) {
+    r->heap = (size_t *) xrealloc(r->heap, (r->runCount ? r->runCount : 1) * sizeof(size_t));
+    r->heapCount = 0;
+    for (size_t i = 0; i < r->runCount; ++i) {
+        rewind(r->runs[i].f);
+        if (fread(&r->runs[i].head, sizeof(Student), 1, r->runs[i].f) == 1) r->heap[r->heapCount++] = i;
+    }
+    for (size_t i = r->heapCount / 2; i-- > 0;) runSiftDown(r, i);
+}
+
+static int mergeNext(Report *r, Student *out) {
+    if (r->heapCount == 0) return 0;
+    size_t top = r->heap[0];
+    *out = r->runs[top].head;
+    if (fread(&r->runs[top].head, sizeof(Student), 1, r->runs[top].f) != 1)
+        r->heap[0] = r->heap[--r->heapCount];
+    runSiftDown(r, 0);
+    return 1;
+}
+
+// An anonymous temporary file: removed by the system once closed
+static FILE *openRunFile(const char *tmpDir) {
+    FILE *f;
+    if (!tmpDir) {
+        f = tmpfile();
+    } else {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/q6runXXXXXX", tmpDir);
+        int fd = mkstemp(path);
+        if (fd < 0) return NULL;
+        unlink(path);
+        f = fdopen(fd, "w+b");
+        if (!f) close(fd);
+    }
+    if (f) setvbuf(f, NULL, _IOFBF, RUN_BUFFER);
+    return f;
+}
+
+static void addRun(Report *r, FILE *f) {
+    r->runs = (Run *) xrealloc(r->runs, (r->runCount + 1) * sizeof(Run));
+    r->runs[r->runCount++].f = f;
+}
+
+static FILE *writeRun(const Student *chunk, const SortEntry *order, size_t n, const char *tmpDir) {
+    PF_TIMED("question6.writeRun");
+    FILE *f = openRunFile(tmpDir);
+    if (!f) { perror("Cannot create run file"); return NULL; }
+    for (size_t i = 0; i < n; ++i) {
+        if (fwrite(&chunk[order[i].index], sizeof(Student), 1, f) != 1) {
+            perror("Error writing run file");
+            fclose(f);
+            return NULL;
+        }
+    }
+    if (fflush(f) != 0) { perror("Error writing run file"); fclose(f); return NULL; }
+    return f;
+}
+
+// Merge groups of REPORT_FAN_IN runs into longer runs until one heap can
+// take all of them
+static int reduceRuns(Report *r, const char *tmpDir) {
+    while (r->runCount > REPORT_FAN_IN) {
+        PF_TIMED("question6.mergePass");
+        Run *merged = NULL;
+        size_t mergedCount = 0;
+        for (size_t first = 0; first < r->runCount; first += REPORT_FAN_IN) {
+            Report part;
+            memset(&part, 0, sizeof(part));
+            part.key = r->key;
+            part.runs = r->runs + first;
+            part.runCount = r->runCount - first < REPORT_FAN_IN ? r->runCount - first : REPORT_FAN_IN;
+            FILE *out = openRunFile(tmpDir);
+            int failed = !out;
+            if (out) {
+                Student row;
+                mergeStart(&part);
+                while (!failed && mergeNext(&part, &row)) failed = fwrite(&row, sizeof(Student), 1, out) != 1;
+                failed = failed || fflush(out) != 0;
+            }
+            free(part.heap);
+            for (size_t i = 0; i < part.runCount; ++i) fclose(part.runs[i].f);
+            if (failed) {
+                perror("Error writing run file");
+                if (out) fclose(out);
+                // the runs not merged yet are still open
+                for (size_t i = first + part.runCount; i < r->runCount; ++i) fclose(r->runs[i].f);
+                free(r->runs);
+                r->runs = merged;
+                r->runCount = mergedCount;
+                return -1;
+            }
+            merged = (Run *) xrealloc(merged, (mergedCount + 1) * sizeof(Run));
+            merged[mergedCount++].f = out;
+        }
+        free(r->runs);
+        r->runs = merged;
+        r->runCount = mergedCount;
+    }
+    return 0;
+}
+
+Report *reportOpen(const Database *db, const ReportSpec *spec) {
+    PF_TIMED("question6.reportOpen");
+    Report *r = newReport(spec);
+    size_t cap = db->members.size ? db->members.size : 1;
+    SortEntry *tmp = (SortEntry *) xmalloc(cap * sizeof(SortEntry));
+    r->order = (SortEntry *) xmalloc(cap * sizeof(SortEntry));
+    Scan s = {.spec = spec, .db = db};
+    const Student *row;
+    while ((row = scanNext(&s))) r->order[r->count++].index = (size_t)(row - db->members.items);
+    sortRange(r->order, tmp, r->count, db->members.items, spec->key, 0);
+    free(tmp);
+    r->base = db->members.items;
+    return r;
+}
+
+Report *reportOpenFile(const char *filename, const ReportSpec *spec) {
+    PF_TIMED("question6.reportOpenFile");
+    FILE *f = fopen(filename, "rb");
+    if (!f) { perror("Cannot open file for read"); return NULL; }
+    Report *r = newReport(spec);
+    size_t limit = spec->memoryLimit ? spec->memoryLimit : REPORT_MEMORY;
+    size_t chunkCap = limit / (sizeof(Student) + 2 * sizeof(SortEntry));
+    if (chunkCap < SCAN_BLOCK) chunkCap = SCAN_BLOCK;
+    Student *chunk = (Student *) xmalloc(chunkCap * sizeof(Student));
+    SortEntry *order = (SortEntry *) xmalloc(chunkCap * sizeof(SortEntry));
+    SortEntry *tmp = (SortEntry *) xmalloc(chunkCap * sizeof(SortEntry));
+    Scan s = {.spec = spec, .f = f, .block = (Student *) xmalloc(SCAN_BLOCK * sizeof(Student))};
+    int failed = 0;
+
+    // sort chunk by chunk; a file that fits in one chunk stays in memory
+    const Student *row = scanNext(&s);
+    while (row && !failed) {
+        size_t n = 0;
+        for (; row && n < chunkCap; row = scanNext(&s)) {
+            chunk[n] = *row;
+            order[n].index = n;
+            n++;
+        }
+        sortRange(order, tmp, n, chunk, spec->key, 0);
+        if (!row && r->runCount == 0) {
+            r->base = r->owned = chunk;
+            r->order = order;
+            r->count = n;
+            chunk = NULL;
+            order = NULL;
+            break;
+        }
+        FILE *run = writeRun(chunk, order, n, spec->tmpDir);
+        if (run) addRun(r, run);
+        else failed = 1;
+    }
+    free(chunk);
+    free(order);
+    free(tmp);
+    free(s.block);
+    fclose(f);
+
+    if (!failed && r->runCount > 0) {
+        failed = reduceRuns(r, spec->tmpDir) != 0;
+        if (!failed) mergeStart(r);
+    }
+    if (failed) {
+        reportClose(r);
+        return NULL;
+    }
+    return r;
+}
+
+size_t reportRead(Report *r, Student *rows, size_t max) {
+    size_t k = 0;
+    if (r->runCount > 0) {
+        while (k < max && mergeNext(r, &rows[k])) k++;
+    } else {
+        while (k < max && r->next < r->count) rows[k++] = r->base[r->order[r->next++].index];
+    }
+    return k;
+}
+
+// ----- First page -----
+typedef struct {
+    Student row;
+    size_t seq;        // position in the scan, breaks ties
+} Ranked;
+
+static int rankedAfter(const Ranked *a, const Ranked *b, SortKey key) {
+    int c = compareRows(&a->row, &b->row, key);
+    return c > 0 || (c == 0 && a->seq > b->seq);
+}
+
+// max-heap: the row that would be printed last is on top
+static void rankedSiftDown(Ranked *heap, size_t count, size_t i, SortKey key) {
+    for (;;) {
+        size_t worst = i, left = 2 * i + 1, right = left + 1;
+        if (left < count && rankedAfter(&heap[left], &heap[worst], key)) worst = left;
+        if (right < count && rankedAfter(&heap[right], &heap[worst], key)) worst = right;
+        if (worst == i) return;
+        Ranked t = heap[i]; heap[i] = heap[worst]; heap[worst] = t;
+        i = worst;
+    }
+}
+
+static size_t topN(Scan *s, SortKey key, Student *rows, size_t n) {
+    PF_TIMED("question6.reportTopN");
+    if (n == 0) return 0;
+    // the heap grows with the rows seen, so a page size far past the
+    // number of rows costs no more than the rows
+    size_t cap = n < 1024 ? n : 1024;
+    Ranked *heap = (Ranked *) xmalloc(cap * sizeof(Ranked));
+    size_t count = 0, seq = 0;
+    const Student *row;
+    while ((row = scanNext(s))) {
+        if (count < n) {
+            if (count == cap) {
+                cap = cap > n / 2 ? n : cap * 2;
+                heap = (Ranked *) xrealloc(heap, cap * sizeof(Ranked));
+            }
+            // sift up
+            size_t i = count++;
+            heap[i].row = *row;
+            heap[i].seq = seq;
+            while (i > 0 && rankedAfter(&heap[i], &heap[(i - 1) / 2], key)) {
+                Ranked t = heap[i]; heap[i] = heap[(i - 1) / 2]; heap[(i - 1) / 2] = t;
+                i = (i - 1) / 2;
+            }
+        } else if (compareRows(row, &heap[0].row, key) < 0) {
+            // a later row that only ties with the top never gets in
+            heap[0].row = *row;
+            heap[0].seq = seq;
+            rankedSiftDown(heap, count, 0, key);
+        }
+        seq++;
+    }
+    // heap sort what is left into printing order
+    for (size_t end = count; end > 1; --end) {
+        Ranked t = heap[0]; heap[0] = heap[end - 1]; heap[end - 1] = t;
+        rankedSiftDown(heap, end - 1, 0, key);
+    }
+    for (size_t i = 0; i < count; ++i) rows[i] = heap[i].row;
+    free(heap);
+    return count;
+}
+
+size_t reportTopN(const Database *db, const ReportSpec *spec, Student *rows, size_t n) {
+    Scan s = {.spec = spec, .db = db};
+    return topN(&s, spec->key, rows, n);
+}
+
+size_t reportTopNFile(const char *filename, const ReportSpec *spec, Student *rows, size_t n) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) { perror("Cannot open file for read"); return 0; }
+    Scan s = {.spec = spec, .f = f, .block = (Student *) xmalloc(SCAN_BLOCK * sizeof(Student))};
+    size_t count = topN(&s, spec->key, rows, n);
+    free(s.block);
+    fclose(f);
+    return count;
+}
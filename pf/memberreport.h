@@ -0,0 +1,50 @@
+#ifndef PF_MEMBERREPORT_H
+#define PF_MEMBERREPORT_H
+
+#include <stddef.h>
+#include "question6.h"
+
+// ----- Sorted, paged member reports -----
+//
+// A report streams the members that pass a batch/membership filter in
+// order of one field. Reports over the in-memory table sort an index of it;
+// reports over a data file (which may be larger than memory) sort it in
+// chunks of memoryLimit bytes, spill each sorted chunk to a temporary run
+// file and merge the runs with a heap (REPORT_FAN_IN at a time). A file
+// that fits in one chunk is sorted in memory without temporary files.
+//
+// Sorting is an LSD radix sort on 16-byte slices of the field, recursing
+// into groups that tie on a slice, with insertion sort for small groups.
+// Equal fields keep their table order.
+//
+// For a first page, reportTopN keeps the best n rows in a heap during one
+// pass and sorts nothing else.
+
+#define REPORT_MEMORY (256u << 20)  // default memoryLimit
+#define REPORT_FAN_IN 64            // runs merged at once
+
+typedef enum { SORT_BY_NAME, SORT_BY_REGDATE, SORT_BY_DOB } SortKey;
+
+typedef struct {
+    SortKey key;
+    const char *batch;        // only this batch; NULL or "" for all
+    const char *membership;   // as in displayBatchReport; NULL or "" for any
+    size_t memoryLimit;       // bytes to sort in memory, 0 for REPORT_MEMORY
+    const char *tmpDir;       // where run files go, NULL for tmpfile()
+} ReportSpec;
+
+typedef struct Report Report;
+
+// NULL on error (message printed). A report over the table reads it in
+// place: do not edit the table until reportClose().
+Report *reportOpen(const Database *db, const ReportSpec *spec);
+Report *reportOpenFile(const char *filename, const ReportSpec *spec);
+// Copy the next rows (at most max) into rows; 0 at the end
+size_t reportRead(Report *r, Student *rows, size_t max);
+void reportClose(Report *r);
+
+// The first n rows of the report, in order; returns how many there are
+size_t reportTopN(const Database *db, const ReportSpec *spec, Student *rows, size_t n);
+size_t reportTopNFile(const char *filename, const ReportSpec *spec, Student *rows, size_t n);
+
+#endif
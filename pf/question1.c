@@ -1,4 +1,8 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "question1.h"
+#include "loanschedule.h"
 
 double calculateRepayment(double loan, double interestRate, int years, double installment) {
 
@@ -20,7 +24,38 @@ double calculateRepayment(double loan, double interestRate, int years, double in
     return installment + calculateRepayment(loan, interestRate, years - 1, installment);
 }
 
-int main() {
+#ifndef PFTHEORY_NO_MAIN
+// question1 --schedule LOAN RATE YEARS INSTALLMENT [--rate YEAR RATE]...
+// [--prepay YEAR AMOUNT]...: the schedule with rate changes and prepayments
+static int scheduleMain(int argc, char **argv) {
+    struct LoanSchedule *s = scheduleCreate(strtod(argv[2], NULL), strtod(argv[3], NULL),
+                                            atoi(argv[4]), strtod(argv[5], NULL));
+    for (int i = 6; i < argc; i++) {
+        int bad = 1;
+        if (strcmp(argv[i], "--rate") == 0 && i + 2 < argc) {
+            bad = scheduleSetRate(s, atoi(argv[i + 1]), strtod(argv[i + 2], NULL)) != 0;
+        } else if (strcmp(argv[i], "--prepay") == 0 && i + 2 < argc) {
+            bad = schedulePrepay(s, atoi(argv[i + 1]), strtod(argv[i + 2], NULL)) != 0;
+        }
+        if (bad) {
+            fprintf(stderr, "usage: question1 [--schedule LOAN RATE YEARS INSTALLMENT "
+                            "[--rate YEAR RATE]... [--prepay YEAR AMOUNT]...]\n");
+            scheduleFree(s);
+            return 2;
+        }
+        i += 2;
+    }
+
+    printf("Loan Repayment Schedule:\n");
+    schedulePrint(s);
+    printf("\nTotal repayment over %d years = %.2f\n", schedulePeriodsRun(s), scheduleTotalPaid(s));
+    scheduleFree(s);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 6 && strcmp(argv[1], "--schedule") == 0) return scheduleMain(argc, argv);
+
     double loan = 100000;
     double interestRate = 0.05;
     int years = 3;
@@ -33,3 +68,4 @@ int main() {
 
     return 0;
 }
+#endif
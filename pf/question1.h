@@ -0,0 +1,7 @@
+#ifndef PF_QUESTION1_H
+#define PF_QUESTION1_H
+
+// Recursive yearly repayment: prints every year, returns the total paid
+double calculateRepayment(double loan, double interestRate, int years, double installment);
+
+#endif
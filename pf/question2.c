@@ -1,41 +1,362 @@
 #include <stdio.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "question2.h"
 
+void traceInit(TraceSink *sink, FILE *out, size_t capacity) {
+    if (capacity < 256) capacity = 256;
+    sink->out = out;
+    sink->buf = (char *) malloc(capacity);
+    if (!sink->buf) {
+        perror("malloc failed");
+        exit(1);
+    }
+    sink->len = 0;
+    sink->cap = capacity;
+}
+
+void traceFlush(TraceSink *sink) {
+    if (sink->len > 0) {
+        fwrite(sink->buf, 1, sink->len, sink->out);
+        sink->len = 0;
+    }
+    fflush(sink->out);
+}
+
+void traceFree(TraceSink *sink) {
+    traceFlush(sink);
+    free(sink->buf);
+    sink->buf = NULL;
+    sink->cap = 0;
+}
+
+// Append one formatted message; a single message is always < 128 bytes
+static void traceWrite(TraceSink *sink, const char *fmt, long long a, long long b) {
+    if (sink->len + 128 > sink->cap) {
+        fwrite(sink->buf, 1, sink->len, sink->out);
+        sink->len = 0;
+    }
+    sink->len += (size_t) snprintf(sink->buf + sink->len, sink->cap - sink->len, fmt, a, b);
+}
+
+// Iterative simulation starting at 'planet': visits the planets one by one,
+// optionally tracing every step into 'sink' (pass NULL for no trace).
+MissionResult simulateMissionFrom(const MissionConfig *cfg, int planet, TraceSink *sink) {
+    MissionResult res;
+    long long fuel = cfg->fuel;
+
+    for (;;) {
+        // Fuel exhausted
+        if (fuel <= 0) {
+            if (sink) traceWrite(sink, "Planet %lld: Fuel depleted! Mission failed.\n", planet, 0);
+            res.success = 0;
+            res.failPlanet = planet;
+            break;
+        }
+
+        // All planets visited
+        if (planet > cfg->totalPlanets) {
+            if (sink) traceWrite(sink, "Mission completed successfully!\n", 0, 0);
+            res.success = 1;
+            res.failPlanet = 0;
+            break;
+        }
+
+        // Consumption, gravitational assist and solar bonus every 4th planet
+        fuel += (long long) cfg->recharge - cfg->consumption;
+        if (planet % 4 == 0) {
+            fuel += cfg->solarBonus;
+        }
+
+        if (sink) traceWrite(sink, "Planet %lld: Fuel Remaining = %lld\n", planet, fuel);
+        planet++;
+    }
+
+    res.finalFuel = fuel;
+    return res;
+}
+
+MissionResult simulateMission(const MissionConfig *cfg, TraceSink *sink) {
+    return simulateMissionFrom(cfg, 1, sink);
+}
+
+// Closed-form evaluation. After p planets the fuel is
+//     f(p) = fuel - p*d + (p/4)*solarBonus,   d = consumption - recharge
+// so inside every block of 4 planets it moves linearly and between blocks
+// it shifts by D = solarBonus - 4d. The first block whose minimum reaches 0
+// is found directly, then at most 4 planets of that block are checked.
+MissionResult missionClosedForm(const MissionConfig *cfg) {
+    MissionResult res;
+    long long f0 = cfg->fuel;
+    long long d = (long long) cfg->consumption - cfg->recharge;
+    long long s = cfg->solarBonus;
+    long long n = cfg->totalPlanets < 0 ? 0 : cfg->totalPlanets;
+    long long D = s - 4 * d;
+    long long dip = d > 0 ? -3 * d : 0;  // lowest point of a block relative to its start
+    long long k;
+
+    if (f0 + dip > 0) {
+        if (D >= 0) {
+            k = -1;                          // never drops below the first block
+        } else {
+            k = (f0 + dip + (-D) - 1) / (-D); // first block with f0 + k*D + dip <= 0
+        }
+    } else {
+        k = 0;
+    }
+
+    if (k >= 0 && 4 * k <= n) {
+        for (long long j = 0; j < 4; j++) {
+            long long p = 4 * k + j;
+            if (p > n) break;
+            long long f = f0 + k * D - j * d;
+            if (f <= 0) {
+                res.success = 0;
+                res.failPlanet = (int) (p + 1);
+                res.finalFuel = f;
+                return res;
+            }
+        }
+    }
+
+    res.success = 1;
+    res.failPlanet = 0;
+    res.finalFuel = f0 - n * d + (n / 4) * s;
+    return res;
+}
+
+// Evaluate many configurations; untraced, so the closed form is used
+void simulateBatch(const MissionConfig *cfgs, MissionResult *results, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        results[i] = missionClosedForm(&cfgs[i]);
+    }
+}
+
+// Kept for the original interface: traces every planet to stdout
 int calculateFuel(int fuel, int consumption, int recharge,
                   int solarBonus, int planet, int totalPlanets) {
+    MissionConfig cfg;
+    TraceSink sink;
+
+    cfg.fuel = fuel;
+    cfg.consumption = consumption;
+    cfg.recharge = recharge;
+    cfg.solarBonus = solarBonus;
+    cfg.totalPlanets = totalPlanets;
+
+    traceInit(&sink, stdout, 1 << 16);
+    MissionResult res = simulateMissionFrom(&cfg, planet, &sink);
+    traceFree(&sink);
+    return res.success;
+}
 
-    // Base case: fuel exhausted
-    if (fuel <= 0) {
-        printf("Planet %d: Fuel depleted! Mission failed.\n", planet);
-        return 0; // failure
+// ------------------------------------------------------------
+// Feasibility search: minimum starting fuel / recharge for a route
+// ------------------------------------------------------------
+// Fuel after every planet grows with the starting fuel and with the
+// recharge, so feasibility is monotone in both and binary search applies.
+
+// Smallest fuel in [lo, hi] that completes the mission, or hi + 1 if none
+// (hi is taken as at most INT_MAX - 1, so that hi + 1 is an int)
+int minStartFuel(const MissionConfig *base, int lo, int hi) {
+    MissionConfig cfg = *base;
+    if (hi > INT_MAX - 1) hi = INT_MAX - 1;
+    int answer = hi + 1;
+    long long l = lo, h = hi;   // mid - 1 and mid + 1 step past the int range
+    while (l <= h) {
+        long long mid = l + (h - l) / 2;
+        cfg.fuel = (int) mid;
+        if (missionClosedForm(&cfg).success) {
+            answer = (int) mid;
+            h = mid - 1;
+        } else {
+            l = mid + 1;
+        }
+    }
+    return answer;
+}
+
+// Smallest recharge in [lo, hi] that completes the mission, or hi + 1 if none
+// (hi is taken as at most INT_MAX - 1, so that hi + 1 is an int)
+int minRecharge(const MissionConfig *base, int lo, int hi) {
+    MissionConfig cfg = *base;
+    if (hi > INT_MAX - 1) hi = INT_MAX - 1;
+    int answer = hi + 1;
+    long long l = lo, h = hi;   // mid - 1 and mid + 1 step past the int range
+    while (l <= h) {
+        long long mid = l + (h - l) / 2;
+        cfg.recharge = (int) mid;
+        if (missionClosedForm(&cfg).success) {
+            answer = (int) mid;
+            h = mid - 1;
+        } else {
+            l = mid + 1;
+        }
     }
+    return answer;
+}
+
+typedef struct {
+    MissionConfig base;
+    FuelFrontier *frontier;
+    int rowLo;
+    int rowHi;
+    long long evaluations;
+} FrontierTask;
 
-    // Base case: all planets visited
-    if (planet > totalPlanets) {
-        printf("Mission completed successfully!\n");
-        return 1; // success
+// Rows [rowLo, rowHi] are known to have answers within [fuelLo, fuelHi]:
+// solve the middle row, then recurse with the bound it gives each half.
+// When both bounds meet, the whole band is dominated and filled directly.
+static void frontierSolve(FrontierTask *task, int rowLo, int rowHi, int fuelLo, int fuelHi) {
+    FuelFrontier *fr = task->frontier;
+    while (rowLo <= rowHi) {
+        if (fuelLo == fuelHi) {
+            for (int r = rowLo; r <= rowHi; r++) fr->minFuel[r] = fuelLo;
+            return;
+        }
+        int mid = rowLo + (rowHi - rowLo) / 2;
+        MissionConfig cfg = task->base;
+        cfg.recharge = fr->rechargeMin + mid;
+
+        // Binary search restricted to the known band; fuelHi may be the
+        // "infeasible" marker fuelMax + 1, which is never evaluated.
+        long long lo = fuelLo, hi = fuelHi;
+        int answer = fuelHi;
+        if (hi > fr->fuelMax) hi = fr->fuelMax;
+        while (lo <= hi) {
+            long long m = lo + (hi - lo) / 2;
+            cfg.fuel = (int) m;
+            task->evaluations++;
+            if (missionClosedForm(&cfg).success) {
+                answer = (int) m;
+                hi = m - 1;
+            } else {
+                lo = m + 1;
+            }
+        }
+        fr->minFuel[mid] = answer;
+
+        // Lower recharge needs at least as much fuel, higher needs at most
+        frontierSolve(task, rowLo, mid - 1, answer, fuelHi);
+        rowLo = mid + 1;
+        fuelHi = answer;
     }
+}
 
-    // Fuel consumption at each planetary stop
-    fuel -= consumption;
+static void *frontierWorker(void *arg) {
+    FrontierTask *task = (FrontierTask *) arg;
+    frontierSolve(task, task->rowLo, task->rowHi,
+                  task->frontier->fuelMin, task->frontier->fuelMax + 1);
+    return NULL;
+}
 
-    // Gravitational assist recharge
-    fuel += recharge;
+// Frontier over the (recharge x fuel) grid, see FuelFrontier.
+// Fill 'fr' (rows, fuel range and minFuel array set by the caller) using
+// 'threads' workers, each owning a contiguous band of recharge rows.
+void searchFrontier(const MissionConfig *base, FuelFrontier *fr, int threads) {
+    long long rows = (long long) fr->rechargeMax - fr->rechargeMin + 1;
+    if (rows <= 0 || rows > INT_MAX) return;
+    if (fr->fuelMax > INT_MAX - 1) fr->fuelMax = INT_MAX - 1;   // fuelMax + 1 marks "none"
+    if (threads < 1) threads = 1;
+    if (threads > rows) threads = rows;
 
-    // Solar bonus every 4th planet
-    if (planet % 4 == 0) {
-        fuel += solarBonus;
+    FrontierTask *tasks = (FrontierTask *) malloc((size_t) threads * sizeof(FrontierTask));
+    pthread_t *tids = (pthread_t *) malloc((size_t) threads * sizeof(pthread_t));
+    if (!tasks || !tids) {
+        perror("malloc failed");
+        exit(1);
     }
 
-    // Print status
-    printf("Planet %d: Fuel Remaining = %d\n", planet, fuel);
+    for (int t = 0; t < threads; t++) {
+        tasks[t].base = *base;
+        tasks[t].frontier = fr;
+        tasks[t].rowLo = (int) ((long long) rows * t / threads);
+        tasks[t].rowHi = (int) ((long long) rows * (t + 1) / threads) - 1;
+        tasks[t].evaluations = 0;
+    }
+    for (int t = 1; t < threads; t++) {
+        if (pthread_create(&tids[t], NULL, frontierWorker, &tasks[t]) != 0) {
+            frontierWorker(&tasks[t]); // fall back to running it here
+            tids[t] = 0;
+        }
+    }
+    frontierWorker(&tasks[0]);
 
-    // Recursive call for next planet
-    return calculateFuel(fuel, consumption, recharge,
-                         solarBonus, planet + 1, totalPlanets);
+    fr->evaluations = tasks[0].evaluations;
+    for (int t = 1; t < threads; t++) {
+        if (tids[t]) pthread_join(tids[t], NULL);
+        fr->evaluations += tasks[t].evaluations;
+    }
+
+    free(tasks);
+    free(tids);
+}
+
+// Print the corners of the staircase (rows where the minimum fuel changes)
+void printFrontier(const FuelFrontier *fr) {
+    long long rows = (long long) fr->rechargeMax - fr->rechargeMin + 1;
+    printf("%-10s %-10s\n", "Recharge", "MinFuel");
+    for (long long r = 0; r < rows; r++) {
+        if (r > 0 && fr->minFuel[r] == fr->minFuel[r - 1]) continue;
+        if (fr->minFuel[r] > fr->fuelMax)
+            printf("%-10lld %-10s\n", fr->rechargeMin + r, "none");
+        else
+            printf("%-10lld %-10d\n", fr->rechargeMin + r, fr->minFuel[r]);
+    }
 }
 
+#ifndef PFTHEORY_NO_MAIN
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "search") == 0) {
+        // search <planets> <consumption> <solarBonus> <fuelMax> <rechargeMin> <rechargeMax> [threads]
+        if (argc < 8) {
+            fprintf(stderr, "usage: %s search <planets> <consumption> <solarBonus> "
+                            "<fuelMax> <rechargeMin> <rechargeMax> [threads]\n", argv[0]);
+            return 1;
+        }
+        MissionConfig base;
+        FuelFrontier fr;
+        base.totalPlanets = atoi(argv[2]);
+        base.consumption = atoi(argv[3]);
+        base.solarBonus = atoi(argv[4]);
+        base.fuel = 0;
+        base.recharge = 0;
+        fr.fuelMin = 1;
+        fr.fuelMax = atoi(argv[5]);
+        fr.rechargeMin = atoi(argv[6]);
+        fr.rechargeMax = atoi(argv[7]);
+        int threads = argc > 8 ? atoi(argv[8]) : 4;
+        if (fr.rechargeMax < fr.rechargeMin || fr.fuelMax < fr.fuelMin) {
+            fprintf(stderr, "empty search range\n");
+            return 1;
+        }
+        long long rows = (long long) fr.rechargeMax - fr.rechargeMin + 1;
+        if (rows > INT_MAX) {
+            fprintf(stderr, "recharge range too large\n");
+            return 1;
+        }
+        fr.minFuel = (int *) malloc((size_t) rows * sizeof(int));
+        if (!fr.minFuel) {
+            perror("malloc failed");
+            return 1;
+        }
+        searchFrontier(&base, &fr, threads);
+        printf("Feasibility frontier for %d planets (consumption %d, solar bonus %d):\n",
+               base.totalPlanets, base.consumption, base.solarBonus);
+        printFrontier(&fr);
+
+        base.fuel = fr.fuelMax;
+        int r = minRecharge(&base, fr.rechargeMin, fr.rechargeMax);
+        if (r <= fr.rechargeMax)
+            printf("\nMinimum recharge with fuel %d: %d\n", fr.fuelMax, r);
+        else
+            printf("\nNo recharge in range completes the route with fuel %d\n", fr.fuelMax);
+        free(fr.minFuel);
+        return 0;
+    }
 
-int main() {
     int fuel = 500;
     int consumption = 60;
     int recharge = 20;
@@ -54,3 +375,4 @@ int main() {
 
     return 0;
 }
+#endif
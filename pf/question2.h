@@ -0,0 +1,66 @@
+#ifndef PF_QUESTION2_H
+#define PF_QUESTION2_H
+
+#include <stdio.h>
+
+// Parameters of one mission (all constant along the route)
+typedef struct {
+    int fuel;
+    int consumption;
+    int recharge;
+    int solarBonus;
+    int totalPlanets;
+} MissionConfig;
+
+// Outcome of one mission
+typedef struct {
+    int success;          // 1 = all planets visited, 0 = fuel depleted
+    int failPlanet;       // planet where fuel ran out (0 on success)
+    long long finalFuel;  // fuel left when the mission ended
+} MissionResult;
+
+// Buffered sink for step traces; output is written out in large blocks
+// instead of one stdio call per planet.
+typedef struct {
+    FILE *out;
+    char *buf;
+    size_t len;
+    size_t cap;
+} TraceSink;
+
+void traceInit(TraceSink *sink, FILE *out, size_t capacity);
+void traceFlush(TraceSink *sink);
+void traceFree(TraceSink *sink);
+
+// Iterative simulation with optional trace (sink may be NULL)
+MissionResult simulateMissionFrom(const MissionConfig *cfg, int planet, TraceSink *sink);
+MissionResult simulateMission(const MissionConfig *cfg, TraceSink *sink);
+
+// Closed-form outcome for constant parameters (no trace)
+MissionResult missionClosedForm(const MissionConfig *cfg);
+void simulateBatch(const MissionConfig *cfgs, MissionResult *results, size_t count);
+
+// Original entry point: traces every planet to stdout, returns 1 on success
+int calculateFuel(int fuel, int consumption, int recharge,
+                  int solarBonus, int planet, int totalPlanets);
+
+// Frontier over the (recharge x fuel) grid: for every recharge row in
+// [rechargeMin, rechargeMax] the minimum feasible fuel in [fuelMin, fuelMax]
+// (fuelMax + 1 when the row has no feasible cell; searchFrontier lowers a
+// fuelMax of INT_MAX by one so that fits). The frontier is a
+// non-increasing staircase, which is what the search exploits.
+typedef struct {
+    int rechargeMin;
+    int rechargeMax;
+    int fuelMin;
+    int fuelMax;
+    int *minFuel;           // one entry per recharge row
+    long long evaluations;  // closed-form checks actually performed
+} FuelFrontier;
+
+int minStartFuel(const MissionConfig *base, int lo, int hi);
+int minRecharge(const MissionConfig *base, int lo, int hi);
+void searchFrontier(const MissionConfig *base, FuelFrontier *fr, int threads);
+void printFrontier(const FuelFrontier *fr);
+
+#endif
@@ -1,44 +1,64 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include "question3.h"
+#include "empstream.h"
+#include "outbuf.h"
+
+
+#ifndef PFTHEORY_NO_MAIN
+// question3 --stream FILE [--bonus THRESHOLD] [--chunk MB]: one pass over a
+// saved (or CSV) employee file instead of the interactive menu
+static int streamMain(int argc, char **argv) {
+    struct StreamOptions opt = {0, 0, 0};
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--bonus") == 0 && i + 1 < argc) {
+            opt.applyBonus = 1;
+            opt.threshold = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            opt.chunkBytes = (size_t) (strtod(argv[++i], NULL) * (1 << 20));
+        } else {
+            fprintf(stderr, "usage: question3 [--stream FILE [--bonus THRESHOLD] [--chunk MB]]\n");
+            return 2;
+        }
+    }
+    struct StreamStats st;
+    if (streamEmployees(argv[2], &opt, &st) != 0) return 1;
+    printStreamStats(&st, &opt, stdout);
+    return 0;
+}
 
-// Structure to store employee details
-struct Employee {
-    int id;
-    char name[50];
-    char designation[50];
-    float salary;
-};
-
-// Function prototypes
-void displayEmployees(struct Employee emp[], int n);
-void findHighestSalary(struct Employee emp[], int n);
-void searchEmployee(struct Employee emp[], int n);
-void giveBonus(struct Employee emp[], int n, float threshold); // for explanation
-
-
-int main() {
+int main(int argc, char **argv) {
     int n;
 
+    if (argc >= 3 && strcmp(argv[1], "--stream") == 0) return streamMain(argc, argv);
+
     printf("Enter number of employees: ");
     scanf("%d", &n);
 
-    struct Employee emp[n];
+    EmployeeStore staff;
+    employeeStoreInit(&staff);
+    employeeStoreReserve(&staff, n > 0 ? (size_t) n : 0);
 
     // Input employee records
     for (int i = 0; i < n; i++) {
+        struct Employee e;
         printf("\nEnter details for Employee %d:\n", i + 1);
         printf("ID: ");
-        scanf("%d", &emp[i].id);
+        scanf("%d", &e.id);
 
         printf("Name: ");
-        scanf("%s", emp[i].name);
+        scanf("%s", e.name);
 
         printf("Designation: ");
-        scanf("%s", emp[i].designation);
+        scanf("%s", e.designation);
 
         printf("Salary: ");
-        scanf("%f", &emp[i].salary);
+        scanf("%f", &e.salary);
+
+        employeeStorePush(&staff, &e);
     }
+    struct Employee *emp = staff.items;
 
     int choice;
 
@@ -49,6 +69,7 @@ int main() {
         printf("3. Search Employee (ID or Name)\n");
         printf("4. Give Bonus to Low Salary Employees\n");
         printf("5. Exit\n");
+        printf("6. Save Employees to File\n");
         printf("Enter choice: ");
         scanf("%d", &choice);
 
@@ -62,7 +83,7 @@ int main() {
                 break;
 
             case 3:
-                searchEmployee(emp, n);
+                searchEmployee(&staff);
                 break;
 
             case 4:
@@ -73,14 +94,24 @@ int main() {
                 printf("Exiting program...\n");
                 break;
 
+            case 6: {
+                char path[256];
+                printf("File name: ");
+                if (scanf("%255s", path) == 1 && saveEmployees(path, &staff) == 0)
+                    printf("Saved %d employees to %s.\n", n, path);
+                break;
+            }
+
             default:
                 printf("Invalid choice! Try again.\n");
         }
 
     } while (choice != 5);
 
+    employeeStoreFree(&staff);
     return 0;
 }
+#endif
 
 
 
@@ -91,10 +122,19 @@ void displayEmployees(struct Employee emp[], int n) {
     printf("\n%-10s %-20s %-20s %-10s\n", "ID", "Name", "Designation", "Salary");
     printf("---------------------------------------------------------------\n");
 
+    // one row: "%-10d %-20s %-20s %-10.2f\n"
+    OutBuf *o = outBegin();
     for (int i = 0; i < n; i++) {
-        printf("%-10d %-20s %-20s %-10.2f\n",
-               emp[i].id, emp[i].name, emp[i].designation, emp[i].salary);
+        outPadInt(o, emp[i].id, 10, OUT_LEFT);
+        outChar(o, ' ');
+        outPadStr(o, emp[i].name, 20, OUT_LEFT);
+        outChar(o, ' ');
+        outPadStr(o, emp[i].designation, 20, OUT_LEFT);
+        outChar(o, ' ');
+        outPadFixed(o, emp[i].salary, 2, 10, OUT_LEFT);
+        outChar(o, '\n');
     }
+    outEnd(o);
 }
 
 
@@ -123,7 +163,7 @@ void findHighestSalary(struct Employee emp[], int n) {
 // ------------------------------------------------------------
 // Function 3: Search employee by ID or Name
 // ------------------------------------------------------------
-void searchEmployee(struct Employee emp[], int n) {
+void searchEmployee(const EmployeeStore *staff) {
     int choice;
     printf("\nSearch By:\n1. ID\n2. Name\nEnter choice: ");
     scanf("%d", &choice);
@@ -133,13 +173,13 @@ void searchEmployee(struct Employee emp[], int n) {
         printf("Enter ID to search: ");
         scanf("%d", &id);
 
-        for (int i = 0; i < n; i++) {
-            if (emp[i].id == id) {
-                printf("\nEmployee Found:\n");
-                printf("ID: %d\nName: %s\nDesignation: %s\nSalary: %.2f\n",
-                       emp[i].id, emp[i].name, emp[i].designation, emp[i].salary);
-                return;
-            }
+        size_t i = employeeStoreFind(staff, id);
+        if (i != RECSTORE_NONE) {
+            const struct Employee *e = &staff->items[i];
+            printf("\nEmployee Found:\n");
+            printf("ID: %d\nName: %s\nDesignation: %s\nSalary: %.2f\n",
+                   e->id, e->name, e->designation, e->salary);
+            return;
         }
         printf("No employee found with ID %d.\n", id);
     }
@@ -149,11 +189,12 @@ void searchEmployee(struct Employee emp[], int n) {
         printf("Enter Name to search: ");
         scanf("%s", name);
 
-        for (int i = 0; i < n; i++) {
-            if (strcmp(emp[i].name, name) == 0) {
+        for (size_t i = 0; i < staff->size; i++) {
+            const struct Employee *e = &staff->items[i];
+            if (strcmp(e->name, name) == 0) {
                 printf("\nEmployee Found:\n");
                 printf("ID: %d\nName: %s\nDesignation: %s\nSalary: %.2f\n",
-                       emp[i].id, emp[i].name, emp[i].designation, emp[i].salary);
+                       e->id, e->name, e->designation, e->salary);
                 return;
             }
         }
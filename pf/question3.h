@@ -0,0 +1,25 @@
+#ifndef PF_QUESTION3_H
+#define PF_QUESTION3_H
+
+#include "recstore.h"
+
+// Structure to store employee details
+struct Employee {
+    int id;
+    char name[50];
+    char designation[50];
+    float salary;
+};
+
+// Employees in input order, indexed by ID
+#define EMPLOYEE_ID(e) ((e)->id)
+RECSTORE_DEFINE(EmployeeStore, employeeStore, struct Employee, int, EMPLOYEE_ID,
+                recstoreHashInt, RECSTORE_EQ, RECSTORE_ALL)
+
+// Function prototypes
+void displayEmployees(struct Employee emp[], int n);
+void findHighestSalary(struct Employee emp[], int n);
+void searchEmployee(const EmployeeStore *staff);
+void giveBonus(struct Employee emp[], int n, float threshold); // for explanation
+
+#endif
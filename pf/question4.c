@@ -1,10 +1,18 @@
 #include <stdio.h>
-
-struct Book {
-    int id;
-    int pop;
-    int lastAccess;   // Used to determine least recently accessed
-};
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "question4.h"
+#include "shelfdisk.h"
+#include "timerwheel.h"
+#include "instrument.h"
 
 // Function to find a book
 int findBook(struct Book shelf[], int capacity, int id) {
@@ -26,6 +34,8 @@ int findEmpty(struct Book shelf[], int capacity) {
 
 // Function to remove LRA (Least Recently Accessed) book
 int findLRA(struct Book shelf[], int capacity) {
+    PF_TIMED("question4.findLRA");
+    PF_COUNT("question4.findLRA.scanned", capacity);
     int idx = 0;
     for (int i = 1; i < capacity; i++) {
         if (shelf[i].lastAccess < shelf[idx].lastAccess)
@@ -34,73 +44,444 @@ int findLRA(struct Book shelf[], int capacity) {
     return idx;
 }
 
-int main() {
-    int capacity, Q;
-    scanf("%d %d", &capacity, &Q);
-
-    struct Book shelf[capacity];
+void shelfInit(struct Shelf *s, int capacity) {
+    s->capacity = capacity;
+    s->timeCounter = 1;
+    s->mapping = NULL;
+    s->mappedBytes = 0;
+    s->disk = NULL;
+    memset(&s->stats, 0, sizeof(s->stats));
+    s->ttl = NULL;
+    s->defaultTtl = 0;
+    s->wallClock = 0;
+    s->clockOrigin = 0;
+    s->expired = 0;
+    s->books = (struct Book *) malloc((capacity > 0 ? capacity : 1) * sizeof(struct Book));
+    if (!s->books) {
+        perror("malloc failed");
+        exit(1);
+    }
 
     // Initialize shelf as empty
     for (int i = 0; i < capacity; i++) {
-        shelf[i].id = -1;
-        shelf[i].pop = 0;
-        shelf[i].lastAccess = 0;
+        s->books[i].id = -1;
+        s->books[i].pop = 0;
+        s->books[i].lastAccess = 0;
+    }
+}
+
+void shelfFree(struct Shelf *s) {
+    diskTierClose(s->disk);
+    s->disk = NULL;
+    wheelFree(s->ttl);
+    s->ttl = NULL;
+    if (s->mapping) munmap(s->mapping, s->mappedBytes);
+    else free(s->books);
+    s->books = NULL;
+    s->mapping = NULL;
+    s->capacity = 0;
+}
+
+// Current tick of the TTL clock
+static long long shelfNow(const struct Shelf *s) {
+    if (!s->wallClock) return s->timeCounter;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    double seconds = (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9 - s->clockOrigin;
+    return (long long) (seconds * 1000) + 1;
+}
+
+// Put a book that is not on the shelf into an empty slot, or in place of
+// the LRA book, which moves to the disk tier if there is one
+static void placeBook(struct Shelf *s, int x, int y, long long expires) {
+    struct Book *shelf = s->books;
+    int idx = findEmpty(shelf, s->capacity);
+
+    if (idx == -1) {
+        if (s->capacity <= 0) return;
+        // Shelf full → remove LRA
+        idx = findLRA(shelf, s->capacity);
+        if (s->disk)
+            diskTierPut(s->disk, shelf[idx].id, shelf[idx].pop, s->ttl ? wheelExpiry(s->ttl, idx) : 0);
+    }
+    shelf[idx].id = x;
+    shelf[idx].pop = y;
+    shelf[idx].lastAccess = s->timeCounter++;
+    if (s->ttl) wheelSet(s->ttl, idx, expires);
+}
+
+void shelfAdd(struct Shelf *s, int x, int y) {
+    shelfAddTtl(s, x, y, s->defaultTtl);
+}
+
+void shelfAddTtl(struct Shelf *s, int x, int y, long long ttl) {
+    struct Book *shelf = s->books;
+    long long expires = 0;
+    if (s->ttl) {
+        shelfExpireDue(s);
+        if (ttl > 0) expires = shelfNow(s) + ttl;
+    }
+    int idx = findBook(shelf, s->capacity, x);
+
+    if (idx != -1) {
+        // Book exists → update popularity and access time
+        shelf[idx].pop = y;
+        shelf[idx].lastAccess = s->timeCounter++;
+        if (s->ttl) wheelSet(s->ttl, idx, expires);
+    }
+    else {
+        // Need to add new book; an older copy in the disk tier is stale now
+        if (s->disk) diskTierDrop(s->disk, x);
+        placeBook(s, x, y, expires);
+    }
+}
+
+int shelfAccess(struct Shelf *s, int x) {
+    if (s->ttl) shelfExpireDue(s);
+    int idx = findBook(s->books, s->capacity, x);
+
+    if (idx != -1) {
+        // Update lastAccess time because it's accessed
+        s->books[idx].lastAccess = s->timeCounter++;
+        s->stats.ramHits++;
+        return s->books[idx].pop;
+    }
+    if (s->disk) {
+        PF_TIMED("question4.diskTier.access");
+        int pop;
+        long long expires;
+        if (diskTierTake(s->disk, x, &pop, &expires) == 1) {
+            if (s->ttl && expires && expires <= shelfNow(s)) {
+                // ran out while it was on disk
+                s->expired++;
+            } else {
+                // promote: it is the most recently accessed book now
+                placeBook(s, x, pop, s->ttl ? expires : 0);
+                s->stats.diskHits++;
+                return pop;
+            }
+        }
+    }
+    s->stats.misses++;
+    return -1;
+}
+
+// ----- Overflow tier -----
+int shelfAttachDisk(struct Shelf *s, const char *path) {
+    struct DiskTier *t = diskTierOpen(path);
+    if (!t) return -1;
+    diskTierClose(s->disk);
+    s->disk = t;
+    return 0;
+}
+
+void shelfReportTiers(const struct Shelf *s, FILE *out) {
+    long long total = s->stats.ramHits + s->stats.diskHits + s->stats.misses;
+    double scale = total ? 100.0 / (double) total : 0;
+    fprintf(out, "accesses %lld: ram hits %lld (%.1f%%), disk hits %lld (%.1f%%), misses %lld (%.1f%%)\n",
+            total, s->stats.ramHits, s->stats.ramHits * scale, s->stats.diskHits, s->stats.diskHits * scale,
+            s->stats.misses, s->stats.misses * scale);
+    if (s->disk)
+        fprintf(out, "disk tier: %zu books, %zu records in the file\n",
+                diskTierCount(s->disk), diskTierRecords(s->disk));
+}
+
+// ----- TTL expiry -----
+static void expireBook(void *ctx, int slot) {
+    struct Shelf *s = (struct Shelf *) ctx;
+    s->books[slot].id = -1;
+    s->books[slot].pop = 0;
+    s->books[slot].lastAccess = 0;
+    s->expired++;
+}
+
+void shelfEnableTtl(struct Shelf *s, long long defaultTtl, int wallClock) {
+    wheelFree(s->ttl);
+    s->defaultTtl = defaultTtl > 0 ? defaultTtl : 0;
+    s->wallClock = wallClock;
+    s->clockOrigin = 0;
+    if (wallClock) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        s->clockOrigin = (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
     }
+    long long now = shelfNow(s);
+    s->ttl = wheelCreate(s->capacity, now);
+    if (s->defaultTtl == 0) return;
+    for (int i = 0; i < s->capacity; i++)
+        if (s->books[i].id != -1) wheelSet(s->ttl, i, now + s->defaultTtl);
+}
+
+int shelfExpire(struct Shelf *s, int id, long long ttl) {
+    if (!s->ttl) return -1;
+    shelfExpireDue(s);
+    int idx = findBook(s->books, s->capacity, id);
+    if (idx == -1) return -1;
+    wheelSet(s->ttl, idx, ttl > 0 ? shelfNow(s) + ttl : 0);
+    return 0;
+}
+
+void shelfExpireDue(struct Shelf *s) {
+    if (!s->ttl) return;
+    size_t n = wheelAdvance(s->ttl, shelfNow(s), expireBook, s);
+    PF_COUNT("question4.ttl.expired", n);
+    (void) n;
+}
+
+// ----- Warm-start snapshots -----
+#define SNAPSHOT_MAGIC "PFSHELF1"
 
-    int timeCounter = 1;
+struct SnapshotHeader {
+    char magic[8];
+    int capacity;
+    int timeCounter;
+    int bookSize;       // sizeof(struct Book) of the writer
+    int reserved;
+};
+
+static pid_t saveChild = 0;   // background save in progress
 
-    while (Q--) {
+// The temporary file next to the snapshot and the directory holding both
+static int snapshotPaths(const char *path, char *tmp, char *dir, size_t n) {
+    if (snprintf(tmp, n, "%s.tmp", path) >= (int) n) return -1;
+    const char *slash = strrchr(path, '/');
+    if (!slash) snprintf(dir, n, ".");
+    else if (slash == path) snprintf(dir, n, "/");
+    else snprintf(dir, n, "%.*s", (int) (slash - path), path);
+    return 0;
+}
+
+static int writeAll(int fd, const void *buf, size_t n) {
+    const char *p = (const char *) buf;
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        n -= (size_t) w;
+    }
+    return 0;
+}
+
+// System calls only: this also runs in the forked child of a background save
+static int writeSnapshot(const struct Shelf *s, const char *path, const char *tmp, const char *dir) {
+    struct SnapshotHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.capacity = s->capacity;
+    h.timeCounter = s->timeCounter;
+    h.bookSize = (int) sizeof(struct Book);
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+    int failed = writeAll(fd, &h, sizeof(h)) != 0 ||
+                 writeAll(fd, s->books, (size_t) s->capacity * sizeof(struct Book)) != 0 ||
+                 fsync(fd) != 0;
+    if (close(fd) != 0) failed = 1;
+    if (!failed && rename(tmp, path) != 0) failed = 1;
+    if (failed) {
+        unlink(tmp);
+        return -1;
+    }
+    // make the rename itself durable
+    int dfd = open(dir, O_RDONLY);
+    if (dfd >= 0) {
+        fsync(dfd);
+        close(dfd);
+    }
+    return 0;
+}
+
+int shelfSave(const struct Shelf *s, const char *path) {
+    PF_TIMED("question4.shelfSave");
+    char tmp[4096], dir[4096];
+    if (snapshotPaths(path, tmp, dir, sizeof(tmp)) != 0 || writeSnapshot(s, path, tmp, dir) != 0) {
+        perror("snapshot write failed");
+        return -1;
+    }
+    return 0;
+}
+
+int shelfSaveBackground(const struct Shelf *s, const char *path) {
+    char tmp[4096], dir[4096];
+    if (saveChild) return -1;
+    if (snapshotPaths(path, tmp, dir, sizeof(tmp)) != 0) return -1;
+    fflush(NULL);   // nothing buffered gets written twice
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork failed");
+        return -1;
+    }
+    if (pid == 0) _exit(writeSnapshot(s, path, tmp, dir) == 0 ? 0 : 1);
+    saveChild = pid;
+    return 0;
+}
+
+int shelfSaveFinish(int wait) {
+    if (!saveChild) return 0;
+    int status;
+    pid_t r = waitpid(saveChild, &status, wait ? 0 : WNOHANG);
+    if (r == 0) return 0;
+    saveChild = 0;
+    if (r < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "background snapshot failed\n");
+        return -1;
+    }
+    return 1;
+}
+
+// most recently accessed first
+static int byRecency(const void *a, const void *b) {
+    int x = ((const struct Book *) a)->lastAccess, y = ((const struct Book *) b)->lastAccess;
+    return (x < y) - (x > y);
+}
+
+int shelfRestore(struct Shelf *s, int capacity, const char *path) {
+    PF_TIMED("question4.shelfRestore");
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        // no snapshot yet: a normal cold start
+        shelfInit(s, capacity);
+        return -1;
+    }
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(struct SnapshotHeader))
+        map = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    const struct SnapshotHeader *h = (const struct SnapshotHeader *) map;
+    if (map == MAP_FAILED || memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) != 0 ||
+        h->bookSize != (int) sizeof(struct Book) || h->capacity < 0 ||
+        (size_t) st.st_size != sizeof(*h) + (size_t) h->capacity * sizeof(struct Book)) {
+        fprintf(stderr, "%s: not a shelf snapshot, starting empty\n", path);
+        if (map != MAP_FAILED) munmap(map, (size_t) st.st_size);
+        shelfInit(s, capacity);
+        return -1;
+    }
+    struct Book *saved = (struct Book *) ((char *) map + sizeof(*h));
+
+    if (h->capacity == capacity) {
+        // use the mapping as the shelf; pages are read (and copied on write) as touched
+        s->books = saved;
+        s->capacity = capacity;
+        s->timeCounter = h->timeCounter;
+        s->mapping = map;
+        s->mappedBytes = (size_t) st.st_size;
+        s->disk = NULL;
+        memset(&s->stats, 0, sizeof(s->stats));
+        s->ttl = NULL;
+        s->defaultTtl = 0;
+        s->wallClock = 0;
+        s->clockOrigin = 0;
+        s->expired = 0;
+        return 0;
+    }
+
+    // a different size: keep the books that were accessed most recently
+    shelfInit(s, capacity);
+    s->timeCounter = h->timeCounter;
+    int n = 0;
+    for (int i = 0; i < h->capacity; i++)
+        if (saved[i].id != -1) saved[n++] = saved[i];
+    if (n > capacity) {
+        qsort(saved, (size_t) n, sizeof(struct Book), byRecency);
+        n = capacity;
+    }
+    memcpy(s->books, saved, (size_t) n * sizeof(struct Book));
+    munmap(map, (size_t) st.st_size);
+    return 0;
+}
+
+#ifndef PFTHEORY_NO_MAIN
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onStopSignal(int signo) {
+    (void) signo;
+    stopRequested = 1;
+}
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+int main() {
+    int capacity, Q;
+    scanf("%d %d", &capacity, &Q);
+
+    struct Shelf shelf;
+    // With PF_SHELF_SNAPSHOT set the shelf starts from the last snapshot, is
+    // saved in the background every SNAPSHOT_INTERVAL seconds and on the way
+    // out, including on SIGINT/SIGTERM
+    const char *snapshot = getenv(SNAPSHOT_ENV);
+    double lastSnapshot = 0;
+    if (snapshot) {
+        shelfRestore(&shelf, capacity, snapshot);
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = onStopSignal;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+        lastSnapshot = nowSeconds();
+    } else {
+        shelfInit(&shelf, capacity);
+    }
+    const char *overflow = getenv(OVERFLOW_ENV);
+    if (overflow && shelfAttachDisk(&shelf, overflow) != 0) overflow = NULL;
+    // PF_SHELF_TTL=<ticks> gives every ADD that TTL; EXPIRE x t sets one book's
+    const char *ttl = getenv(TTL_ENV);
+    if (ttl) {
+        const char *clock = getenv(TTL_CLOCK_ENV);
+        shelfEnableTtl(&shelf, strtoll(ttl, NULL, 10), clock && strcmp(clock, "wall") == 0);
+    }
+    pfMetricsInstall(SIGUSR1);
+
+    for (long long n = 0; Q-- > 0 && !stopRequested; n++) {
+        pfMetricsPoll();
+        if (snapshot && (n & 4095) == 0) {
+            shelfSaveFinish(0);
+            if (nowSeconds() - lastSnapshot >= SNAPSHOT_INTERVAL && shelfSaveBackground(&shelf, snapshot) == 0)
+                lastSnapshot = nowSeconds();
+        }
         char op[10];
-        scanf("%s", op);
+        if (scanf("%9s", op) != 1) break;
 
         if (op[0] == 'A' && op[1] == 'D') { 
             // ADD operation
             int x, y;
             scanf("%d %d", &x, &y);
-
-            int idx = findBook(shelf, capacity, x);
-
-            if (idx != -1) {
-                // Book exists → update popularity and access time
-                shelf[idx].pop = y;
-                shelf[idx].lastAccess = timeCounter++;
-            }
-            else {
-                // Need to add new book
-                int empty = findEmpty(shelf, capacity);
-
-                if (empty != -1) {
-                    // Empty slot found
-                    shelf[empty].id = x;
-                    shelf[empty].pop = y;
-                    shelf[empty].lastAccess = timeCounter++;
-                }
-                else {
-                    // Shelf full → remove LRA
-                    int removeIdx = findLRA(shelf, capacity);
-                    shelf[removeIdx].id = x;
-                    shelf[removeIdx].pop = y;
-                    shelf[removeIdx].lastAccess = timeCounter++;
-                }
-            }
+            shelfAdd(&shelf, x, y);
         }
 
         else if (op[0] == 'A' && op[1] == 'C') { 
             // ACCESS operation
             int x;
             scanf("%d", &x);
+            printf("%d\n", shelfAccess(&shelf, x));
+        }
 
-            int idx = findBook(shelf, capacity, x);
-
-            if (idx != -1) {
-                // Update lastAccess time because it's accessed
-                shelf[idx].lastAccess = timeCounter++;
-                printf("%d\n", shelf[idx].pop);
-            } else {
-                printf("-1\n");
-            }
+        else if (op[0] == 'E') {
+            // EXPIRE operation
+            int x;
+            long long t;
+            scanf("%d %lld", &x, &t);
+            if (!shelf.ttl) shelfEnableTtl(&shelf, 0, 0);
+            shelfExpire(&shelf, x, t);
         }
     }
 
+    if (snapshot) {
+        shelfSaveFinish(1);
+        shelfSave(&shelf, snapshot);
+    }
+    if (overflow) shelfReportTiers(&shelf, stderr);
+    if (shelf.ttl) fprintf(stderr, "ttl: %lld books expired\n", shelf.expired);
+    shelfFree(&shelf);
     return 0;
 }
+#endif
@@ -0,0 +1,103 @@
+#ifndef PF_QUESTION4_H
+#define PF_QUESTION4_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+struct Book {
+    int id;
+    int pop;
+    int lastAccess;   // Used to determine least recently accessed
+};
+
+struct DiskTier;
+struct TimerWheel;
+
+// Where ACCESS found its book
+struct TierStats {
+    long long ramHits;
+    long long diskHits;
+    long long misses;
+};
+
+// The shelf: fixed number of slots plus the logical clock
+struct Shelf {
+    struct Book *books;
+    int capacity;
+    int timeCounter;
+    void *mapping;        // snapshot the books live in, if restored in place
+    size_t mappedBytes;
+    struct DiskTier *disk;   // overflow tier for evicted books, or NULL
+    struct TierStats stats;
+    struct TimerWheel *ttl;  // expiry timers by slot, or NULL without TTLs
+    long long defaultTtl;    // TTL of a plain ADD, 0 = never expires
+    int wallClock;           // TTL ticks are milliseconds, not timeCounter steps
+    double clockOrigin;
+    long long expired;       // books dropped because their TTL ran out
+};
+
+int findBook(struct Book shelf[], int capacity, int id);
+int findEmpty(struct Book shelf[], int capacity);
+int findLRA(struct Book shelf[], int capacity);
+
+void shelfInit(struct Shelf *s, int capacity);
+void shelfFree(struct Shelf *s);
+// ADD x y: insert or update, evicting the LRA book when full
+void shelfAdd(struct Shelf *s, int id, int pop);
+// ACCESS x: popularity of the book, or -1 if it is not on the shelf (nor,
+// with a disk tier, in the tier: a book found there moves back to RAM)
+int shelfAccess(struct Shelf *s, int id);
+
+// ----- Overflow tier -----
+#define OVERFLOW_ENV "PF_SHELF_OVERFLOW"   // tier file; unset = evicted books are lost
+
+// Keep evicted books in a disk tier at 'path' (see shelfdisk.h). 0 or -1
+int shelfAttachDisk(struct Shelf *s, const char *path);
+// Print the per-tier hit rates and the size of the tier
+void shelfReportTiers(const struct Shelf *s, FILE *out);
+
+// ----- TTL expiry -----
+// A book can be given a time to live in ticks of the shelf's clock: the
+// logical timeCounter (one tick per ADD or ACCESS that touches a book) or,
+// with wallClock, milliseconds. Once it runs out the book is gone: ACCESS
+// returns -1 and its slot is empty again. ADD starts the TTL again, ACCESS
+// does not. Expiry runs on a timer wheel (timerwheel.h) advanced before
+// each operation, so nothing scans the shelf for expired books. A book
+// demoted to the disk tier keeps its deadline and is dropped if it is only
+// found there after it.
+#define TTL_ENV "PF_SHELF_TTL"               // default TTL in ticks; unset = none
+#define TTL_CLOCK_ENV "PF_SHELF_TTL_CLOCK"   // "wall" = ticks are milliseconds
+
+// Turn TTLs on; books already on the shelf get the default TTL from now
+void shelfEnableTtl(struct Shelf *s, long long defaultTtl, int wallClock);
+// ADD x y with a TTL of its own (0 = never expires); same as shelfAdd
+// without TTLs on
+void shelfAddTtl(struct Shelf *s, int id, int pop, long long ttl);
+// EXPIRE x t: a new TTL (0 = none) for a book on the shelf. -1 if it is
+// not on the shelf or TTLs are off
+int shelfExpire(struct Shelf *s, int id, long long ttl);
+// Drop the books whose TTL has run out (every operation does this first)
+void shelfExpireDue(struct Shelf *s);
+
+// ----- Warm-start snapshots -----
+// A snapshot is a small header (capacity, clock) followed by the slots
+// exactly as they are in memory. Recency lives in lastAccess, so the slots
+// and the clock are the whole state: restoring replays nothing.
+#define SNAPSHOT_ENV "PF_SHELF_SNAPSHOT"   // snapshot path; unset = no snapshots
+#define SNAPSHOT_INTERVAL 60               // seconds between periodic snapshots
+
+// Write the shelf to 'path' (through a temporary file and a rename, so a
+// crash leaves the old snapshot). 0 on success, -1 on error (message printed)
+int shelfSave(const struct Shelf *s, const char *path);
+// Same, from a forked child that sees the shelf as of the call while the
+// caller carries on. -1 if a save is still running or fork failed.
+int shelfSaveBackground(const struct Shelf *s, const char *path);
+// Reap a background save (wait=1 blocks): 1 saved, -1 failed, 0 none done
+int shelfSaveFinish(int wait);
+// Initialise the shelf from a snapshot instead of empty. A snapshot of the
+// same capacity is mapped copy-on-write and used in place; otherwise the
+// most recently accessed books that fit are copied. Returns -1 (shelf
+// empty) if there is no valid snapshot.
+int shelfRestore(struct Shelf *s, int capacity, const char *path);
+
+#endif
@@ -3,6 +3,20 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "question5.h"
+#include "linetree.h"
+#include "linesearch.h"
+#include "lazyfile.h"
+#include "instrument.h"
+#include "outbuf.h"
+
+#define SCREEN_LINES 24
+#define HOT_TEXT_MB 64      /* text kept unpacked in memory, see 'c' */
 
 /* ---- Helper: safe allocation wrappers ---- */
 
@@ -26,58 +40,102 @@ static void *xrealloc(void *ptr, size_t n) {
     return p;
 }
 
-/* ---- Dynamic buffer structure ---- */
-
-typedef struct {
-    char **lines;      /* dynamic array of pointers to C-strings */
-    size_t size;       /* number of stored lines */
-    size_t capacity;   /* allocated slots in lines[] */
-} LineBuffer;
-
-/* initialize buffer with initial capacity */
+/* initialize an empty buffer; the capacity hint is not needed by the tree */
 void initBuffer(LineBuffer *buf, size_t initialCapacity) {
-    if (initialCapacity == 0) initialCapacity = 4;
-    buf->lines = (char **) xmalloc(initialCapacity * sizeof(char *));
-    buf->size = 0;
-    buf->capacity = initialCapacity;
-    for (size_t i = 0; i < buf->capacity; ++i) buf->lines[i] = NULL;
+    (void) initialCapacity;
+    memset(buf, 0, sizeof(*buf));
+}
+
+static void dropVersions(LtNode **versions, size_t *count) {
+    for (size_t i = 0; i < *count; ++i) ltRelease(versions[i]);
+    *count = 0;
 }
 
-/* free all strings and the pointer array */
+/* free the current version and the whole undo/redo history */
 void freeAll(LineBuffer *buf) {
     if (!buf) return;
-    for (size_t i = 0; i < buf->size; ++i) {
-        free(buf->lines[i]); /* free each string */
-        buf->lines[i] = NULL;
-    }
-    free(buf->lines);
-    buf->lines = NULL;
+    ltRelease(buf->root);
+    buf->root = NULL;
     buf->size = 0;
-    buf->capacity = 0;
+    dropVersions(buf->undo, &buf->undoCount);
+    dropVersions(buf->redo, &buf->redoCount);
+    free(buf->undo);
+    free(buf->redo);
+    buf->undo = buf->redo = NULL;
+    buf->undoCap = buf->redoCap = 0;
+    ltRelease(buf->disk);
+    free(buf->diskName);
+    buf->disk = NULL;
+    buf->diskName = NULL;
+}
+
+static void pushVersion(LtNode ***stack, size_t *count, size_t *cap, LtNode *root) {
+    if (*count == UNDO_LIMIT) {
+        /* forget the oldest version */
+        ltRelease((*stack)[0]);
+        memmove(&(*stack)[0], &(*stack)[1], (*count - 1) * sizeof(LtNode *));
+        (*count)--;
+    }
+    if (*count == *cap) {
+        *cap = *cap ? *cap * 2 : 16;
+        *stack = (LtNode **) xrealloc(*stack, *cap * sizeof(LtNode *));
+    }
+    (*stack)[(*count)++] = root;
+}
+
+void commitVersion(LineBuffer *buf, LtNode *root) {
+    pushVersion(&buf->undo, &buf->undoCount, &buf->undoCap, buf->root);
+    dropVersions(buf->redo, &buf->redoCount);
+    buf->root = root;
+    buf->size = ltLines(root);
+}
+
+void resetBuffer(LineBuffer *buf, LtNode *root) {
+    freeAll(buf);
+    buf->root = root;
+    buf->size = ltLines(root);
 }
 
-/* ensure capacity >= minCapacity */
-void ensureCapacity(LineBuffer *buf, size_t minCapacity) {
-    if (buf->capacity >= minCapacity) return;
-    size_t newCap = buf->capacity ? buf->capacity : 4;
-    while (newCap < minCapacity) newCap *= 2;
-    buf->lines = (char **) xrealloc(buf->lines, newCap * sizeof(char *));
-    /* initialize new slots to NULL so deletion/free logic remains simple */
-    for (size_t i = buf->capacity; i < newCap; ++i) buf->lines[i] = NULL;
-    buf->capacity = newCap;
+int undoEdit(LineBuffer *buf) {
+    PF_TIMED("question5.undo");
+    if (buf->undoCount == 0) return -1;
+    pushVersion(&buf->redo, &buf->redoCount, &buf->redoCap, buf->root);
+    buf->root = buf->undo[--buf->undoCount];
+    buf->size = ltLines(buf->root);
+    return 0;
+}
+
+int redoEdit(LineBuffer *buf) {
+    if (buf->redoCount == 0) return -1;
+    pushVersion(&buf->undo, &buf->undoCount, &buf->undoCap, buf->root);
+    buf->root = buf->redo[--buf->redoCount];
+    buf->size = ltLines(buf->root);
+    return 0;
 }
 
-/* shrink pointer array to exactly fit the number of stored lines */
+/* drop the undo history and repack the current version into full chunks */
 void shrinkToFit(LineBuffer *buf) {
-    if (buf->capacity == buf->size) return; /* already fits */
-    if (buf->size == 0) {
-        free(buf->lines);
-        buf->lines = NULL;
-        buf->capacity = 0;
-        return;
+    dropVersions(buf->undo, &buf->undoCount);
+    dropVersions(buf->redo, &buf->redoCount);
+    LtBuilder b;
+    LtScratch scratch = {NULL, 0};
+    ltBuilderInit(&b);
+    for (size_t i = 0; i < buf->size;) {
+        size_t first;
+        const LtNode *leaf = ltLeafAt(buf->root, i, &first);
+        const size_t *off;
+        const char *text = ltLeafScan(leaf, &scratch, &off);
+        for (size_t k = 0; k < ltLeafLines(leaf); ++k)
+            ltBuilderAdd(&b, text + off[k], off[k + 1] - off[k] - 1);
+        i = first + ltLeafLines(leaf);
     }
-    buf->lines = (char **) xrealloc(buf->lines, buf->size * sizeof(char *));
-    buf->capacity = buf->size;
+    free(scratch.buf);
+    ltRelease(buf->root);
+    buf->root = ltBuilderFinish(&b);
+}
+
+const char *getLine(const LineBuffer *buf, size_t index, size_t *len) {
+    return ltLine(buf->root, index, len);
 }
 
 /* ---- Safe line input: read an entire line of arbitrary length ----
@@ -117,161 +175,457 @@ char *readLineSafe(void) {
 }
 
 /* Insert a line at index (0..size). If index == size -> append.
- * The function takes ownership of 'text' pointer (caller must not free it).
- * If text is NULL -> treat as empty string (makes a copy).
+ * The text is copied into the buffer; the caller keeps ownership of 'text'.
+ * If text is NULL -> treat as empty string.
  */
 void insertLine(LineBuffer *buf, size_t index, const char *text) {
+    PF_TIMED("question5.insertLine");
     if (!buf) return;
     if (index > buf->size) {
         fprintf(stderr, "insertLine: index %zu out of bounds (size=%zu)\n", index, buf->size);
         return;
     }
-
-    /* ensure we have room for one more pointer */
-    ensureCapacity(buf, buf->size + 1);
-
-    /* shift pointers to the right to make room (shift number = size - index) */
-    if (index < buf->size) {
-        memmove(&buf->lines[index + 1], &buf->lines[index],
-                (buf->size - index) * sizeof(char *));
-    }
-
-    /* store exact-sized copy of text */
     if (!text) text = "";
-    size_t len = strlen(text);
-    char *copy = (char *) xmalloc(len + 1);
-    memcpy(copy, text, len + 1);
-
-    buf->lines[index] = copy;
-    buf->size += 1;
+    size_t before = ltMemoryInUse();
+    commitVersion(buf, ltInsert(buf->root, index, text, strlen(text)));
+    PF_COUNT("question5.edit.newBytes", ltMemoryInUse() - before);
+    (void) before;
 }
 
-/* Delete a line at index (0..size-1). Free the string and compact the array. */
+/* Delete a line at index (0..size-1) */
 void deleteLine(LineBuffer *buf, size_t index) {
+    PF_TIMED("question5.deleteLine");
     if (!buf) return;
     if (index >= buf->size) {
         fprintf(stderr, "deleteLine: index %zu out of bounds (size=%zu)\n", index, buf->size);
         return;
     }
-
-    free(buf->lines[index]);             /* free the string memory */
-    /* shift pointers left to fill the hole */
-    if (index + 1 < buf->size) {
-        memmove(&buf->lines[index], &buf->lines[index + 1],
-                (buf->size - index - 1) * sizeof(char *));
-    }
-    buf->size -= 1;
-    buf->lines[buf->size] = NULL; /* optional, keep invariant */
+    commitVersion(buf, ltDelete(buf->root, index));
 }
 
-/* Replace line at index with new text (free old string and store exact new copy) */
+/* Replace line at index with new text */
 void replaceLine(LineBuffer *buf, size_t index, const char *text) {
     if (!buf) return;
     if (index >= buf->size) {
         fprintf(stderr, "replaceLine: index %zu out of bounds (size=%zu)\n", index, buf->size);
         return;
     }
-    free(buf->lines[index]);
-    size_t len = strlen(text);
-    char *copy = (char *) xmalloc(len + 1);
-    memcpy(copy, text, len + 1);
-    buf->lines[index] = copy;
+    commitVersion(buf, ltReplace(buf->root, index, text, strlen(text)));
 }
 
 /* Print all lines with 1-based numbers for readability */
 void printAllLines(const LineBuffer *buf) {
     if (!buf) return;
     printf("---- Buffer: %zu line(s) ----\n", buf->size);
-    for (size_t i = 0; i < buf->size; ++i) {
-        printf("%4zu: %s\n", i + 1, buf->lines[i]);
+    LtLeafList leaves;
+    LtScratch scratch = {NULL, 0};
+    ltCollectLeaves(buf->root, &leaves);
+    /* "%4zu: %.*s\n" */
+    OutBuf *o = outBegin();
+    for (size_t j = 0; j < leaves.count; ++j) {
+        const size_t *off;
+        const char *text = ltLeafScan(leaves.leaf[j], &scratch, &off);
+        for (size_t k = 0; k < ltLeafLines(leaves.leaf[j]); ++k) {
+            outPadUInt(o, leaves.firstLine[j] + k + 1, 4, OUT_RIGHT);
+            outBytes(o, ": ", 2);
+            /* %.*s stops at a NUL byte, so does this */
+            outBytes(o, text + off[k], strnlen(text + off[k], off[k + 1] - off[k] - 1));
+            outChar(o, '\n');
+        }
     }
+    outEnd(o);
+    ltFreeLeafList(&leaves);
+    free(scratch.buf);
     printf("---- end ----\n");
 }
 
-/* Save buffer to file (one line per file line). Returns 0 on success, -1 on error. */
-int saveToFile(const LineBuffer *buf, const char *filename) {
-    if (!buf || !filename) return -1;
-    FILE *f = fopen(filename, "w");
+/* ---- Saving ----
+ * A full save writes "<file>.tmp" and renames it over the file, so the
+ * file holds either the old or the new text. When the buffer knows which
+ * version is on disk, only the chunks that differ from it (ltDirtyLeaves)
+ * are written: they go to "<file>.journal", which is synced and then
+ * sealed with a trailer, and are then patched into the file in place. A
+ * sealed journal left by a crash is replayed before the file is read or
+ * saved again; an unsealed one means the file was never touched.
+ *
+ * Journal layout (host byte order): header { magic, new file size, run
+ * count }, then per run { offset, length, bytes }, then the trailer
+ * { journal length, magic }.
+ */
+
+#define JOURNAL_MAGIC 0x314c4e524a465150ULL   /* "PQFJRNL1" */
+
+static char *siblingName(const char *filename, const char *suffix) {
+    size_t n = strlen(filename), m = strlen(suffix);
+    char *name = (char *) xmalloc(n + m + 1);
+    memcpy(name, filename, n);
+    memcpy(name + n, suffix, m + 1);
+    return name;
+}
+
+static void stampOf(const struct stat *st, FileStamp *stamp) {
+    stamp->dev = (unsigned long long) st->st_dev;
+    stamp->ino = (unsigned long long) st->st_ino;
+    stamp->size = (unsigned long long) st->st_size;
+    stamp->mtimeNs = (unsigned long long) st->st_mtim.tv_sec * 1000000000ULL + (unsigned long long) st->st_mtim.tv_nsec;
+}
+
+static int takeStamp(const char *filename, FileStamp *stamp) {
+    struct stat st;
+    if (stat(filename, &st) != 0) return -1;
+    stampOf(&st, stamp);
+    return 0;
+}
+
+/* remember the current version as the contents of 'filename'. 'st' is the
+ * file the version was read from (fstat of the open file, so a file
+ * replaced meanwhile is not taken for it); NULL stats the path, after a save */
+static void markOnDisk(LineBuffer *buf, const char *filename, const struct stat *st) {
+    ltRelease(buf->disk);
+    free(buf->diskName);
+    buf->disk = NULL;
+    buf->diskName = NULL;
+    if (st) stampOf(st, &buf->diskStamp);
+    else if (takeStamp(filename, &buf->diskStamp) != 0) return;
+    buf->disk = ltRetain(buf->root);
+    buf->diskName = siblingName(filename, "");
+}
+
+/* make a rename or unlink in the file's directory durable */
+static void syncDirOf(const char *filename) {
+    const char *slash = strrchr(filename, '/');
+    char *dir = slash ? siblingName(filename, "") : siblingName(".", "");
+    if (slash) dir[slash == filename ? 1 : slash - filename] = '\0';
+    int fd = open(dir, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    free(dir);
+}
+
+static int writeAllAt(int fd, const char *data, size_t len, size_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, data, len, (off_t) offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t) n;
+        offset += (size_t) n;
+    }
+    return 0;
+}
+
+/* Write one version: chunks already hold their lines '\n'-terminated */
+static int writeVersion(const LtNode *root, const char *filename) {
+    char *tmpName = siblingName(filename, ".tmp");
+    FILE *f = fopen(tmpName, "w");
     if (!f) {
         perror("fopen for write failed");
+        free(tmpName);
         return -1;
     }
-    for (size_t i = 0; i < buf->size; ++i) {
-        if (fprintf(f, "%s\n", buf->lines[i]) < 0) {
-            perror("fprintf failed");
-            fclose(f);
-            return -1;
+    int failed = 0;
+    LtLeafList leaves;
+    LtScratch scratch = {NULL, 0};
+    ltCollectLeaves(root, &leaves);
+    for (size_t j = 0; j < leaves.count && !failed; ++j) {
+        const LtNode *leaf = leaves.leaf[j];
+        size_t len = ltBytes(leaf);
+        if (fwrite(ltLeafScan(leaf, &scratch, NULL), 1, len, f) != len) {
+            perror("fwrite failed");
+            failed = 1;
         }
     }
-    if (fclose(f) == EOF) {
+    ltFreeLeafList(&leaves);
+    free(scratch.buf);
+    struct stat old;
+    if (!failed && stat(filename, &old) == 0) fchmod(fileno(f), old.st_mode & 07777);
+    if (!failed && (fflush(f) == EOF || fsync(fileno(f)) != 0)) {
+        perror("fsync failed");
+        failed = 1;
+    }
+    if (fclose(f) == EOF && !failed) {
         perror("fclose failed");
+        failed = 1;
+    }
+    if (!failed && rename(tmpName, filename) != 0) {
+        perror("rename failed");
+        failed = 1;
+    }
+    if (failed) remove(tmpName);
+    else syncDirOf(filename);
+    PF_COUNT("question5.save.bytesWritten", failed ? 0 : ltBytes(root));
+    free(tmpName);
+    return failed ? -1 : 0;
+}
+
+/* Apply a journal left behind by an interrupted save, if there is one.
+ * Returns -1 only if a sealed journal could not be applied. */
+static int replayJournal(const char *filename) {
+    char *journalName = siblingName(filename, ".journal");
+    FILE *j = fopen(journalName, "rb");
+    if (!j) {
+        free(journalName);
+        return 0;
+    }
+    unsigned long long head[3], trailer[2], run[2];
+    struct stat st;
+    int sealed = fstat(fileno(j), &st) == 0 && st.st_size >= (off_t) sizeof(head) + (off_t) sizeof(trailer) &&
+                 fread(head, sizeof(head), 1, j) == 1 && head[0] == JOURNAL_MAGIC &&
+                 fseeko(j, -(off_t) sizeof(trailer), SEEK_END) == 0 && fread(trailer, sizeof(trailer), 1, j) == 1 &&
+                 trailer[0] == (unsigned long long) st.st_size && trailer[1] == JOURNAL_MAGIC;
+    int failed = 0;
+    if (sealed) {
+        int fd = open(filename, O_WRONLY);
+        size_t chunk = 1 << 20;
+        char *block = (char *) xmalloc(chunk);
+        failed = fd < 0 || fseeko(j, (off_t) sizeof(head), SEEK_SET) != 0;
+        for (unsigned long long r = 0; r < head[2] && !failed; ++r) {
+            if (fread(run, sizeof(run), 1, j) != 1) {
+                failed = 1;
+                break;
+            }
+            for (unsigned long long done = 0; done < run[1] && !failed;) {
+                size_t n = run[1] - done < chunk ? (size_t) (run[1] - done) : chunk;
+                failed = fread(block, 1, n, j) != n || writeAllAt(fd, block, n, (size_t) (run[0] + done)) != 0;
+                done += n;
+            }
+        }
+        if (!failed) failed = ftruncate(fd, (off_t) head[1]) != 0 || fsync(fd) != 0;
+        if (fd >= 0) close(fd);
+        free(block);
+        if (failed) fprintf(stderr, "Could not apply %s, the file is left as it was\n", journalName);
+        else fprintf(stderr, "Recovered an interrupted save of %s\n", filename);
+    }
+    fclose(j);
+    if (!failed) {
+        remove(journalName);
+        syncDirOf(filename);
+    }
+    free(journalName);
+    return failed ? -1 : 0;
+}
+
+/* Journal the dirty chunks, then write them into the file in place */
+static int patchFile(const LtNode *root, const char *filename, const LtDirtyList *dirty) {
+    char *journalName = siblingName(filename, ".journal");
+    FILE *j = fopen(journalName, "wb");
+    if (!j) {
+        perror("fopen for journal failed");
+        free(journalName);
+        return -1;
+    }
+
+    /* runs of adjacent chunks share one record */
+    unsigned long long runs = 0, length = 3 * sizeof(unsigned long long);
+    for (size_t i = 0; i < dirty->count; ++i)
+        if (i == 0 || dirty->offset[i - 1] + ltBytes(dirty->leaf[i - 1]) != dirty->offset[i]) runs++;
+    unsigned long long head[3] = {JOURNAL_MAGIC, ltBytes(root), runs};
+    LtScratch scratch = {NULL, 0};
+    int failed = fwrite(head, sizeof(head), 1, j) != 1;
+    for (size_t i = 0; i < dirty->count && !failed;) {
+        size_t k = i + 1, len = ltBytes(dirty->leaf[i]);
+        while (k < dirty->count && dirty->offset[k] == dirty->offset[i] + len) len += ltBytes(dirty->leaf[k++]);
+        unsigned long long run[2] = {dirty->offset[i], len};
+        failed = fwrite(run, sizeof(run), 1, j) != 1;
+        for (; i < k && !failed; ++i) {
+            size_t bytes = ltBytes(dirty->leaf[i]);
+            failed = fwrite(ltLeafScan(dirty->leaf[i], &scratch, NULL), 1, bytes, j) != bytes;
+        }
+        length += sizeof(run) + len;
+    }
+    /* the trailer goes out only once everything before it is on disk */
+    unsigned long long trailer[2] = {length + sizeof(trailer), JOURNAL_MAGIC};
+    if (!failed) failed = fflush(j) == EOF || fsync(fileno(j)) != 0;
+    if (!failed) failed = fwrite(trailer, sizeof(trailer), 1, j) != 1 || fflush(j) == EOF || fsync(fileno(j)) != 0;
+    if (fclose(j) == EOF) failed = 1;
+    if (failed) {
+        perror("writing the journal failed");
+        remove(journalName);
+        free(journalName);
+        free(scratch.buf);
         return -1;
     }
+    syncDirOf(filename);
+
+    /* from here on a crash is repaired by replayJournal() */
+    int fd = open(filename, O_WRONLY);
+    failed = fd < 0;
+    for (size_t i = 0; i < dirty->count && !failed; ++i)
+        failed = writeAllAt(fd, ltLeafScan(dirty->leaf[i], &scratch, NULL), ltBytes(dirty->leaf[i]), dirty->offset[i]) != 0;
+    if (!failed) failed = ftruncate(fd, (off_t) ltBytes(root)) != 0 || fsync(fd) != 0;
+    if (fd >= 0) close(fd);
+    free(scratch.buf);
+    if (failed) {
+        /* keep the journal: it still describes the wanted contents */
+        perror("patching the file failed");
+        free(journalName);
+        return -1;
+    }
+    remove(journalName);
+    PF_COUNT("question5.save.bytesWritten", dirty->bytes);
+    free(journalName);
+    return 0;
+}
+
+/* Save buffer to file (one line per file line). Returns 0 on success, -1 on error. */
+int saveToFile(LineBuffer *buf, const char *filename) {
+    PF_TIMED("question5.saveToFile");
+    if (!buf || !filename) return -1;
+    /* a background save to the same file would race for "<file>.tmp" */
+    finishBackgroundSave();
+    if (replayJournal(filename) != 0) return -1;
+
+    /* patch in place if the file is still the version we know, and at
+     * most half of it has to be rewritten. The tree counts a '\n' after
+     * every line, so a file loaded without its final newline is one byte
+     * short of it and gets the full rewrite that adds one */
+    FileStamp now;
+    int patched = -1;
+    if (buf->disk && strcmp(buf->diskName, filename) == 0 && takeStamp(filename, &now) == 0 &&
+        memcmp(&now, &buf->diskStamp, sizeof(now)) == 0 && now.size == ltBytes(buf->disk)) {
+        LtDirtyList dirty;
+        if (ltDirtyLeaves(buf->disk, buf->root, ltBytes(buf->root) / 2, &dirty) == 0) {
+            /* nothing changed: leave the file alone */
+            if (dirty.count == 0 && ltBytes(buf->root) == now.size) patched = 0;
+            else patched = patchFile(buf->root, filename, &dirty);
+            ltFreeDirtyList(&dirty);
+        }
+    }
+    if (patched != 0) {
+        if (writeVersion(buf->root, filename) != 0) return -1;
+        /* a journal kept by a failed patch is no longer needed */
+        char *journalName = siblingName(filename, ".journal");
+        remove(journalName);
+        free(journalName);
+    }
+    markOnDisk(buf, filename, NULL);
     return 0;
 }
 
-/* Load buffer from file. This frees existing buffer contents and rebuilds from file.
- * Returns 0 on success, -1 on error.
+/* Load buffer from file. This replaces the buffer contents (and its undo
+ * history) with the file. Returns 0 on success, -1 on error.
  */
 int loadFromFile(LineBuffer *buf, const char *filename) {
+    PF_TIMED("question5.loadFromFile");
     if (!buf || !filename) return -1;
+    if (replayJournal(filename) != 0) return -1;
     FILE *f = fopen(filename, "r");
     if (!f) {
         perror("fopen for read failed");
         return -1;
     }
-
-    /* free existing contents */
-    for (size_t i = 0; i < buf->size; ++i) {
-        free(buf->lines[i]);
-        buf->lines[i] = NULL;
-    }
-    buf->size = 0;
-
-    /* We'll read char-by-char building a dynamic buffer for each line */
-    int c;
-    char *line = NULL;
-    size_t lineCap = 0;
-    size_t pos = 0;
-
-    while ((c = fgetc(f)) != EOF) {
-        /* ensure buffer */
-        if (pos + 2 > lineCap) {
-            size_t newcap = lineCap ? lineCap * 2 : 128;
-            line = (char *) xrealloc(line, newcap);
-            lineCap = newcap;
+    /* the stamp of the file being read, not of whatever the path names later */
+    struct stat opened;
+    int haveStat = fstat(fileno(f), &opened) == 0;
+
+    /* read in blocks; a line split across two blocks is carried over */
+    LtBuilder b;
+    ltBuilderInit(&b);
+    size_t blockSize = 1 << 20;
+    char *block = (char *) xmalloc(blockSize);
+    char *carry = NULL;
+    size_t carryLen = 0, carryCap = 0, got;
+
+    while ((got = fread(block, 1, blockSize, f)) > 0) {
+        size_t pos = 0;
+        char *nl;
+        while ((nl = (char *) memchr(block + pos, '\n', got - pos))) {
+            size_t len = (size_t) (nl - (block + pos));
+            if (carryLen) {
+                if (carryLen + len > carryCap) {
+                    carryCap = carryLen + len;
+                    carry = (char *) xrealloc(carry, carryCap);
+                }
+                memcpy(carry + carryLen, block + pos, len);
+                ltBuilderAdd(&b, carry, carryLen + len);
+                carryLen = 0;
+            } else {
+                ltBuilderAdd(&b, block + pos, len);
+            }
+            pos += len + 1;
         }
-        if (c == '\n') {
-            line[pos] = '\0';
-            /* shrink to exact size then insert */
-            line = (char *) xrealloc(line, pos + 1);
-            insertLine(buf, buf->size, line); /* insert copies the string */
-            free(line); /* insertLine allocated its own copy */
-            line = NULL;
-            lineCap = 0;
-            pos = 0;
-        } else {
-            line[pos++] = (char) c;
+        if (pos < got) {
+            if (carryLen + (got - pos) > carryCap) {
+                carryCap = (carryLen + (got - pos)) * 2;
+                carry = (char *) xrealloc(carry, carryCap);
+            }
+            memcpy(carry + carryLen, block + pos, got - pos);
+            carryLen += got - pos;
         }
     }
-
+    int readFailed = ferror(f);
     /* handle last line if file didn't end with newline */
-    if (line && pos > 0) {
-        line[pos] = '\0';
-        line = (char *) xrealloc(line, pos + 1);
-        insertLine(buf, buf->size, line);
-        free(line);
-    } else {
-        free(line);
+    if (carryLen > 0) ltBuilderAdd(&b, carry, carryLen);
+    free(carry);
+    free(block);
+    LtNode *root = ltBuilderFinish(&b);
+
+    if (readFailed) perror("fread failed");
+    if (fclose(f) == EOF || readFailed) {
+        if (!readFailed) perror("fclose failed");
+        ltRelease(root);
+        return -1;
     }
 
-    if (fclose(f) == EOF) {
-        perror("fclose failed");
+    /* a loaded file starts a new history */
+    resetBuffer(buf, root);
+    if (haveStat) markOnDisk(buf, filename, &opened);
+    return 0;
+}
+
+/* ---- Background save of a snapshot ---- */
+
+static struct {
+    pthread_t thread;
+    int running;
+    int done;             /* set by the saver thread */
+    int ok;
+    LtNode *snapshot;
+    char filename[512];
+} bgSave;
+
+static void *backgroundSaver(void *arg) {
+    (void) arg;
+    bgSave.ok = writeVersion(bgSave.snapshot, bgSave.filename) == 0;
+    __atomic_store_n(&bgSave.done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+int saveInBackground(const LineBuffer *buf, const char *filename) {
+    if (bgSave.running) return -1;
+    /* the snapshot is immutable, so the saver needs no locking */
+    bgSave.snapshot = ltRetain(buf->root);
+    snprintf(bgSave.filename, sizeof(bgSave.filename), "%s", filename);
+    bgSave.done = 0;
+    if (pthread_create(&bgSave.thread, NULL, backgroundSaver, NULL) != 0) {
+        perror("pthread_create failed");
+        ltRelease(bgSave.snapshot);
         return -1;
     }
+    bgSave.running = 1;
     return 0;
 }
 
+int pollBackgroundSave(int *ok, const char **filename) {
+    if (!bgSave.running || !__atomic_load_n(&bgSave.done, __ATOMIC_ACQUIRE)) return 0;
+    finishBackgroundSave();
+    if (ok) *ok = bgSave.ok;
+    if (filename) *filename = bgSave.filename;
+    return 1;
+}
+
+void finishBackgroundSave(void) {
+    if (!bgSave.running) return;
+    pthread_join(bgSave.thread, NULL);
+    ltRelease(bgSave.snapshot);
+    bgSave.snapshot = NULL;
+    bgSave.running = 0;
+}
+
 /* ---- Simple interactive demo menu ----
  * The demo reads commands from stdin. The commands:
  *  i <index>   -> insert a new line at position index (1-based). After this command, user types the new line and presses Enter.
@@ -279,9 +633,20 @@ int loadFromFile(LineBuffer *buf, const char *filename) {
  *  d <index>   -> delete line at index (1-based)
  *  r <index>   -> replace line at index; then type new line
  *  p           -> print all lines
- *  s <file>    -> save to file
+ *  s <file>    -> save to file (only the changed part if it is the loaded file)
  *  l <file>    -> load from file (replaces buffer)
- *  f           -> shrinkToFit
+ *  f           -> shrinkToFit (drops the undo history)
+ *  u / U       -> undo / redo the last edit
+ *  w <file>    -> save to file on a background thread
+ *  o <file>    -> open a file lazily: the first lines show at once while the
+ *                 rest is indexed in the background; the first command that
+ *                 needs the whole buffer loads it
+ *  v <line> [count] -> view lines from 'line' (1-based)
+ *  c [MB]      -> show how much text is packed in memory; with MB, set how
+ *                 much unpacked text to keep (0: no compression)
+ *  F           -> find first occurrence; then type the text to look for
+ *  G           -> find all occurrences; then type the text
+ *  R           -> replace all occurrences; then type the text and its replacement
  *  q           -> quit
  *
  * Example:
@@ -300,9 +665,19 @@ void printHelp(void) {
     puts("  d <index>   - delete line at index (1-based)");
     puts("  r <index>   - replace line at index (1-based), then type new text and press Enter");
     puts("  p           - print all lines");
-    puts("  s <file>    - save to file");
+    puts("  s <file>    - save to file (rewrites only what changed since the last load/save)");
     puts("  l <file>    - load from file (rebuilds buffer)");
-    puts("  f           - shrinkToFit (reduce memory to fit exactly number of lines)");
+    puts("  f           - shrinkToFit (drop undo history, repack line chunks)");
+    puts("  u           - undo last edit");
+    puts("  U           - redo last undone edit");
+    puts("  w <file>    - save to file in the background, keep editing");
+    puts("  o <file>    - open file lazily (first lines at once, loaded on first edit)");
+    puts("  v <line> [n]- view n lines from line (1-based, default one screen)");
+    puts("  c [MB]      - compression stats; with MB, unpacked text to keep (0: off)");
+    puts("  F           - find first occurrence, then type the text to look for");
+    puts("  G           - find all occurrences, then type the text to look for");
+    puts("  R           - replace all occurrences, then type the text and its replacement");
+    puts("  m [json]    - dump runtime metrics");
     puts("  h           - help");
     puts("  q           - quit");
 }
@@ -321,18 +696,46 @@ int readToken(char *buf, size_t buflen) {
         if (p + 1 < buflen) buf[p++] = (char) c;
         c = getchar();
     }
+    /* leave the delimiter for the caller's end-of-line skip */
+    if (c != EOF) ungetc(c, stdin);
     buf[p] = '\0';
     return 0;
 }
 
+#ifndef PFTHEORY_NO_MAIN
+/* print 'count' lines from 'from' (0-based) of the lazy file or the buffer */
+static void viewLines(LazyFile *lazy, const LineBuffer *buf, size_t from, size_t count) {
+    for (size_t i = from; i < from + count; ++i) {
+        size_t len;
+        const char *text;
+        if (lazy) text = lazyLine(lazy, i, &len);
+        else text = i < buf->size ? getLine(buf, i, &len) : NULL;
+        if (!text) break;
+        printf("%4zu: %.*s\n", i + 1, (int) len, text);
+    }
+}
+
 int main(void) {
     LineBuffer buf;
     initBuffer(&buf, 4);
+    LazyFile *lazy = NULL;        /* file opened with 'o', not loaded yet */
+    char lazyName[512] = "";
 
     printf("Minimal Line-Based Editor (demo). Type 'h' for help.\n");
     printHelp();
+    pfMetricsInstall(SIGUSR1);
+    ltSetHotLimit((size_t) HOT_TEXT_MB << 20);
 
     for (;;) {
+        int saved;
+        const char *savedName;
+        pfMetricsPoll();
+        if (pollBackgroundSave(&saved, &savedName)) {
+            if (saved) printf("Background save to %s finished.\n", savedName);
+            else fprintf(stderr, "Background save to %s failed\n", savedName);
+        }
+        /* pack text not used lately; the saver thread may still be reading */
+        if (!bgSave.running) ltTrim();
         printf("\n> ");
         fflush(stdout);
 
@@ -342,7 +745,46 @@ int main(void) {
         while (c == ' ' || c == '\t' || c == '\r') c = getchar();
         if (c == '\n') continue;
 
-        if (c == 'i') { /* insert */
+        /* commands that work on the whole buffer load a lazily opened file first */
+        if (lazy && c == 'l') {
+            lazyClose(lazy);
+            lazy = NULL;
+        } else if (lazy && strchr("iadrpswfuUFGR", c)) {
+            resetBuffer(&buf, lazyBuildTree(lazy));
+            markOnDisk(&buf, lazyName, lazyFileStat(lazy));
+            lazyClose(lazy);
+            lazy = NULL;
+            printf("Loaded %zu line(s) from %s.\n", buf.size, lazyName);
+        }
+
+        if (c == 'o') { /* lazy open */
+            char filename[512];
+            if (readToken(filename, sizeof(filename)) == -1) break;
+            while ((c = getchar()) != EOF && c != '\n');
+            replayJournal(filename);
+            LazyFile *opened = lazyOpen(filename);
+            if (!opened) {
+                fprintf(stderr, "Failed to open %s\n", filename);
+                continue;
+            }
+            lazyClose(lazy);
+            lazy = opened;
+            snprintf(lazyName, sizeof(lazyName), "%s", filename);
+            printf("Opened %s (%zu bytes), indexing in the background.\n", filename, lazyFileSize(lazy));
+            viewLines(lazy, &buf, 0, SCREEN_LINES);
+        }
+        else if (c == 'v') { /* view */
+            char *rest = readLineSafe();
+            int from = 1, count = SCREEN_LINES;
+            if (!rest || sscanf(rest, "%d %d", &from, &count) < 1 || from < 1 || count < 1) {
+                fprintf(stderr, "usage: v <line> [count]\n");
+                free(rest);
+                continue;
+            }
+            free(rest);
+            viewLines(lazy, &buf, (size_t) from - 1, (size_t) count);
+        }
+        else if (c == 'i') { /* insert */
             int index;
             if (scanf("%d", &index) != 1) {
                 fprintf(stderr, "invalid index\n");
@@ -433,10 +875,111 @@ int main(void) {
                 fprintf(stderr, "Failed to load from %s\n", filename);
             }
         }
+        else if (c == 'w') { /* background save */
+            char filename[512];
+            if (readToken(filename, sizeof(filename)) == -1) break;
+            while ((c = getchar()) != EOF && c != '\n');
+            if (saveInBackground(&buf, filename) == 0) {
+                printf("Saving to %s in the background.\n", filename);
+            } else {
+                fprintf(stderr, "A background save is still running\n");
+            }
+        }
+        else if (c == 'u' || c == 'U') { /* undo / redo */
+            int redo = (c == 'U');
+            while ((c = getchar()) != EOF && c != '\n');
+            if (redo) {
+                if (redoEdit(&buf) == 0) printf("Redone. %zu line(s).\n", buf.size);
+                else printf("Nothing to redo.\n");
+            } else {
+                if (undoEdit(&buf) == 0) printf("Undone. %zu line(s).\n", buf.size);
+                else printf("Nothing to undo.\n");
+            }
+        }
         else if (c == 'f') { /* shrinkToFit */
             while ((c = getchar()) != EOF && c != '\n');
             shrinkToFit(&buf);
-            printf("Shrink-to-fit done. capacity == %zu\n", buf.capacity);
+            printf("Shrink-to-fit done. %zu line(s), undo history cleared.\n", buf.size);
+        }
+        else if (c == 'F' || c == 'G') { /* find / find all */
+            int all = (c == 'G');
+            while ((c = getchar()) != EOF && c != '\n');
+            printf("Enter text to find:\n");
+            char *needle = readLineSafe();
+            if (!needle) { printf("No text entered (EOF)\n"); continue; }
+            if (!*needle) {
+                fprintf(stderr, "find: empty search text\n");
+                free(needle);
+                continue;
+            }
+            if (all) {
+                MatchList matches;
+                findAll(&buf, needle, &matches);
+                for (size_t k = 0; k < matches.count; ++k) {
+                    size_t len;
+                    const char *text = getLine(&buf, matches.items[k].line, &len);
+                    printf("%4zu:%zu: %.*s\n", matches.items[k].line + 1, matches.items[k].col + 1,
+                           (int) len, text);
+                }
+                printf("%zu match(es).\n", matches.count);
+                freeMatches(&matches);
+            } else {
+                LineMatch at;
+                if (findFirst(&buf, needle, 0, &at)) {
+                    size_t len;
+                    const char *text = getLine(&buf, at.line, &len);
+                    printf("Found at line %zu, column %zu: %.*s\n", at.line + 1, at.col + 1, (int) len, text);
+                } else
+                    printf("Not found.\n");
+            }
+            free(needle);
+        }
+        else if (c == 'R') { /* replace all */
+            while ((c = getchar()) != EOF && c != '\n');
+            printf("Enter text to find:\n");
+            char *needle = readLineSafe();
+            if (!needle) { printf("No text entered (EOF)\n"); continue; }
+            printf("Enter replacement text:\n");
+            char *repl = readLineSafe();
+            if (!repl) { printf("No text entered (EOF)\n"); free(needle); continue; }
+            if (!*needle) {
+                fprintf(stderr, "replace: empty search text\n");
+            } else {
+                size_t changed;
+                size_t n = replaceAll(&buf, needle, repl, &changed);
+                printf("Replaced %zu occurrence(s) in %zu line(s).\n", n, changed);
+            }
+            free(needle);
+            free(repl);
+        }
+        else if (c == 'c') { /* compression */
+            char *rest = readLineSafe();
+            int mb;
+            if (rest && sscanf(rest, "%d", &mb) == 1) {
+                if (mb < 0) mb = 0;
+                ltSetHotLimit((size_t) mb << 20);
+                if (!bgSave.running) ltTrim();
+                if (mb) printf("Keeping at most %d MB of text unpacked.\n", mb);
+                else printf("Compression off (packed chunks unpack as they are used).\n");
+            }
+            free(rest);
+            LtPackStats st;
+            ltPackStats(&st);
+            printf("Unpacked: %zu chunk(s), %.1f MB of text.\n", st.hotLeaves, st.hotText / 1048576.0);
+            printf("Packed:   %zu chunk(s), %.1f MB of text in %.1f MB (%.2fx); all packed copies %.1f MB.\n",
+                   st.coldLeaves, st.coldText / 1048576.0, st.coldPacked / 1048576.0,
+                   st.coldPacked ? (double) st.coldText / (double) st.coldPacked : 0.0, st.packedBytes / 1048576.0);
+        }
+        else if (c == 'm') { /* metrics */
+            char format[16] = "";
+            int d = getchar();
+            while (d == ' ' || d == '\t') d = getchar();
+            if (d != '\n' && d != EOF) {
+                ungetc(d, stdin);
+                if (readToken(format, sizeof(format)) == -1) break;
+            }
+            if (d != '\n') while ((c = getchar()) != EOF && c != '\n');
+            pfMetricsDump(stdout, strcmp(format, "json") == 0);
         }
         else if (c == 'h') {
             while ((c = getchar()) != EOF && c != '\n');
@@ -453,7 +996,10 @@ int main(void) {
         }
     }
 
+    finishBackgroundSave();
+    lazyClose(lazy);
     freeAll(&buf);
     printf("Exiting editor. Memory freed.\n");
     return 0;
 }
+#endif
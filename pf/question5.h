@@ -0,0 +1,71 @@
+#ifndef PF_QUESTION5_H
+#define PF_QUESTION5_H
+
+#include <stddef.h>
+
+/* ---- Buffer structure ----
+ * The text lives in a persistent tree of line chunks (linetree.h). Every
+ * edit produces a new version that shares all untouched chunks with the
+ * previous one; older versions are kept for undo/redo.
+ */
+
+typedef struct LtNode LtNode;
+
+/* identifies one state of a file on disk */
+typedef struct {
+    unsigned long long dev, ino, size, mtimeNs;
+} FileStamp;
+
+typedef struct {
+    LtNode *root;      /* current version (NULL when empty) */
+    size_t size;       /* number of stored lines */
+    LtNode **undo;     /* previous versions, most recent last */
+    size_t undoCount, undoCap;
+    LtNode **redo;     /* versions undone, most recent last */
+    size_t redoCount, redoCap;
+    LtNode *disk;      /* version last loaded from or saved to diskName */
+    char *diskName;
+    FileStamp diskStamp;
+} LineBuffer;
+
+#define UNDO_LIMIT 1000   /* versions kept for undo */
+
+void initBuffer(LineBuffer *buf, size_t initialCapacity);
+void freeAll(LineBuffer *buf);
+void shrinkToFit(LineBuffer *buf);
+
+/* Line 'index' (0-based) and its length; the text is not NUL-terminated */
+const char *getLine(const LineBuffer *buf, size_t index, size_t *len);
+
+/* Make 'root' the current version (takes over the reference); the old one
+ * goes on the undo stack and the redo stack is cleared. */
+void commitVersion(LineBuffer *buf, LtNode *root);
+/* Replace the contents with 'root' (takes over the reference) and start a
+ * new history, as loading a file does */
+void resetBuffer(LineBuffer *buf, LtNode *root);
+/* Return 0 on success, -1 if there is nothing to undo/redo */
+int undoEdit(LineBuffer *buf);
+int redoEdit(LineBuffer *buf);
+
+char *readLineSafe(void);
+
+void insertLine(LineBuffer *buf, size_t index, const char *text);
+void deleteLine(LineBuffer *buf, size_t index);
+void replaceLine(LineBuffer *buf, size_t index, const char *text);
+void printAllLines(const LineBuffer *buf);
+
+/* Return 0 on success, -1 on error. Saving to the file the buffer was
+ * loaded from (or last saved to) writes only the chunks that changed since;
+ * either way the file is replaced atomically. */
+int saveToFile(LineBuffer *buf, const char *filename);
+int loadFromFile(LineBuffer *buf, const char *filename);
+
+/* Write the current version to 'filename' on a background thread while
+ * editing continues. Returns 0 if the save was started, -1 if another one
+ * is still running. pollBackgroundSave() returns 1 once when a save has
+ * finished (*ok = 1 on success), else 0; finishBackgroundSave() waits. */
+int saveInBackground(const LineBuffer *buf, const char *filename);
+int pollBackgroundSave(int *ok, const char **filename);
+void finishBackgroundSave(void);
+
+#endif
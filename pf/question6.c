@@ -1,29 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-
-#define DATAFILE "members.dat"
-#define NAME_LEN 100
-#define BATCH_LEN 32
-#define TYPE_LEN 16
-#define DATE_LEN 11
-#define INTEREST_LEN 16
-
-typedef struct {
-    int id;
-    char name[NAME_LEN];
-    char batch[BATCH_LEN];           // CS, SE, Cyber Security, AI
-    char membershipType[TYPE_LEN];   // IEEE / ACM
-    char registrationDate[DATE_LEN];
-    char dob[DATE_LEN];
-    char interest[INTEREST_LEN];     // IEEE / ACM / Both
-} Student;
-
-typedef struct {
-    Student *arr;
-    size_t size;
-    size_t capacity;
-} Database;
+#include <signal.h>
+#include <pthread.h>
+#include "question6.h"
+#include "memberreport.h"
+#include "instrument.h"
+#include "outbuf.h"
 
 // ----- Memory helpers -----
 void *xmalloc(size_t n) {
@@ -45,24 +28,230 @@ void *xrealloc(void *ptr, size_t n) {
 }
 
 void initDatabase(Database *db) {
-    db->arr = NULL;
-    db->size = 0;
-    db->capacity = 0;
+    memset(db, 0, sizeof(*db));
 }
 
 void freeDatabase(Database *db) {
-    free(db->arr);
-    db->arr = NULL;
-    db->size = 0;
-    db->capacity = 0;
+    finishCompaction(db, 1);
+    studentStoreFree(&db->members);
+    free(db->dead);
+    free(db->freeSlots);
+    int background = db->compactInBackground;
+    initDatabase(db);
+    db->compactInBackground = background;
 }
 
 void ensureCapacity(Database *db, size_t minCapacity) {
-    if (db->capacity >= minCapacity) return;
-    size_t newCap = db->capacity ? db->capacity * 2 : 8;
-    while (newCap < minCapacity) newCap *= 2;
-    db->arr = (Student *) xrealloc(db->arr, newCap * sizeof(Student));
-    db->capacity = newCap;
+    size_t oldCap = db->members.capacity;
+    if (oldCap >= minCapacity) return;
+    studentStoreReserve(&db->members, minCapacity);
+    size_t oldWords = (oldCap + 63) / 64, words = (db->members.capacity + 63) / 64;
+    db->dead = (uint64_t *) xrealloc(db->dead, words * sizeof(uint64_t));
+    memset(db->dead + oldWords, 0, (words - oldWords) * sizeof(uint64_t));
+}
+
+// ----- Tombstones -----
+int isTombstone(const Database *db, size_t index) {
+    return (int) ((db->dead[index >> 6] >> (index & 63)) & 1);
+}
+
+static void setTombstone(Database *db, size_t index) {
+    studentStoreForget(&db->members, index);
+    memset(&db->members.items[index], 0, sizeof(Student));
+    db->members.items[index].id = TOMBSTONE_ID;   // never matches a lookup
+    db->dead[index >> 6] |= 1ULL << (index & 63);
+    db->deadCount++;
+    if (db->freeCount == db->freeCap) {
+        db->freeCap = db->freeCap ? db->freeCap * 2 : 64;
+        db->freeSlots = (size_t *) xrealloc(db->freeSlots, db->freeCap * sizeof(size_t));
+    }
+    db->freeSlots[db->freeCount++] = index;
+}
+
+// First slot >= from whose tombstone bit equals 'dead', or db->members.size
+static size_t nextSlot(const Database *db, size_t from, int dead) {
+    while (from < db->members.size) {
+        uint64_t word = db->dead[from >> 6];
+        if (!dead) word = ~word;
+        word &= ~0ULL << (from & 63);
+        if (word) {
+            size_t i = (from & ~(size_t)63) + (size_t)__builtin_ctzll(word);
+            return i < db->members.size ? i : db->members.size;
+        }
+        from = (from | 63) + 1;
+    }
+    return db->members.size;
+}
+
+// ----- Background compaction -----
+// The copier holds 'lock' while it copies a chunk of slots; while a pass runs
+// every edit takes it too (so no record is copied half-written and the array
+// is not reallocated under the copier) and records the slot it touched.
+#define COMPACT_CHUNK 4096
+
+struct Compaction {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    Database *db;
+    size_t slots;           // slots present when the pass started
+    Student *out;           // live records in slot order
+    size_t outCount, outCap;
+    size_t *newIndex;       // slot -> index in out, (size_t)-1 if it was dead
+    size_t *edited;         // slots changed since the pass started
+    size_t editedCount, editedCap;
+    int done;
+};
+
+static void beginEdit(Database *db) {
+    if (db->compaction) pthread_mutex_lock(&db->compaction->lock);
+}
+
+static void endEdit(Database *db, size_t slot) {
+    Compaction *c = db->compaction;
+    if (!c) return;
+    if (c->editedCount == c->editedCap) {
+        c->editedCap = c->editedCap ? c->editedCap * 2 : 64;
+        c->edited = (size_t *) xrealloc(c->edited, c->editedCap * sizeof(size_t));
+    }
+    c->edited[c->editedCount++] = slot;
+    pthread_mutex_unlock(&c->lock);
+}
+
+static void *compactMain(void *arg) {
+    Compaction *c = (Compaction *) arg;
+    const Database *db = c->db;
+    for (size_t start = 0; start < c->slots; start += COMPACT_CHUNK) {
+        size_t end = c->slots - start > COMPACT_CHUNK ? start + COMPACT_CHUNK : c->slots;
+        pthread_mutex_lock(&c->lock);
+        for (size_t i = start; i < end; ++i) {
+            if (isTombstone(db, i)) { c->newIndex[i] = (size_t)-1; continue; }
+            if (c->outCount == c->outCap) {
+                c->outCap *= 2;
+                c->out = (Student *) xrealloc(c->out, c->outCap * sizeof(Student));
+            }
+            c->out[c->outCount] = db->members.items[i];
+            c->newIndex[i] = c->outCount++;
+        }
+        pthread_mutex_unlock(&c->lock);
+    }
+    pthread_mutex_lock(&c->lock);
+    c->done = 1;
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+static int compareSlots(const void *a, const void *b) {
+    size_t x = *(const size_t *)a, y = *(const size_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+int needsCompaction(const Database *db) {
+    return db->deadCount >= COMPACT_MIN_DEAD && db->deadCount * COMPACT_RATIO >= db->members.size;
+}
+
+int startCompaction(Database *db) {
+    if (db->compaction) return -1;
+    Compaction *c = (Compaction *) xmalloc(sizeof(Compaction));
+    memset(c, 0, sizeof(*c));
+    c->db = db;
+    c->slots = db->members.size;
+    c->outCap = db->members.size - db->deadCount + 64;   // adds may revive slots meanwhile
+    c->out = (Student *) xmalloc(c->outCap * sizeof(Student));
+    c->newIndex = (size_t *) xmalloc((c->slots ? c->slots : 1) * sizeof(size_t));
+    pthread_mutex_init(&c->lock, NULL);
+    db->compaction = c;
+    if (pthread_create(&c->thread, NULL, compactMain, c) != 0) {
+        // no thread: compact inline instead
+        db->compaction = NULL;
+        pthread_mutex_destroy(&c->lock);
+        free(c->out);
+        free(c->newIndex);
+        free(c);
+        compactDatabase(db);
+    }
+    return 0;
+}
+
+int finishCompaction(Database *db, int wait) {
+    Compaction *c = db->compaction;
+    if (!c) return 0;
+    if (!wait) {
+        pthread_mutex_lock(&c->lock);
+        int done = c->done;
+        pthread_mutex_unlock(&c->lock);
+        if (!done) return 0;
+    }
+    pthread_join(c->thread, NULL);
+    db->compaction = NULL;
+    PF_TIMED("question6.finishCompaction");
+
+    // Bring each slot edited during the pass over as it is now: overwrite or
+    // append a live one, tombstone the copy of one deleted after it was copied.
+    qsort(c->edited, c->editedCount, sizeof(size_t), compareSlots);
+    size_t *killed = (size_t *) xmalloc((c->editedCount ? c->editedCount : 1) * sizeof(size_t));
+    size_t killCount = 0;
+    for (size_t k = 0; k < c->editedCount; ++k) {
+        size_t slot = c->edited[k];
+        if (k > 0 && slot == c->edited[k - 1]) continue;
+        size_t to = slot < c->slots ? c->newIndex[slot] : (size_t)-1;
+        if (!isTombstone(db, slot)) {
+            if (to == (size_t)-1) {
+                if (c->outCount == c->outCap) {
+                    c->outCap *= 2;
+                    c->out = (Student *) xrealloc(c->out, c->outCap * sizeof(Student));
+                }
+                to = c->outCount++;
+            }
+            c->out[to] = db->members.items[slot];
+        } else if (to != (size_t)-1) {
+            memset(&c->out[to], 0, sizeof(Student));
+            c->out[to].id = TOMBSTONE_ID;
+            killed[killCount++] = to;
+        }
+    }
+
+    // Swap the compacted table in
+    free(db->members.items);
+    free(db->dead);
+    free(db->freeSlots);
+    db->members.items = c->out;
+    db->members.size = c->outCount;
+    db->members.capacity = c->outCap;
+    studentStoreReindex(&db->members);
+    db->dead = (uint64_t *) xmalloc((db->members.capacity + 63) / 64 * sizeof(uint64_t));
+    memset(db->dead, 0, (db->members.capacity + 63) / 64 * sizeof(uint64_t));
+    for (size_t k = 0; k < killCount; ++k) db->dead[killed[k] >> 6] |= 1ULL << (killed[k] & 63);
+    db->deadCount = killCount;
+    db->freeSlots = killed;
+    db->freeCount = killCount;
+    db->freeCap = c->editedCount ? c->editedCount : 1;
+    db->layoutVersion++;
+
+    pthread_mutex_destroy(&c->lock);
+    free(c->newIndex);
+    free(c->edited);
+    free(c);
+    return 1;
+}
+
+void compactDatabase(Database *db) {
+    finishCompaction(db, 1);
+    if (db->deadCount == 0) return;
+    PF_TIMED("question6.compactDatabase");
+    // slide each run of live records down over the tombstones before it
+    size_t to = 0, from = nextSlot(db, 0, 0);
+    while (from < db->members.size) {
+        size_t end = nextSlot(db, from, 1);
+        if (to != from) memmove(&db->members.items[to], &db->members.items[from], (end - from) * sizeof(Student));
+        to += end - from;
+        from = nextSlot(db, end, 0);
+    }
+    db->members.size = to;
+    studentStoreReindex(&db->members);
+    memset(db->dead, 0, (db->members.capacity + 63) / 64 * sizeof(uint64_t));
+    db->deadCount = 0;
+    db->freeCount = 0;
+    db->layoutVersion++;
 }
 
 // ----- File operations -----
@@ -74,22 +263,37 @@ int loadDatabase(Database *db, const char *filename) {
     rewind(f);
     size_t recCount = (size_t)(fileSize / sizeof(Student));
     if (recCount == 0) { fclose(f); return 0; }
-    ensureCapacity(db, recCount);
-    size_t read = fread(db->arr, sizeof(Student), recCount, f);
-    db->size = read;
+    ensureCapacity(db, db->members.size + recCount);
+    studentStoreLoad(&db->members, f);
     fclose(f);
+    // tombstones saved by deletes become free slots again
+    for (size_t i = 0; i < db->members.size; ++i)
+        if (db->members.items[i].id == TOMBSTONE_ID) setTombstone(db, i);
     return 0;
 }
 
 int saveDatabase(const Database *db, const char *filename) {
+    PF_TIMED("question6.saveDatabase");
     FILE *f = fopen(filename, "wb");
     if (!f) { perror("Cannot open file for write"); return -1; }
-    if (db->size > 0) {
-        if (fwrite(db->arr, sizeof(Student), db->size, f) != db->size) {
-            perror("Error writing to file");
-            fclose(f);
-            return -1;
-        }
+    if (studentStoreSave(&db->members, f) != 0) {
+        perror("Error writing to file");
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    return 0;
+}
+
+int saveRecord(const Database *db, const char *filename, size_t index) {
+    PF_TIMED("question6.saveRecord");
+    FILE *f = fopen(filename, "r+b");
+    if (!f) return saveDatabase(db, filename); // no file yet
+    if (fseek(f, (long)(index * sizeof(Student)), SEEK_SET) != 0 ||
+        fwrite(&db->members.items[index], sizeof(Student), 1, f) != 1) {
+        perror("Error writing to file");
+        fclose(f);
+        return -1;
     }
     fclose(f);
     return 0;
@@ -97,45 +301,69 @@ int saveDatabase(const Database *db, const char *filename) {
 
 // ----- In-memory operations -----
 size_t findStudentIndex(const Database *db, int id) {
-    for (size_t i = 0; i < db->size; ++i)
-        if (db->arr[i].id == id) return (size_t)i;
-    return -1;
+    PF_TIMED("question6.findStudentIndex");
+    return studentStoreFind(&db->members, id);
 }
 
 int addStudent(Database *db, const Student *s) {
-    if (findStudentIndex(db, s->id) != -1) return -1; // duplicate
-    ensureCapacity(db, db->size + 1);
-    db->arr[db->size++] = *s;
+    if (s->id == TOMBSTONE_ID) return -1;
+    if (findStudentIndex(db, s->id) != (size_t)-1) return -1; // duplicate
+    beginEdit(db);
+    size_t slot;
+    if (db->freeCount > 0) {
+        // reuse the most recently freed slot
+        slot = db->freeSlots[--db->freeCount];
+        db->dead[slot >> 6] &= ~(1ULL << (slot & 63));
+        db->deadCount--;
+    } else {
+        ensureCapacity(db, db->members.size + 1);
+        slot = db->members.size++;
+    }
+    db->members.items[slot] = *s;
+    studentStoreRemember(&db->members, slot);
+    endEdit(db, slot);
     return 0;
 }
 
 int deleteStudent(Database *db, int id) {
     size_t idx = findStudentIndex(db, id);
-    if (idx < 0) return -1;
-    size_t i = (size_t)idx;
-    if (i + 1 < db->size)
-        memmove(&db->arr[i], &db->arr[i + 1], (db->size - i - 1) * sizeof(Student));
-    db->size--;
+    if (idx == (size_t)-1) return -1;
+    beginEdit(db);
+    setTombstone(db, idx);
+    endEdit(db, idx);
+    if (needsCompaction(db) && !db->compaction) {
+        if (db->compactInBackground) startCompaction(db);
+        else compactDatabase(db);
+    }
     return 0;
 }
 
 int updateStudent(Database *db, int id, const char *newBatch, const char *newMembership) {
     size_t idx = findStudentIndex(db, id);
-    if (idx < 0) return -1;
-    Student *s = &db->arr[idx];
+    if (idx == (size_t)-1) return -1;
+    beginEdit(db);
+    Student *s = &db->members.items[idx];
     if (newBatch && newBatch[0] != '\0') strncpy(s->batch, newBatch, BATCH_LEN-1);
     if (newMembership && newMembership[0] != '\0') strncpy(s->membershipType, newMembership, TYPE_LEN-1);
     s->batch[BATCH_LEN-1]='\0';
     s->membershipType[TYPE_LEN-1]='\0';
+    endEdit(db, idx);
     return 0;
 }
 
+int hasMembership(const Student *s, const char *membership) {
+    return strcmp(s->membershipType,membership)==0 || strcmp(s->interest,membership)==0 || strcmp(s->interest,"Both")==0;
+}
+
 // ----- Input helpers -----
 void readString(const char *prompt, char *buf, size_t size) {
     printf("%s", prompt);
     if (fgets(buf, (int)size, stdin)) {
         size_t len = strlen(buf);
         if (len && buf[len-1]=='\n') buf[len-1]='\0';
+        else { int c; while ((c=getchar())!=EOF && c!='\n'); } // drop rest of an over-long line
+    } else {
+        buf[0]='\0';
     }
 }
 
@@ -149,23 +377,42 @@ int readInt(const char *prompt) {
 void displayAll(const Database *db) {
     printf("\nID\tName\tBatch\tMembership\tRegDate\tDOB\tInterest\n");
     printf("---------------------------------------------------------------\n");
-    for (size_t i=0;i<db->size;i++) {
-        Student *s=&db->arr[i];
-        printf("%d\t%s\t%s\t%s\t%s\t%s\t%s\n",
-               s->id, s->name, s->batch, s->membershipType,
-               s->registrationDate, s->dob, s->interest);
+    // "%d\t%s\t%s\t%s\t%s\t%s\t%s\n"
+    OutBuf *o = outBegin();
+    for (size_t i=0;i<db->members.size;i++) {
+        if (isTombstone(db,i)) continue;
+        Student *s=&db->members.items[i];
+        outInt(o, s->id);
+        outChar(o, '\t'); outStr(o, s->name);
+        outChar(o, '\t'); outStr(o, s->batch);
+        outChar(o, '\t'); outStr(o, s->membershipType);
+        outChar(o, '\t'); outStr(o, s->registrationDate);
+        outChar(o, '\t'); outStr(o, s->dob);
+        outChar(o, '\t'); outStr(o, s->interest);
+        outChar(o, '\n');
     }
+    outEnd(o);
 }
 
 void displayBatchReport(const Database *db, const char *batch, const char *membership) {
     printf("\nReport for batch=%s, membership=%s:\n", batch, membership);
     printf("ID\tName\tRegDate\tDOB\tInterest\n");
     printf("------------------------------------------\n");
-    for (size_t i=0;i<db->size;i++) {
-        Student *s=&db->arr[i];
-        if (strcmp(s->batch,batch)==0 && (strcmp(s->membershipType,membership)==0 || strcmp(s->interest,membership)==0 || strcmp(s->interest,"Both")==0))
-            printf("%d\t%s\t%s\t%s\t%s\n", s->id,s->name,s->registrationDate,s->dob,s->interest);
+    // "%d\t%s\t%s\t%s\t%s\n"
+    OutBuf *o = outBegin();
+    for (size_t i=0;i<db->members.size;i++) {
+        if (isTombstone(db,i)) continue;
+        Student *s=&db->members.items[i];
+        if (strcmp(s->batch,batch)==0 && hasMembership(s,membership)) {
+            outInt(o, s->id);
+            outChar(o, '\t'); outStr(o, s->name);
+            outChar(o, '\t'); outStr(o, s->registrationDate);
+            outChar(o, '\t'); outStr(o, s->dob);
+            outChar(o, '\t'); outStr(o, s->interest);
+            outChar(o, '\n');
+        }
     }
+    outEnd(o);
 }
 
 // ----- Menu -----
@@ -177,40 +424,104 @@ void menu() {
     printf("4. View all students\n");
     printf("5. Batch-wise report\n");
     printf("6. Exit\n");
+    printf("7. Dump metrics\n");
+    printf("8. Sorted report (paged)\n");
+}
+
+#ifndef PFTHEORY_NO_MAIN
+// Write what an edit changed: just its slot, or the whole file once
+// compaction has moved the records since the last full save
+static void persist(Database *db, size_t slot, size_t *savedLayout) {
+    if (*savedLayout != db->layoutVersion) {
+        if (saveDatabase(db, DATAFILE)==0) *savedLayout = db->layoutVersion;
+    } else if (slot != (size_t)-1) {
+        saveRecord(db, DATAFILE, slot);
+    }
+}
+
+// "%d\t%s\t%s\t%s\t%s\t%s\n"
+static void printReportRows(const Student *rows, size_t n) {
+    OutBuf *o = outBegin();
+    for (size_t i=0;i<n;i++) {
+        outInt(o, rows[i].id);
+        outChar(o, '\t'); outStr(o, rows[i].name);
+        outChar(o, '\t'); outStr(o, rows[i].batch);
+        outChar(o, '\t'); outStr(o, rows[i].registrationDate);
+        outChar(o, '\t'); outStr(o, rows[i].dob);
+        outChar(o, '\t'); outStr(o, rows[i].interest);
+        outChar(o, '\n');
+    }
+    outEnd(o);
+}
+
+// Page one is picked straight from the table (top-N); asking for more
+// sorts the whole report and skips what was already shown. A page never
+// holds more than the live members, whatever size was typed in
+static void displaySortedReport(const Database *db, const ReportSpec *spec, size_t pageSize) {
+    size_t live = db->members.size - db->deadCount;
+    int onePage = pageSize >= live;
+    if (onePage) pageSize = live > 0 ? live : 1;
+    Student *rows = (Student *) xmalloc(pageSize * sizeof(Student));
+    Report *r = NULL;
+    size_t page = 1, n = reportTopN(db, spec, rows, pageSize);
+    char buf[8];
+    while (n > 0) {
+        printf("\n--- Page %zu ---\n", page);
+        printf("ID\tName\tBatch\tRegDate\tDOB\tInterest\n");
+        printReportRows(rows, n);
+        if (n < pageSize || onePage) break;
+        readString("Enter = next page, q = quit: ", buf, sizeof(buf));
+        if (buf[0]=='q' || feof(stdin)) break;
+        if (!r) {
+            if (!(r = reportOpen(db, spec))) break;
+            reportRead(r, rows, pageSize);
+        }
+        n = reportRead(r, rows, pageSize);
+        page++;
+    }
+    if (page==1 && n==0) printf("No matching members.\n");
+    reportClose(r);
+    free(rows);
 }
 
 int main() {
     Database db;
     initDatabase(&db);
+    db.compactInBackground = 1;
     loadDatabase(&db, DATAFILE);
+    size_t savedLayout = db.layoutVersion;
+    pfMetricsInstall(SIGUSR1);
 
     int choice;
     while (1) {
+        pfMetricsPoll();
+        if (finishCompaction(&db, 0)) persist(&db, (size_t)-1, &savedLayout);
         menu();
         choice = readInt("Enter choice: ");
         if (choice==1) {
             Student s;
             s.id = readInt("Enter Student ID: ");
-            if (findStudentIndex(&db,s.id)!=-1) { printf("Duplicate ID!\n"); continue; }
+            if (findStudentIndex(&db,s.id)!=(size_t)-1) { printf("Duplicate ID!\n"); continue; }
             readString("Full Name: ", s.name, NAME_LEN);
             readString("Batch (CS/SE/Cyber Security/AI): ", s.batch, BATCH_LEN);
             readString("Membership Type (IEEE/ACM): ", s.membershipType, TYPE_LEN);
             readString("Registration Date (YYYY-MM-DD): ", s.registrationDate, DATE_LEN);
             readString("Date of Birth (YYYY-MM-DD): ", s.dob, DATE_LEN);
             readString("Interest (IEEE/ACM/Both): ", s.interest, INTEREST_LEN);
-            if (addStudent(&db,&s)==0) saveDatabase(&db, DATAFILE);
+            if (addStudent(&db,&s)==0) persist(&db, findStudentIndex(&db,s.id), &savedLayout);
         }
         else if (choice==2) {
             int id = readInt("Enter Student ID to update: ");
             char batch[BATCH_LEN], membership[TYPE_LEN];
             readString("New Batch (leave blank to keep): ", batch, BATCH_LEN);
             readString("New Membership Type (leave blank to keep): ", membership, TYPE_LEN);
-            if (updateStudent(&db,id,batch,membership)==0) saveDatabase(&db, DATAFILE);
+            if (updateStudent(&db,id,batch,membership)==0) persist(&db, findStudentIndex(&db,id), &savedLayout);
             else printf("Student not found.\n");
         }
         else if (choice==3) {
             int id = readInt("Enter Student ID to delete: ");
-            if (deleteStudent(&db,id)==0) saveDatabase(&db, DATAFILE);
+            size_t idx = findStudentIndex(&db,id);
+            if (deleteStudent(&db,id)==0) persist(&db, idx, &savedLayout);
             else printf("Student not found.\n");
         }
         else if (choice==4) {
@@ -222,7 +533,23 @@ int main() {
             readString("Enter membership (IEEE/ACM/Both): ", membership, TYPE_LEN);
             displayBatchReport(&db,batch,membership);
         }
-        else if (choice==6) break;
+        else if (choice==6) {
+            if (finishCompaction(&db, 1)) persist(&db, (size_t)-1, &savedLayout);
+            break;
+        }
+        else if (choice==7) pfMetricsDump(stdout, 0);
+        else if (choice==8) {
+            char batch[BATCH_LEN], membership[TYPE_LEN];
+            ReportSpec spec = {0};
+            int key = readInt("Sort by (1 name, 2 registration date, 3 DOB): ");
+            spec.key = key==2 ? SORT_BY_REGDATE : key==3 ? SORT_BY_DOB : SORT_BY_NAME;
+            readString("Batch (leave blank for all): ", batch, BATCH_LEN);
+            readString("Membership (IEEE/ACM/Both, leave blank for any): ", membership, TYPE_LEN);
+            spec.batch = batch;
+            spec.membership = membership;
+            int pageSize = readInt("Rows per page: ");
+            displaySortedReport(&db, &spec, pageSize > 0 ? (size_t)pageSize : 20);
+        }
         else printf("Invalid choice!\n");
     }
 
@@ -230,3 +557,4 @@ int main() {
     printf("Exiting program.\n");
     return 0;
 }
+#endif
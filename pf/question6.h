@@ -0,0 +1,90 @@
+#ifndef PF_QUESTION6_H
+#define PF_QUESTION6_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "recstore.h"
+
+#define DATAFILE "members.dat"
+#define NAME_LEN 100
+#define BATCH_LEN 32
+#define TYPE_LEN 16
+#define DATE_LEN 11
+#define INTEREST_LEN 16
+
+// A deleted record keeps its slot (and its place in the file) as a zeroed
+// record with this id until compaction; addStudent rejects the id
+#define TOMBSTONE_ID INT32_MIN
+// Compact once at least COMPACT_MIN_DEAD slots, and 1/COMPACT_RATIO of all
+// slots, are tombstones
+#define COMPACT_RATIO 4
+#define COMPACT_MIN_DEAD 64
+
+typedef struct {
+    int id;
+    char name[NAME_LEN];
+    char batch[BATCH_LEN];           // CS, SE, Cyber Security, AI
+    char membershipType[TYPE_LEN];   // IEEE / ACM
+    char registrationDate[DATE_LEN];
+    char dob[DATE_LEN];
+    char interest[INTEREST_LEN];     // IEEE / ACM / Both
+} Student;
+
+// Slots in file order, indexed by id; tombstones are left out of the index
+#define STUDENT_ID(s) ((s)->id)
+#define STUDENT_LIVE(s) ((s)->id != TOMBSTONE_ID)
+RECSTORE_DEFINE(StudentStore, studentStore, Student, int, STUDENT_ID,
+                recstoreHashInt, RECSTORE_EQ, STUDENT_LIVE)
+
+typedef struct Compaction Compaction;
+
+typedef struct {
+    StudentStore members;       // members.size slots in use, live or tombstoned
+    uint64_t *dead;             // tombstone bit per slot, members.capacity bits
+    size_t deadCount;
+    size_t *freeSlots;          // tombstoned slots addStudent can reuse
+    size_t freeCount, freeCap;
+    size_t layoutVersion;       // bumped whenever compaction moves records
+    int compactInBackground;    // compact on a helper thread instead of inline
+    Compaction *compaction;     // background pass in progress, or NULL
+} Database;
+
+void *xmalloc(size_t n);
+void *xrealloc(void *ptr, size_t n);
+
+void initDatabase(Database *db);
+void freeDatabase(Database *db);
+void ensureCapacity(Database *db, size_t minCapacity);
+
+// ----- File operations -----
+int loadDatabase(Database *db, const char *filename);
+int saveDatabase(const Database *db, const char *filename);
+// Rewrite only slot 'index' in a file saved from the same layoutVersion
+int saveRecord(const Database *db, const char *filename, size_t index);
+
+// ----- In-memory operations -----
+// Index of the student with this id, or (size_t)-1 if absent
+size_t findStudentIndex(const Database *db, int id);
+int addStudent(Database *db, const Student *s);
+int deleteStudent(Database *db, int id);
+int updateStudent(Database *db, int id, const char *newBatch, const char *newMembership);
+int isTombstone(const Database *db, size_t index);
+// Member of IEEE/ACM by type or by interest, as the batch report counts it
+int hasMembership(const Student *s, const char *membership);
+
+// ----- Compaction -----
+// Deletes leave tombstones; once needsCompaction() the table is compacted,
+// inline or (compactInBackground) by a thread that copies the live records
+// while edits continue. finishCompaction() swaps the copy in, bringing over
+// the slots edited meanwhile; it returns 1 if it did (records moved, so the
+// file needs a full save), 0 if no pass was ready (wait=0) or running.
+int needsCompaction(const Database *db);
+void compactDatabase(Database *db);
+int startCompaction(Database *db);
+int finishCompaction(Database *db, int wait);
+
+// ----- Display functions -----
+void displayAll(const Database *db);
+void displayBatchReport(const Database *db, const char *batch, const char *membership);
+
+#endif
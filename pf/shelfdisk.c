@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "shelfdisk.h"
+#include "instrument.h"
+
+#define NO_RECORD UINT32_MAX
+#define PENDING 4096           // records buffered before a write
+#define COMPACT_SLACK 65536    // garbage records tolerated on top of 1x live
+
+struct DiskRecord {
+    int id;
+    int pop;
+    long long expires;         // TTL deadline on the shelf's clock, 0 = none
+};
+
+struct IndexSlot {
+    int id;
+    uint32_t rec;              // record number in the file, NO_RECORD = free
+};
+
+struct DiskTier {
+    int fd;
+    char *path;
+    struct IndexSlot *table;
+    size_t mask;               // table size - 1 (a power of two)
+    size_t count;
+    size_t records;            // records appended, written or pending
+    size_t flushed;            // records already in the file
+    struct DiskRecord pending[PENDING];
+};
+
+static size_t slotOf(const struct DiskTier *t, int id) {
+    return (size_t) (((uint32_t) id * 2654435761u) & t->mask);
+}
+
+// Index of the slot holding id, or of the free slot where it would go
+static size_t probe(const struct DiskTier *t, int id) {
+    size_t i = slotOf(t, id);
+    while (t->table[i].rec != NO_RECORD && t->table[i].id != id) i = (i + 1) & t->mask;
+    return i;
+}
+
+static struct IndexSlot *newTable(size_t size) {
+    struct IndexSlot *table = (struct IndexSlot *) malloc(size * sizeof(struct IndexSlot));
+    if (!table) {
+        perror("malloc failed");
+        exit(1);
+    }
+    for (size_t i = 0; i < size; i++) table[i].rec = NO_RECORD;
+    return table;
+}
+
+static void grow(struct DiskTier *t) {
+    struct IndexSlot *old = t->table;
+    size_t oldSize = t->mask + 1;
+    t->table = newTable(oldSize * 2);
+    t->mask = oldSize * 2 - 1;
+    for (size_t i = 0; i < oldSize; i++)
+        if (old[i].rec != NO_RECORD) t->table[probe(t, old[i].id)] = old[i];
+    free(old);
+}
+
+// Linear-probing delete: pull later entries of the cluster back into the hole
+static void removeSlot(struct DiskTier *t, size_t hole) {
+    size_t i = hole;
+    for (;;) {
+        i = (i + 1) & t->mask;
+        if (t->table[i].rec == NO_RECORD) break;
+        size_t home = slotOf(t, t->table[i].id);
+        // move it unless its home lies cyclically in (hole, i]
+        if ((i > hole && (home <= hole || home > i)) || (i < hole && home <= hole && home > i)) {
+            t->table[hole] = t->table[i];
+            hole = i;
+        }
+    }
+    t->table[hole].rec = NO_RECORD;
+    t->count--;
+}
+
+static int writeAllAt(int fd, const void *buf, size_t n, off_t off) {
+    const char *p = (const char *) buf;
+    while (n > 0) {
+        ssize_t w = pwrite(fd, p, n, off);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        n -= (size_t) w;
+        off += w;
+    }
+    return 0;
+}
+
+static int flush(struct DiskTier *t) {
+    size_t n = t->records - t->flushed;
+    if (n == 0) return 0;
+    if (writeAllAt(t->fd, t->pending, n * sizeof(struct DiskRecord),
+                   (off_t) (t->flushed * sizeof(struct DiskRecord))) != 0) {
+        perror("disk tier write failed");
+        return -1;
+    }
+    t->flushed = t->records;
+    return 0;
+}
+
+static int readRecord(struct DiskTier *t, uint32_t rec, struct DiskRecord *r) {
+    if (rec >= t->flushed) {
+        *r = t->pending[rec - t->flushed];
+        return 0;
+    }
+    ssize_t got = pread(t->fd, r, sizeof(*r), (off_t) rec * (off_t) sizeof(*r));
+    if (got != (ssize_t) sizeof(*r)) {
+        perror("disk tier read failed");
+        return -1;
+    }
+    return 0;
+}
+
+// Rewrite the file with only the live records, in table order. On failure
+// the old file and table stay as they were.
+static int compact(struct DiskTier *t) {
+    PF_TIMED("question4.diskTier.compact");
+    if (flush(t) != 0) return -1;
+    size_t len = strlen(t->path);
+    char *tmp = (char *) malloc(len + 5);
+    if (!tmp) return -1;
+    memcpy(tmp, t->path, len);
+    memcpy(tmp + len, ".tmp", 5);
+    int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("disk tier compaction failed");
+        free(tmp);
+        return -1;
+    }
+
+    struct DiskRecord out[PENDING];
+    size_t n = 0, written = 0;
+    int failed = 0;
+    for (size_t i = 0; i <= t->mask && !failed; i++) {
+        if (t->table[i].rec == NO_RECORD) continue;
+        failed = readRecord(t, t->table[i].rec, &out[n++]) != 0;
+        if (!failed && n == PENDING) {
+            failed = writeAllAt(fd, out, n * sizeof(out[0]), (off_t) (written * sizeof(out[0]))) != 0;
+            written += n;
+            n = 0;
+        }
+    }
+    if (!failed && n > 0) failed = writeAllAt(fd, out, n * sizeof(out[0]), (off_t) (written * sizeof(out[0]))) != 0;
+    if (failed || rename(tmp, t->path) != 0) {
+        perror("disk tier compaction failed");
+        close(fd);
+        unlink(tmp);
+        free(tmp);
+        return -1;
+    }
+    free(tmp);
+    close(t->fd);
+    t->fd = fd;
+    // same order as written
+    size_t rec = 0;
+    for (size_t i = 0; i <= t->mask; i++)
+        if (t->table[i].rec != NO_RECORD) t->table[i].rec = (uint32_t) rec++;
+    t->records = t->flushed = rec;
+    return 0;
+}
+
+struct DiskTier *diskTierOpen(const char *path) {
+    struct DiskTier *t = (struct DiskTier *) malloc(sizeof(struct DiskTier));
+    char *name = (char *) malloc(strlen(path) + 1);
+    if (!t || !name) {
+        perror("malloc failed");
+        exit(1);
+    }
+    t->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (t->fd < 0) {
+        perror("cannot open disk tier");
+        free(name);
+        free(t);
+        return NULL;
+    }
+    strcpy(name, path);
+    t->path = name;
+    t->table = newTable(1024);
+    t->mask = 1023;
+    t->count = t->records = t->flushed = 0;
+    return t;
+}
+
+void diskTierClose(struct DiskTier *t) {
+    if (!t) return;
+    close(t->fd);
+    unlink(t->path);
+    free(t->path);
+    free(t->table);
+    free(t);
+}
+
+int diskTierPut(struct DiskTier *t, int id, int pop, long long expires) {
+    if (t->records - t->flushed == PENDING && flush(t) != 0) return -1;
+    if (t->records >= NO_RECORD - 1) return -1;
+    t->pending[t->records - t->flushed] = (struct DiskRecord) {id, pop, expires};
+    size_t i = probe(t, id);
+    if (t->table[i].rec == NO_RECORD) {
+        t->table[i].id = id;
+        t->count++;
+    }
+    t->table[i].rec = (uint32_t) t->records++;
+    if (2 * t->count > t->mask) grow(t);
+    // a failed compaction leaves a longer file but loses nothing
+    if (t->records > 2 * t->count + COMPACT_SLACK) compact(t);
+    return 0;
+}
+
+int diskTierTake(struct DiskTier *t, int id, int *pop, long long *expires) {
+    size_t i = probe(t, id);
+    if (t->table[i].rec == NO_RECORD) return 0;
+    struct DiskRecord r;
+    if (readRecord(t, t->table[i].rec, &r) != 0) return -1;
+    removeSlot(t, i);
+    *pop = r.pop;
+    *expires = r.expires;
+    return 1;
+}
+
+void diskTierDrop(struct DiskTier *t, int id) {
+    size_t i = probe(t, id);
+    if (t->table[i].rec != NO_RECORD) removeSlot(t, i);
+}
+
+size_t diskTierCount(const struct DiskTier *t) {
+    return t->count;
+}
+
+size_t diskTierRecords(const struct DiskTier *t) {
+    return t->records;
+}
@@ -0,0 +1,32 @@
+#ifndef PF_SHELFDISK_H
+#define PF_SHELFDISK_H
+
+#include <stddef.h>
+
+// Disk tier of the shelf: books evicted from RAM are appended to a file
+// as {id, pop, expires} records; an open-addressing table maps each id to
+// its latest record. A slot is 8 bytes and the table doubles once half
+// full, so a book held costs 16-32 bytes of RAM. Taking or dropping a
+// book only removes it from the table, and the file is rewritten with the
+// live records once most of it is garbage. The file is scratch space for one
+// run: opening truncates it.
+
+struct DiskTier;
+
+// NULL on error (message printed)
+struct DiskTier *diskTierOpen(const char *path);
+void diskTierClose(struct DiskTier *t);
+
+// Store (or replace) a demoted book with its TTL deadline (0 = none), which
+// is kept, not enforced. 0 on success, -1 on a write error
+int diskTierPut(struct DiskTier *t, int id, int pop, long long expires);
+// Remove a book and return its popularity and deadline: 1 found, 0 absent,
+// -1 read error
+int diskTierTake(struct DiskTier *t, int id, int *pop, long long *expires);
+// Forget a book (a newer copy is in RAM)
+void diskTierDrop(struct DiskTier *t, int id);
+
+size_t diskTierCount(const struct DiskTier *t);     // books held
+size_t diskTierRecords(const struct DiskTier *t);   // records in the file, live or not
+
+#endif
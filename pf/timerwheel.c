@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include "timerwheel.h"
+
+#define BUCKETS (1 << WHEEL_BITS)
+#define BUCKET_MASK (BUCKETS - 1)
+#define SPAN(level) (1LL << (WHEEL_BITS * (level)))   // ticks per bucket at a level
+#define OVERDUE (WHEEL_LEVELS * BUCKETS)                 // bucket of timers set in the past
+
+// Slots and bucket heads share one array: node slots + b is the head of
+// bucket b (level b / BUCKETS, OVERDUE last) of a circular doubly linked list
+struct WheelNode {
+    int next;
+    int prev;
+    long long expires;         // 0 = no timer (unused for heads)
+};
+
+struct TimerWheel {
+    int slots;
+    long long base;            // next tick to run
+    size_t count;
+    uint64_t used[WHEEL_LEVELS + 1];   // non-empty buckets per level, then OVERDUE
+    struct WheelNode *nodes;
+};
+
+static void bucketAdd(struct TimerWheel *w, int n, int bucket) {
+    struct WheelNode *nodes = w->nodes;
+    int head = w->slots + bucket;
+    int tail = nodes[head].prev;
+    nodes[n].prev = tail;
+    nodes[n].next = head;
+    nodes[tail].next = n;
+    nodes[head].prev = n;
+    w->used[bucket / BUCKETS] |= 1ull << (bucket & BUCKET_MASK);
+}
+
+static void bucketRemove(struct TimerWheel *w, int n) {
+    struct WheelNode *nodes = w->nodes;
+    int p = nodes[n].prev, q = nodes[n].next;
+    nodes[p].next = q;
+    nodes[q].prev = p;
+    // the only neighbour left on both sides is the head: the bucket is empty
+    if (p == q) {
+        int bucket = p - w->slots;
+        w->used[bucket / BUCKETS] &= ~(1ull << (bucket & BUCKET_MASK));
+    }
+}
+
+// Put an armed node in the bucket its expiry falls in, relative to base
+static void place(struct TimerWheel *w, int n) {
+    long long e = w->nodes[n].expires;
+    long long delta = e - w->base;
+    if (delta < 0) {
+        bucketAdd(w, n, OVERDUE);
+        return;
+    }
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= SPAN(level + 1)) level++;
+    // beyond the top level: park it in the last bucket it can reach
+    if (delta >= SPAN(WHEEL_LEVELS)) e = w->base + SPAN(WHEEL_LEVELS) - 1;
+    bucketAdd(w, n, level * BUCKETS + (int) ((e >> (WHEEL_BITS * level)) & BUCKET_MASK));
+}
+
+// Spread one bucket of a higher level over the levels below it; timers
+// already due by 'now' (the clock jumped) fire here instead
+static size_t cascade(struct TimerWheel *w, int level, int idx, long long now,
+                      void (*expire)(void *ctx, int slot), void *ctx) {
+    struct WheelNode *nodes = w->nodes;
+    int head = w->slots + level * BUCKETS + idx;
+    if (nodes[head].next == head) return 0;
+    int n = nodes[head].next, last = nodes[head].prev;
+    nodes[head].next = nodes[head].prev = head;
+    w->used[level] &= ~(1ull << idx);
+    size_t fired = 0;
+    for (;;) {
+        int next = nodes[n].next;
+        int done = n == last;
+        if (nodes[n].expires <= now) {
+            nodes[n].expires = 0;
+            w->count--;
+            fired++;
+            expire(ctx, n);
+        } else {
+            place(w, n);
+        }
+        if (done) break;
+        n = next;
+    }
+    return fired;
+}
+
+struct TimerWheel *wheelCreate(int slots, long long now) {
+    struct TimerWheel *w = (struct TimerWheel *) malloc(sizeof(struct TimerWheel));
+    size_t total = (size_t) (slots > 0 ? slots : 0) + OVERDUE + 1;
+    struct WheelNode *nodes = (struct WheelNode *) malloc(total * sizeof(struct WheelNode));
+    if (!w || !nodes) {
+        perror("malloc failed");
+        exit(1);
+    }
+    w->slots = slots > 0 ? slots : 0;
+    w->base = now + 1;
+    w->count = 0;
+    for (int i = 0; i <= WHEEL_LEVELS; i++) w->used[i] = 0;
+    for (size_t i = 0; i < total; i++) {
+        nodes[i].next = nodes[i].prev = (int) i;
+        nodes[i].expires = 0;
+    }
+    w->nodes = nodes;
+    return w;
+}
+
+void wheelFree(struct TimerWheel *w) {
+    if (!w) return;
+    free(w->nodes);
+    free(w);
+}
+
+void wheelSet(struct TimerWheel *w, int slot, long long expires) {
+    struct WheelNode *n = &w->nodes[slot];
+    if (n->expires) {
+        bucketRemove(w, slot);
+        w->count--;
+    }
+    n->expires = expires;
+    if (expires) {
+        place(w, slot);
+        w->count++;
+    }
+}
+
+long long wheelExpiry(const struct TimerWheel *w, int slot) {
+    return w->nodes[slot].expires;
+}
+
+// First tick after base at which a bucket runs or cascades, given that
+// nothing in level 0 is due at base
+static long long nextEvent(const struct TimerWheel *w) {
+    long long best = LLONG_MAX;
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        if (!w->used[level]) continue;
+        int shift = WHEEL_BITS * level;
+        int pos = (int) ((w->base >> shift) & BUCKET_MASK);
+        uint64_t later = pos == BUCKET_MASK ? 0 : w->used[level] >> (pos + 1) << (pos + 1);
+        long long t;
+        if (later)
+            t = ((w->base >> shift) - pos + __builtin_ctzll(later)) << shift;
+        else
+            // only buckets of the next round: they wait for this level to wrap
+            t = ((w->base >> (shift + WHEEL_BITS)) + 1) << (shift + WHEEL_BITS);
+        if (t < best) best = t;
+    }
+    return best;
+}
+
+// Fire every timer in a bucket
+static size_t runBucket(struct TimerWheel *w, int bucket, void (*expire)(void *ctx, int slot), void *ctx) {
+    struct WheelNode *nodes = w->nodes;
+    int head = w->slots + bucket;
+    size_t fired = 0;
+    while (nodes[head].next != head) {
+        int n = nodes[head].next;
+        bucketRemove(w, n);
+        nodes[n].expires = 0;
+        w->count--;
+        fired++;
+        expire(ctx, n);
+    }
+    return fired;
+}
+
+size_t wheelAdvance(struct TimerWheel *w, long long now, void (*expire)(void *ctx, int slot), void *ctx) {
+    size_t fired = runBucket(w, OVERDUE, expire, ctx);
+    while (w->base <= now) {
+        if (w->count == 0) {
+            w->base = now + 1;
+            break;
+        }
+        int idx = (int) (w->base & BUCKET_MASK);
+        if (idx == 0) {
+            // level 0 wrapped: bring down the next bucket of level 1, and so on up
+            for (int level = 1; level < WHEEL_LEVELS; level++) {
+                int j = (int) ((w->base >> (WHEEL_BITS * level)) & BUCKET_MASK);
+                fired += cascade(w, level, j, now, expire, ctx);
+                if (j != 0) break;
+            }
+        }
+        if ((w->used[0] >> idx) == 0) {
+            // nothing due this tick: jump to the next bucket that runs or cascades
+            long long next = nextEvent(w);
+            w->base = next <= now ? next : now + 1;
+            continue;
+        }
+
+        // everything in a level-0 bucket is due by the tick it is run at
+        w->base++;
+        fired += runBucket(w, idx, expire, ctx);
+    }
+    return fired;
+}
+
+size_t wheelCount(const struct TimerWheel *w) {
+    return w->count;
+}
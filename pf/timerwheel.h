@@ -0,0 +1,36 @@
+#ifndef PF_TIMERWHEEL_H
+#define PF_TIMERWHEEL_H
+
+#include <stddef.h>
+
+// Hierarchical timer wheel over a fixed set of slots (one timer per slot).
+// WHEEL_LEVELS wheels of 64 buckets; level k holds timers due within 64^(k+1)
+// ticks, each bucket spanning 64^k ticks. Setting or cancelling a timer is
+// O(1); advancing the clock runs the level-0 bucket of each tick and, every
+// 64 ticks, spreads one bucket of the next level down ("cascading"), so each
+// timer is touched at most WHEEL_LEVELS times before it fires. Ticks with
+// nothing due are skipped up to the next bucket that runs or cascades.
+// Timers further out than 64^WHEEL_LEVELS ticks wait in the top level and
+// are placed again when it comes round.
+
+#define WHEEL_LEVELS 6
+#define WHEEL_BITS 6
+
+struct TimerWheel;
+
+// Timers for slots [0, slots); the clock starts at 'now'
+struct TimerWheel *wheelCreate(int slots, long long now);
+void wheelFree(struct TimerWheel *w);
+
+// Arm the slot's timer to fire at tick 'expires' (replacing any earlier
+// one); 0 cancels it. A tick that has already passed fires on the next advance.
+void wheelSet(struct TimerWheel *w, int slot, long long expires);
+// The tick the slot's timer fires at, 0 if none
+long long wheelExpiry(const struct TimerWheel *w, int slot);
+// Move the clock to 'now', calling expire(ctx, slot) for every timer due
+// at or before it (the timer is already cleared; expire must not set
+// timers). Returns how many fired.
+size_t wheelAdvance(struct TimerWheel *w, long long now, void (*expire)(void *ctx, int slot), void *ctx);
+size_t wheelCount(const struct TimerWheel *w);   // timers armed
+
+#endif
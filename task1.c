@@ -1,69 +1,122 @@
 #include <stdio.h>
 #include <string.h>
-void addBook(int isbns[],char titles[][50],float prices[],int quantities[],int *count){
-    int isbn,i,found=0;
-    if(*count>=100)return;
+#include <signal.h>
+#include "task1.h"
+#include "instrument.h"
+#include "outbuf.h"
+void addBook(BookStore *books,TitleIndex *index){
+    int isbn;
+    Book *b;
     printf("Enter ISBN: ");
     scanf("%d",&isbn);
-    for(i=0;i<*count;i++){
-        if(isbns[i]==isbn){
-            found=1;
-            break;
-        }
-    }
-    if(found){
+    if(findIsbn(books,isbn)>=0){
         printf("Book already exists\n");
         return;
     }
-    isbns[*count]=isbn;
+    /* read straight into the next free slot */
+    bookStoreReserve(books,books->size+1);
+    b=&books->items[books->size];
+    b->isbn=isbn;
     printf("Enter title: ");
-    scanf(" %[^\n]",titles[*count]);
+    scanf(" %[^\n]",b->title);
+    if(index)titleIndexAdd(index,(int)books->size,b->title);
     printf("Enter price: ");
-    scanf("%f",&prices[*count]);
+    scanf("%f",&b->price);
     printf("Enter quantity: ");
-    scanf("%d",&quantities[*count]);
-    (*count)++;
+    scanf("%d",&b->quantity);
+    bookStorePush(books,b);
 }
-void processSale(int isbns[],int quantities[],int count){
-    int isbn,i,num,found=0;
+int findIsbn(const BookStore *books,int isbn){
+    PF_TIMED("task1.processSale.lookup");
+    return (int)bookStoreFind(books,isbn);
+}
+int sellCopies(Book *book,int num){
+    PF_TIMED("task1.processSale.sell");
+    if(num>book->quantity)return -1;
+    book->quantity-=num;
+    return 0;
+}
+void processSale(BookStore *books){
+    int isbn,idx,num;
     printf("Enter ISBN: ");
     scanf("%d",&isbn);
-    for(i=0;i<count;i++){
-        if(isbns[i]==isbn){
-            found=1;
-            printf("Enter number of copies sold: ");
-            scanf("%d",&num);
-            if(num>quantities[i])printf("Out of stock\n");
-            else quantities[i]-=num;
-            break;
-        }
+    idx=findIsbn(books,isbn);
+    if(idx<0){
+        PF_COUNT("task1.processSale.notFound",1);
+        printf("Book not found\n");
+        return;
+    }
+    printf("Enter number of copies sold: ");
+    scanf("%d",&num);
+    if(sellCopies(&books->items[idx],num)!=0){
+        PF_COUNT("task1.processSale.outOfStock",1);
+        printf("Out of stock\n");
     }
-    if(!found)printf("Book not found\n");
 }
-void lowStock(int isbns[],char titles[][50],float prices[],int quantities[],int count){
-    int i,found=0;
-    for(i=0;i<count;i++){
-        if(quantities[i]<5){
-            printf("ISBN: %d Title: %s Price: %.2f Quantity: %d\n",isbns[i],titles[i],prices[i],quantities[i]);
+/* "ISBN: %d Title: %s Price: %.2f Quantity: %d\n" */
+static void printBook(OutBuf *o,const Book *b){
+    outStr(o,"ISBN: ");
+    outInt(o,b->isbn);
+    outStr(o," Title: ");
+    outStr(o,b->title);
+    outStr(o," Price: ");
+    outFixed(o,b->price,2);
+    outStr(o," Quantity: ");
+    outInt(o,b->quantity);
+    outChar(o,'\n');
+}
+void lowStock(const BookStore *books){
+    OutBuf *o=outBegin();
+    size_t i;
+    int found=0;
+    for(i=0;i<books->size;i++){
+        const Book *b=&books->items[i];
+        if(b->quantity<5){
+            printBook(o,b);
             found=1;
         }
     }
+    outEnd(o);
     if(!found)printf("No low stock books\n");
 }
+void searchTitles(const BookStore *books,const TitleIndex *index){
+    char query[50];
+    int results[TITLE_TOP_K],i,n=0,len,prefix=0;
+    OutBuf *o;
+    printf("Enter title text (end with * for prefix): ");
+    if(scanf(" %49[^\n]",query)!=1)return;
+    len=(int)strlen(query);
+    if(len>0&&query[len-1]=='*'){
+        query[len-1]='\0';
+        prefix=1;
+    }
+    if(books->size>0)n=titleIndexSearch(index,books->items[0].title,sizeof(Book),(int)books->size,query,prefix,results,TITLE_TOP_K);
+    o=outBegin();
+    for(i=0;i<n;i++)printBook(o,&books->items[results[i]]);
+    outEnd(o);
+    if(n==0)printf("No matching books\n");
+}
 
+#ifndef PFTHEORY_NO_MAIN
 int main(){
-    int isbns[100],quantities[100],count=0,choice;
-    char titles[100][50];
-    float prices[100];
+    int choice;
+    BookStore books;
+    TitleIndex *index=titleIndexCreate();
+    bookStoreInit(&books);
+    pfMetricsInstall(SIGUSR1);
     while(1){
-        printf("1.Add New Book\n2.Process Sale\n3.Low Stock Report\n4.Exit\nEnter choice: ");
+        pfMetricsPoll();
+        printf("1.Add New Book\n2.Process Sale\n3.Low Stock Report\n4.Exit\n5.Dump Metrics\n6.Search Titles\nEnter choice: ");
         scanf("%d",&choice);
         switch(choice){
-            case 1:addBook(isbns,titles,prices,quantities,&count);break;
-            case 2:processSale(isbns,quantities,count);break;
-            case 3:lowStock(isbns,titles,prices,quantities,count);break;
-            case 4:return 0;
+            case 1:addBook(&books,index);break;
+            case 2:processSale(&books);break;
+            case 3:lowStock(&books);break;
+            case 4:titleIndexFree(index);bookStoreFree(&books);return 0;
+            case 5:pfMetricsDump(stdout,0);break;
+            case 6:searchTitles(&books,index);break;
             default:printf("Invalid choice\n");
         }
     }
 }
+#endif
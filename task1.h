@@ -0,0 +1,23 @@
+#ifndef TASK1_H
+#define TASK1_H
+
+#include "titleindex.h"
+#include "recstore.h"
+
+typedef struct{
+    int isbn;
+    char title[50];
+    float price;
+    int quantity;
+}Book;
+#define BOOK_ISBN(b) ((b)->isbn)
+RECSTORE_DEFINE(BookStore,bookStore,Book,int,BOOK_ISBN,recstoreHashInt,RECSTORE_EQ,RECSTORE_ALL)
+
+void addBook(BookStore *books,TitleIndex *index);
+int findIsbn(const BookStore *books,int isbn);
+int sellCopies(Book *book,int num);
+void processSale(BookStore *books);
+void lowStock(const BookStore *books);
+void searchTitles(const BookStore *books,const TitleIndex *index);
+
+#endif
@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <ctype.h>
+#include "titleindex.h"
+#include "instrument.h"
+#define START 1
+#define MAXLEN 49
+typedef struct{
+    unsigned char *bytes;
+    uint32_t len,cap;
+    int count,last;
+    int *skipBase;
+    uint32_t *skipOff;
+    int blocks,blockCap;
+}Posting;
+typedef struct{
+    const Posting *p;
+    uint32_t off;
+    int cur,seen;
+}Cursor;
+typedef struct{
+    int book,tier,len;
+}Hit;
+struct TitleIndex{
+    uint32_t *keys;
+    int *lists;
+    size_t mask,used;
+    Posting *postings;
+    int count,cap;
+};
+static void *grow(void *p,size_t n){
+    void *q=realloc(p,n);
+    if(!q){
+        perror("malloc failed");
+        exit(1);
+    }
+    return q;
+}
+static size_t slotOf(const TitleIndex *ix,uint32_t key){
+    uint32_t h=key*2654435761u;
+    size_t i=(h^(h>>15))&ix->mask;
+    while(ix->keys[i]&&ix->keys[i]!=key)i=(i+1)&ix->mask;
+    return i;
+}
+static int lower(const char *s,unsigned char *out){
+    int n=0;
+    while(s[n]&&n<MAXLEN){
+        out[n]=(unsigned char)tolower((unsigned char)s[n]);
+        n++;
+    }
+    return n;
+}
+static uint32_t trigram(const unsigned char *s){
+    return ((uint32_t)s[0]<<16)|((uint32_t)s[1]<<8)|s[2];
+}
+TitleIndex *titleIndexCreate(void){
+    TitleIndex *ix=grow(NULL,sizeof(TitleIndex));
+    ix->mask=1023;
+    ix->used=0;
+    ix->keys=grow(NULL,(ix->mask+1)*sizeof(uint32_t));
+    ix->lists=grow(NULL,(ix->mask+1)*sizeof(int));
+    memset(ix->keys,0,(ix->mask+1)*sizeof(uint32_t));
+    ix->postings=NULL;
+    ix->count=ix->cap=0;
+    return ix;
+}
+void titleIndexFree(TitleIndex *ix){
+    int i;
+    if(!ix)return;
+    for(i=0;i<ix->count;i++){
+        free(ix->postings[i].bytes);
+        free(ix->postings[i].skipBase);
+        free(ix->postings[i].skipOff);
+    }
+    free(ix->postings);
+    free(ix->keys);
+    free(ix->lists);
+    free(ix);
+}
+static void rehash(TitleIndex *ix){
+    uint32_t *keys=ix->keys;
+    int *lists=ix->lists;
+    size_t i,old=ix->mask+1;
+    ix->mask=old*2-1;
+    ix->keys=grow(NULL,old*2*sizeof(uint32_t));
+    ix->lists=grow(NULL,old*2*sizeof(int));
+    memset(ix->keys,0,old*2*sizeof(uint32_t));
+    for(i=0;i<old;i++){
+        if(keys[i]){
+            size_t j=slotOf(ix,keys[i]);
+            ix->keys[j]=keys[i];
+            ix->lists[j]=lists[i];
+        }
+    }
+    free(keys);
+    free(lists);
+}
+static Posting *listFor(TitleIndex *ix,uint32_t key){
+    size_t i=slotOf(ix,key);
+    Posting *p;
+    if(ix->keys[i])return &ix->postings[ix->lists[i]];
+    if(ix->count==ix->cap){
+        ix->cap=ix->cap?ix->cap*2:256;
+        ix->postings=grow(ix->postings,(size_t)ix->cap*sizeof(Posting));
+    }
+    p=&ix->postings[ix->count];
+    memset(p,0,sizeof(Posting));
+    p->last=-1;
+    ix->keys[i]=key;
+    ix->lists[i]=ix->count++;
+    if(2*++ix->used>ix->mask)rehash(ix);
+    return p;
+}
+static void append(Posting *p,int book){
+    uint32_t d=(uint32_t)(book-p->last);
+    if(p->count%TITLE_SKIP==0){
+        if(p->blocks==p->blockCap){
+            p->blockCap=p->blockCap?p->blockCap*2:4;
+            p->skipBase=grow(p->skipBase,(size_t)p->blockCap*sizeof(int));
+            p->skipOff=grow(p->skipOff,(size_t)p->blockCap*sizeof(uint32_t));
+        }
+        p->skipBase[p->blocks]=p->last;
+        p->skipOff[p->blocks++]=p->len;
+    }
+    if(p->cap-p->len<5){
+        p->cap=p->cap?p->cap*2:16;
+        p->bytes=grow(p->bytes,p->cap);
+    }
+    while(d>=0x80){
+        p->bytes[p->len++]=(unsigned char)(d|0x80);
+        d>>=7;
+    }
+    p->bytes[p->len++]=(unsigned char)d;
+    p->last=book;
+    p->count++;
+}
+void titleIndexAdd(TitleIndex *ix,int book,const char *title){
+    unsigned char s[MAXLEN+2];
+    int i,n;
+    s[0]=s[1]=START;
+    n=lower(title,s+2)+2;
+    for(i=0;i+2<n;i++){
+        Posting *p=listFor(ix,trigram(s+i));
+        if(p->last!=book)append(p,book);
+    }
+}
+static int next(Cursor *c){
+    uint32_t d=0;
+    int shift=0;
+    unsigned char b;
+    if(c->seen==c->p->count)return INT_MAX;
+    do{
+        b=c->p->bytes[c->off++];
+        d|=(uint32_t)(b&0x7f)<<shift;
+        shift+=7;
+    }while(b&0x80);
+    c->seen++;
+    return c->cur+=(int)d;
+}
+/* First book >= target, skipping whole blocks that end before it */
+static int seek(Cursor *c,int target){
+    const Posting *p=c->p;
+    int lo=c->seen/TITLE_SKIP+1,hi=p->blocks-1,b=-1;
+    if(c->seen>0&&c->cur>=target)return c->cur;
+    while(lo<=hi){
+        int mid=lo+(hi-lo)/2;
+        if(p->skipBase[mid]<target){
+            b=mid;
+            lo=mid+1;
+        }
+        else hi=mid-1;
+    }
+    if(b>=0){
+        c->off=p->skipOff[b];
+        c->cur=p->skipBase[b];
+        c->seen=b*TITLE_SKIP;
+    }
+    for(;;){
+        int v=next(c);
+        if(v>=target)return v;
+    }
+}
+/* 0 exact, 1 prefix, 2 start of a word, 3 anywhere; -1 no match */
+static int matchTier(const char *title,const unsigned char *q,int qlen,int prefix){
+    int tlen=(int)strlen(title),pos,j,best=-1;
+    for(pos=0;pos+qlen<=tlen;pos++){
+        int t;
+        for(j=0;j<qlen&&tolower((unsigned char)title[pos+j])==q[j];j++);
+        if(j==qlen){
+            t=pos==0?(tlen==qlen?0:1):(isalnum((unsigned char)title[pos-1])?3:2);
+            if(best<0||t<best)best=t;
+            if(best<=2)break;
+        }
+        if(prefix)break;
+    }
+    return best;
+}
+static int consider(Hit top[],int found,int k,const char *titles,size_t stride,int book,const unsigned char *q,int qlen,int prefix){
+    const char *title=titles+(size_t)book*stride;
+    Hit h;
+    int i;
+    h.tier=matchTier(title,q,qlen,prefix);
+    if(h.tier<0)return found;
+    h.book=book;
+    h.len=(int)strlen(title);
+    for(i=found;i>0;i--){
+        Hit *o=&top[i-1];
+        if(o->tier<h.tier||(o->tier==h.tier&&(o->len<h.len||(o->len==h.len&&o->book<h.book))))break;
+        if(i<k)top[i]=*o;
+    }
+    if(i<k)top[i]=h;
+    return found<k?found+1:found;
+}
+int titleIndexSearch(const TitleIndex *ix,const char *titles,size_t stride,int count,const char *query,int prefix,int results[],int k){
+    PF_TIMED("task1.titleSearch");
+    unsigned char s[MAXLEN+2],*q=s+2;
+    const Posting *lists[MAXLEN+1];
+    int *cand=NULL;
+    int i,j,n=0,nc=0,found=0,qlen;
+    Hit *top;
+    s[0]=s[1]=START;
+    qlen=lower(query,q);
+    if(qlen==0||k<=0)return 0;
+    top=grow(NULL,(size_t)k*sizeof(Hit));
+    if(!prefix&&qlen<3){
+        for(i=0;i<count;i++)found=consider(top,found,k,titles,stride,i,q,qlen,prefix);
+    }
+    else{
+        unsigned char *g=prefix?s:q;
+        int glen=prefix?qlen+2:qlen;
+        for(i=0;i+2<glen;i++){
+            uint32_t key=trigram(g+i);
+            size_t slot=slotOf(ix,key);
+            const Posting *p;
+            if(!ix->keys[slot]){
+                n=0;
+                nc=-1;
+                break;
+            }
+            p=&ix->postings[ix->lists[slot]];
+            for(j=0;j<n&&lists[j]!=p;j++);
+            if(j<n)continue;
+            /* shortest first */
+            for(j=n++;j>0&&lists[j-1]->count>p->count;j--)lists[j]=lists[j-1];
+            lists[j]=p;
+        }
+        if(nc==0){
+            Cursor c={lists[0],0,-1,0};
+            int v;
+            cand=grow(NULL,(size_t)lists[0]->count*sizeof(int));
+            while((v=next(&c))<count)cand[nc++]=v;
+            for(i=1;i<n&&nc>0;i++){
+                Cursor d={lists[i],0,-1,0};
+                int m=0;
+                for(j=0;j<nc;j++)if(seek(&d,cand[j])==cand[j])cand[m++]=cand[j];
+                nc=m;
+            }
+            PF_COUNT("task1.titleSearch.candidates",nc);
+            for(i=0;i<nc;i++)found=consider(top,found,k,titles,stride,cand[i],q,qlen,prefix);
+        }
+    }
+    for(i=0;i<found;i++)results[i]=top[i].book;
+    free(cand);
+    free(top);
+    return found;
+}
+size_t titleIndexBytes(const TitleIndex *ix){
+    size_t bytes=sizeof(TitleIndex)+(ix->mask+1)*(sizeof(uint32_t)+sizeof(int))+(size_t)ix->cap*sizeof(Posting);
+    int i;
+    for(i=0;i<ix->count;i++){
+        const Posting *p=&ix->postings[i];
+        bytes+=p->cap+(size_t)p->blockCap*(sizeof(int)+sizeof(uint32_t));
+    }
+    return bytes;
+}
@@ -0,0 +1,30 @@
+#ifndef TITLEINDEX_H
+#define TITLEINDEX_H
+
+#include <stddef.h>
+
+/* Trigram index over book titles for substring and prefix search.
+ * Titles are lowercased and indexed by every trigram, plus two anchored at
+ * the start of the title for prefix queries. A trigram's posting list holds
+ * book indexes as varint deltas, with a skip entry every TITLE_SKIP postings.
+ * A query intersects the lists of its trigrams, shortest first, checks the
+ * candidates against the titles and keeps the best k: exact title, then
+ * prefix, then start of a word, then anywhere; shorter titles first.
+ * Substring queries shorter than 3 characters scan the titles. */
+
+#define TITLE_TOP_K 10
+#define TITLE_SKIP 128
+
+typedef struct TitleIndex TitleIndex;
+
+TitleIndex *titleIndexCreate(void);
+void titleIndexFree(TitleIndex *ix);
+/* Index titles[book]; books are added in increasing order */
+void titleIndexAdd(TitleIndex *ix,int book,const char *title);
+/* Best k books (of the first count) whose title contains query, or starts
+   with it if prefix is set; returns how many were found. Book b's title is
+   at titles+b*stride, so titles can sit in an array of records */
+int titleIndexSearch(const TitleIndex *ix,const char *titles,size_t stride,int count,const char *query,int prefix,int results[],int k);
+size_t titleIndexBytes(const TitleIndex *ix);
+
+#endif
@@ -0,0 +1,424 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "session.h"
+
+/* ---- Seeded workload generator for the interactive programs ----
+ *
+ * Emits a stdin script in the command language of one program:
+ *
+ *   pfgen <task1|question3|question5|question6> [options] > script.txt
+ *
+ *   --seed N       RNG seed (default 1); same seed -> same script
+ *   --ops N        number of operations (default 1000)
+ *   --keys N       key space: ISBNs / employees / student ids (default 1000)
+ *   --zipf S       key skew exponent, 0 = uniform (default 0.99)
+ *   --size N       typical text size in bytes (titles, names, lines; default 32)
+ *   --mix a=w,...  operation weights, see the per-program op names below
+ *   --trace FILE   write a binary session trace instead of text
+ *   --think-us N   spacing between lines in the trace (default 0)
+ *
+ * The generator tracks the program's state (which keys exist, how many
+ * lines the buffer has, ...) so every emitted line is consumed the way the
+ * program will actually read it.
+ */
+
+#define MAX_OPS 8
+
+typedef struct {
+    const char *name;
+    double weight;
+} OpWeight;
+
+typedef struct {
+    unsigned long long rng;
+    long long ops;
+    int keys;
+    double zipf;
+    int size;
+    OpWeight mix[MAX_OPS];
+    int mixCount;
+    double *cdf;          /* Zipf CDF over key ranks */
+    SessionWriter *trace;
+    long long thinkUs;
+    long long clockUs;
+} Gen;
+
+/* ---- random helpers ---- */
+
+static unsigned long long nextRand(Gen *g) {
+    /* splitmix64: good enough and stable across platforms */
+    unsigned long long z = (g->rng += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static double uniform(Gen *g) {
+    return (nextRand(g) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int randRange(Gen *g, int n) {
+    return n > 0 ? (int) (nextRand(g) % (unsigned long long) n) : 0;
+}
+
+static void buildZipf(Gen *g) {
+    g->cdf = (double *) malloc((size_t) g->keys * sizeof(double));
+    if (!g->cdf) {
+        perror("malloc failed");
+        exit(1);
+    }
+    double sum = 0;
+    for (int k = 0; k < g->keys; k++) {
+        sum += g->zipf > 0 ? 1.0 / pow((double) k + 1, g->zipf) : 1.0;
+        g->cdf[k] = sum;
+    }
+    for (int k = 0; k < g->keys; k++) g->cdf[k] /= sum;
+}
+
+/* rank in [0, keys): rank 0 is the hottest key */
+static int zipfRank(Gen *g) {
+    double u = uniform(g);
+    int lo = 0, hi = g->keys - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (g->cdf[mid] < u) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static int pickOp(Gen *g) {
+    double total = 0;
+    for (int i = 0; i < g->mixCount; i++) total += g->mix[i].weight;
+    double u = uniform(g) * total;
+    for (int i = 0; i < g->mixCount; i++) {
+        if (u < g->mix[i].weight) return i;
+        u -= g->mix[i].weight;
+    }
+    return g->mixCount - 1;
+}
+
+static int opIs(Gen *g, int op, const char *name) {
+    return strcmp(g->mix[op].name, name) == 0;
+}
+
+/* random words, at most maxLen bytes, no leading/trailing blanks */
+static void randomText(Gen *g, char *out, int maxLen, int allowSpaces) {
+    static const char *words[] = {
+        "alpha", "delta", "orbit", "cache", "index", "query", "level", "river",
+        "north", "stone", "light", "paper", "metal", "green", "sound", "field",
+    };
+    int target = g->size / 2 + randRange(g, g->size + 1);
+    if (target > maxLen) target = maxLen;
+    if (target < 1) target = 1;
+    int len = 0;
+    while (len < target) {
+        const char *w = words[randRange(g, 16)];
+        int wl = (int) strlen(w);
+        if (len + wl + 1 > target && len > 0) break;
+        if (len > 0) out[len++] = allowSpaces ? ' ' : '_';
+        if (len + wl > maxLen) wl = maxLen - len;
+        memcpy(out + len, w, (size_t) wl);
+        len += wl;
+    }
+    out[len] = '\0';
+}
+
+/* ---- output ---- */
+
+static void emit(Gen *g, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void emit(Gen *g, const char *fmt, ...) {
+    char line[4096];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line) - 1, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if (n > (int) sizeof(line) - 2) n = (int) sizeof(line) - 2;
+    line[n++] = '\n';
+    if (g->trace) {
+        g->clockUs += g->thinkUs;
+        sessionWriteLine(g->trace, g->clockUs, line, (size_t) n);
+    } else {
+        fwrite(line, 1, (size_t) n, stdout);
+    }
+}
+
+/* ---- task1: 1 add, 2 sale, 3 low-stock report, 4 exit ---- */
+
+static void genTask1(Gen *g) {
+    unsigned char *present = (unsigned char *) calloc((size_t) g->keys, 1);
+    char title[50];
+    if (!present) {
+        perror("calloc failed");
+        exit(1);
+    }
+
+    for (long long i = 0; i < g->ops; i++) {
+        int op = pickOp(g);
+        if (opIs(g, op, "add")) {
+            int rank = zipfRank(g);
+            emit(g, "1");
+            emit(g, "%d", 100000 + rank);
+            if (present[rank]) continue;     /* "Book already exists" */
+            randomText(g, title, 49, 1);
+            emit(g, "%s", title);
+            emit(g, "%d.%02d", 5 + randRange(g, 95), randRange(g, 100));
+            emit(g, "%d", randRange(g, 20));
+            present[rank] = 1;
+        } else if (opIs(g, op, "sale")) {
+            int rank = zipfRank(g);
+            emit(g, "2");
+            emit(g, "%d", 100000 + rank);
+            if (present[rank]) emit(g, "%d", 1 + randRange(g, 3));
+        } else {
+            emit(g, "3");
+        }
+    }
+    emit(g, "4");
+    free(present);
+}
+
+/* ---- question3: n employees, then 1 display, 2 highest, 3 search, 4 bonus, 5 exit ---- */
+
+static void genQuestion3(Gen *g) {
+    char name[50], designation[50];
+    int n = g->keys;
+
+    emit(g, "%d", n);
+    for (int i = 0; i < n; i++) {
+        snprintf(name, sizeof(name), "emp%d", i + 1);
+        randomText(g, designation, 20, 0);
+        emit(g, "%d", i + 1);
+        emit(g, "%s", name);
+        emit(g, "%s", designation);
+        emit(g, "%d", 20000 + randRange(g, 80000));
+    }
+
+    for (long long i = 0; i < g->ops; i++) {
+        int op = pickOp(g);
+        if (opIs(g, op, "display")) {
+            emit(g, "1");
+        } else if (opIs(g, op, "highest")) {
+            emit(g, "2");
+        } else if (opIs(g, op, "search-id")) {
+            emit(g, "3");
+            emit(g, "1");
+            emit(g, "%d", zipfRank(g) % (n + 1) + 1);   /* occasionally misses */
+        } else if (opIs(g, op, "search-name")) {
+            emit(g, "3");
+            emit(g, "2");
+            emit(g, "emp%d", zipfRank(g) % (n + 1) + 1);
+        } else {
+            emit(g, "4");
+        }
+    }
+    emit(g, "5");
+}
+
+/* ---- question5: a / i / d / r / p / s / l / f, q to quit ---- */
+
+static void genQuestion5(Gen *g) {
+    char text[4000];
+    long long size = 0, fileLines = -1;
+    const char *file = "pfgen_q5.txt";
+    int maxText = g->size * 2 < (int) sizeof(text) - 1 ? g->size * 2 : (int) sizeof(text) - 1;
+
+    for (long long i = 0; i < g->ops; i++) {
+        const char *op = g->mix[pickOp(g)].name;
+        /* edits of existing lines need a line to edit */
+        if (size == 0 && (strcmp(op, "delete") == 0 || strcmp(op, "replace") == 0)) op = "append";
+        /* line index: hot lines near the top of the buffer */
+        long long line = size > 0 ? zipfRank(g) % size + 1 : 1;
+
+        if (strcmp(op, "append") == 0) {
+            randomText(g, text, maxText, 1);
+            emit(g, "a");
+            emit(g, "%s", text);
+            size++;
+        } else if (strcmp(op, "insert") == 0) {
+            randomText(g, text, maxText, 1);
+            emit(g, "i %lld", size > 0 ? zipfRank(g) % (size + 1) + 1 : 1);
+            emit(g, "%s", text);
+            size++;
+        } else if (strcmp(op, "delete") == 0) {
+            emit(g, "d %lld", line);
+            size--;
+        } else if (strcmp(op, "replace") == 0) {
+            randomText(g, text, maxText, 1);
+            emit(g, "r %lld", line);
+            emit(g, "%s", text);
+        } else if (strcmp(op, "print") == 0) {
+            emit(g, "p");
+        } else if (strcmp(op, "save") == 0) {
+            emit(g, "s %s", file);
+            fileLines = size;
+        } else if (strcmp(op, "load") == 0) {
+            emit(g, "l %s", file);
+            if (fileLines >= 0) size = fileLines;
+        } else {
+            emit(g, "f");
+        }
+    }
+    emit(g, "q");
+}
+
+/* ---- question6: 1 register, 2 update, 3 delete, 4 view, 5 report, 6 exit ----
+ * Assumes the program starts with no members.dat in its working directory. */
+
+static void genQuestion6(Gen *g) {
+    static const char *batches[] = {"CS", "SE", "Cyber Security", "AI"};
+    static const char *types[] = {"IEEE", "ACM"};
+    static const char *interests[] = {"IEEE", "ACM", "Both"};
+    unsigned char *present = (unsigned char *) calloc((size_t) g->keys, 1);
+    char name[100];
+    if (!present) {
+        perror("calloc failed");
+        exit(1);
+    }
+
+    for (long long i = 0; i < g->ops; i++) {
+        int op = pickOp(g);
+        int rank = zipfRank(g);
+        int id = 1000 + rank;
+
+        if (opIs(g, op, "register")) {
+            emit(g, "1");
+            emit(g, "%d", id);
+            if (present[rank]) continue;     /* "Duplicate ID!" */
+            randomText(g, name, 60 < g->size * 2 ? 60 : g->size * 2, 1);
+            emit(g, "%s", name);
+            emit(g, "%s", batches[randRange(g, 4)]);
+            emit(g, "%s", types[randRange(g, 2)]);
+            emit(g, "2024-%02d-%02d", 1 + randRange(g, 12), 1 + randRange(g, 28));
+            emit(g, "%d-%02d-%02d", 1998 + randRange(g, 8), 1 + randRange(g, 12), 1 + randRange(g, 28));
+            emit(g, "%s", interests[randRange(g, 3)]);
+            present[rank] = 1;
+        } else if (opIs(g, op, "update")) {
+            emit(g, "2");
+            emit(g, "%d", id);
+            emit(g, "%s", randRange(g, 2) ? batches[randRange(g, 4)] : "");
+            emit(g, "%s", randRange(g, 2) ? types[randRange(g, 2)] : "");
+        } else if (opIs(g, op, "delete")) {
+            emit(g, "3");
+            emit(g, "%d", id);
+            present[rank] = 0;
+        } else if (opIs(g, op, "view")) {
+            emit(g, "4");
+        } else {
+            emit(g, "5");
+            emit(g, "%s", batches[randRange(g, 4)]);
+            emit(g, "%s", interests[randRange(g, 3)]);
+        }
+    }
+    emit(g, "6");
+    free(present);
+}
+
+/* ---- driver ---- */
+
+typedef struct {
+    const char *program;
+    void (*generate)(Gen *g);
+    const char *defaultMix;
+} Program;
+
+static const Program programs[] = {
+    {"task1", genTask1, "add=30,sale=60,report=10"},
+    {"question3", genQuestion3, "display=5,highest=20,search-id=40,search-name=25,bonus=10"},
+    {"question5", genQuestion5, "append=40,insert=15,delete=10,replace=20,print=5,save=4,load=2,shrink=4"},
+    {"question6", genQuestion6, "register=35,update=25,delete=10,view=5,report=25"},
+};
+
+static int parseMix(Gen *g, const char *spec, const char *defaults) {
+    char buf[512];
+    g->mixCount = 0;
+    snprintf(buf, sizeof(buf), "%s", spec);
+    for (char *tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+        char *eq = strchr(tok, '=');
+        if (!eq || g->mixCount >= MAX_OPS) return -1;
+        *eq = '\0';
+        /* op names must be ones the program knows */
+        const char *known = strstr(defaults, tok);
+        size_t len = strlen(tok);
+        if (!known || known[len] != '=' || (known != defaults && known[-1] != ',')) {
+            fprintf(stderr, "pfgen: unknown operation '%s' (known: %s)\n", tok, defaults);
+            return -1;
+        }
+        g->mix[g->mixCount].name = known;   /* points into static string, '=' terminated */
+        g->mix[g->mixCount].weight = atof(eq + 1);
+        g->mixCount++;
+    }
+    return g->mixCount > 0 ? 0 : -1;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s <task1|question3|question5|question6> [--seed N] [--ops N] [--keys N]\n"
+                    "       [--zipf S] [--size N] [--mix op=w,...] [--trace FILE] [--think-us N]\n", argv0);
+    for (size_t i = 0; i < sizeof(programs) / sizeof(programs[0]); i++)
+        fprintf(stderr, "  %-10s ops: %s\n", programs[i].program, programs[i].defaultMix);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    Gen g;
+    const Program *prog = NULL;
+    const char *mix = NULL, *tracePath = NULL;
+    SessionWriter writer;
+
+    if (argc < 2) usage(argv[0]);
+    for (size_t i = 0; i < sizeof(programs) / sizeof(programs[0]); i++)
+        if (strcmp(argv[1], programs[i].program) == 0) prog = &programs[i];
+    if (!prog) usage(argv[0]);
+
+    memset(&g, 0, sizeof(g));
+    g.rng = 1;
+    g.ops = 1000;
+    g.keys = 1000;
+    g.zipf = 0.99;
+    g.size = 32;
+    for (int i = 2; i < argc; i++) {
+        const char *next = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!next) usage(argv[0]);
+        if (strcmp(argv[i], "--seed") == 0) g.rng = strtoull(next, NULL, 10);
+        else if (strcmp(argv[i], "--ops") == 0) g.ops = atoll(next);
+        else if (strcmp(argv[i], "--keys") == 0) g.keys = atoi(next);
+        else if (strcmp(argv[i], "--zipf") == 0) g.zipf = atof(next);
+        else if (strcmp(argv[i], "--size") == 0) g.size = atoi(next);
+        else if (strcmp(argv[i], "--mix") == 0) mix = next;
+        else if (strcmp(argv[i], "--trace") == 0) tracePath = next;
+        else if (strcmp(argv[i], "--think-us") == 0) g.thinkUs = atoll(next);
+        else usage(argv[0]);
+        i++;
+    }
+    if (g.keys < 1) g.keys = 1;
+    if (g.size < 1) g.size = 1;
+
+    /* the default mix string doubles as the table of known op names */
+    if (parseMix(&g, mix ? mix : prog->defaultMix, prog->defaultMix) != 0) usage(argv[0]);
+
+    /* make op names plain C strings (they point into defaultMix) */
+    char names[MAX_OPS][32];
+    for (int i = 0; i < g.mixCount; i++) {
+        size_t len = strcspn(g.mix[i].name, "=");
+        snprintf(names[i], sizeof(names[i]), "%.*s", (int) len, g.mix[i].name);
+        g.mix[i].name = names[i];
+    }
+
+    buildZipf(&g);
+    if (tracePath) {
+        char *cmd[] = {argv[1]};
+        if (sessionWriterOpen(&writer, tracePath, 1, cmd) != 0) return 1;
+        g.trace = &writer;
+    }
+
+    prog->generate(&g);
+
+    free(g.cdf);
+    if (g.trace && sessionWriterClose(&writer) != 0) return 1;
+    return 0;
+}
@@ -0,0 +1,433 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "session.h"
+
+/* ---- Session capture and replay for the interactive programs ----
+ *
+ *   pftrace record <trace> -- <program> [args...]
+ *       Run the program, forwarding our stdin to it line by line and its
+ *       output to our stdout; every input line is stored with its time.
+ *
+ *   pftrace replay <trace> [options] [-- <program> [args...]]
+ *       Feed the recorded lines to the program (by default the command
+ *       stored in the trace) and report throughput and latency.
+ *         --timed        keep the recorded spacing between lines
+ *         --speed X      with --timed, play X times faster
+ *         --echo         copy the program's output to stdout
+ *         --timeout MS   give up waiting for a prompt after MS (default 2000)
+ *         --prompt STR   output suffix that means "ready for input"
+ *                        (repeatable; default ": ", "> ", ":\n")
+ *
+ *   pftrace dump <trace>
+ *       Print the trace as text.
+ *
+ * The program runs on a pseudo-terminal so its stdio flushes prompts the
+ * way it does interactively. A line's latency is the time from sending it
+ * until the program's output ends in one of the prompt suffixes.
+ */
+
+#define MAX_PROMPTS 16
+#define HIST_BUCKETS 40
+
+typedef struct {
+    pid_t pid;
+    int master;
+} Child;
+
+static long long nowUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/* ---- child on a pseudo-terminal ---- */
+
+static int startChild(Child *c, char **argv) {
+    c->master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (c->master < 0 || grantpt(c->master) != 0 || unlockpt(c->master) != 0) {
+        perror("pftrace: cannot allocate a pseudo-terminal");
+        return -1;
+    }
+    char *slaveName = ptsname(c->master);
+    if (!slaveName) {
+        perror("pftrace: ptsname failed");
+        return -1;
+    }
+
+    c->pid = fork();
+    if (c->pid < 0) {
+        perror("pftrace: fork failed");
+        return -1;
+    }
+    if (c->pid == 0) {
+        setsid();
+        int slave = open(slaveName, O_RDWR);
+        if (slave < 0) _exit(127);
+        struct termios tio;
+        if (tcgetattr(slave, &tio) == 0) {
+            cfmakeraw(&tio);          /* no echo, no CR/LF translation */
+            tcsetattr(slave, TCSANOW, &tio);
+        }
+        dup2(slave, STDIN_FILENO);
+        dup2(slave, STDOUT_FILENO);
+        if (slave > STDOUT_FILENO) close(slave);
+        close(c->master);
+        execvp(argv[0], argv);
+        fprintf(stderr, "pftrace: cannot run %s: %s\n", argv[0], strerror(errno));
+        _exit(127);
+    }
+    fcntl(c->master, F_SETFL, fcntl(c->master, F_GETFL) | O_NONBLOCK);
+    return 0;
+}
+
+/* Hang up the terminal (the program gets SIGHUP / EOF) and reap it */
+static int stopChild(Child *c) {
+    int status = 0;
+    close(c->master);
+    for (int i = 0; i < 100; i++) {
+        if (waitpid(c->pid, &status, WNOHANG) == c->pid) return status;
+        usleep(10000);
+    }
+    kill(c->pid, SIGKILL);
+    waitpid(c->pid, &status, 0);
+    return status;
+}
+
+/* ---- output handling ---- */
+
+typedef struct {
+    const char *prompts[MAX_PROMPTS];
+    int promptCount;
+    char tail[64];       /* last bytes of output, NUL-terminated */
+    size_t tailLen;
+    int echo;
+    long long bytesOut;
+} OutputState;
+
+static void feedOutput(OutputState *o, const char *data, size_t n) {
+    o->bytesOut += (long long) n;
+    if (o->echo) fwrite(data, 1, n, stdout);
+    if (n >= sizeof(o->tail) - 1) {
+        memcpy(o->tail, data + n - (sizeof(o->tail) - 1), sizeof(o->tail) - 1);
+        o->tailLen = sizeof(o->tail) - 1;
+    } else {
+        size_t keep = sizeof(o->tail) - 1 - n;
+        if (keep > o->tailLen) keep = o->tailLen;
+        memmove(o->tail, o->tail + o->tailLen - keep, keep);
+        memcpy(o->tail + keep, data, n);
+        o->tailLen = keep + n;
+    }
+    o->tail[o->tailLen] = '\0';
+}
+
+static int atPrompt(const OutputState *o) {
+    for (int i = 0; i < o->promptCount; i++) {
+        size_t len = strlen(o->prompts[i]);
+        if (len <= o->tailLen && memcmp(o->tail + o->tailLen - len, o->prompts[i], len) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+/* Read whatever is available within timeoutMs. Returns bytes read, 0 on
+ * timeout, -1 when the program has gone away. */
+static long drainOutput(Child *c, OutputState *o, int timeoutMs) {
+    struct pollfd pfd = {c->master, POLLIN, 0};
+    char buf[65536];
+    long total = 0;
+    if (poll(&pfd, 1, timeoutMs) <= 0) return 0;
+    for (;;) {
+        ssize_t n = read(c->master, buf, sizeof(buf));
+        if (n > 0) {
+            feedOutput(o, buf, (size_t) n);
+            total += n;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) return total;
+        return total > 0 ? total : -1;   /* EIO: slave side closed */
+    }
+}
+
+/* Wait until the output ends in a prompt. Returns 0 ready, 1 timeout, -1 exited */
+static int waitReady(Child *c, OutputState *o, int timeoutMs) {
+    long long deadline = nowUs() + (long long) timeoutMs * 1000;
+    o->tailLen = 0;
+    o->tail[0] = '\0';
+    for (;;) {
+        long long left = (deadline - nowUs()) / 1000;
+        if (left <= 0) return 1;
+        long n = drainOutput(c, o, (int) left);
+        if (n < 0) return -1;
+        if (n > 0 && atPrompt(o)) return 0;
+    }
+}
+
+/* Write all of 'line', draining output meanwhile so neither side blocks */
+static int sendLine(Child *c, OutputState *o, const char *line, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(c->master, line, len);
+        if (n > 0) {
+            line += n;
+            len -= (size_t) n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            if (drainOutput(c, o, 10) < 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* ---- record ---- */
+
+static int cmdRecord(const char *tracePath, char **cmd, int cmdCount) {
+    SessionWriter writer;
+    OutputState out;
+    Child child;
+    char line[65536];
+    size_t lineLen = 0;
+
+    memset(&out, 0, sizeof(out));
+    out.echo = 1;
+    if (sessionWriterOpen(&writer, tracePath, cmdCount, cmd) != 0) return 1;
+    if (startChild(&child, cmd) != 0) return 1;
+
+    long long t0 = nowUs();
+    int inputOpen = 1;
+    while (inputOpen) {
+        struct pollfd pfd[2] = {{STDIN_FILENO, POLLIN, 0}, {child.master, POLLIN, 0}};
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (pfd[1].revents) {
+            if (drainOutput(&child, &out, 0) < 0) break;
+            fflush(stdout);
+        }
+        if (pfd[0].revents) {
+            char buf[4096];
+            ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+            if (n <= 0) {
+                inputOpen = 0;
+                n = 0;
+            }
+            for (ssize_t i = 0; i < n; i++) {
+                if (lineLen < sizeof(line)) line[lineLen++] = buf[i];
+                if (buf[i] == '\n' || lineLen == sizeof(line)) {
+                    sessionWriteLine(&writer, nowUs() - t0, line, lineLen);
+                    sendLine(&child, &out, line, lineLen);
+                    lineLen = 0;
+                }
+            }
+        }
+    }
+    if (lineLen > 0) {
+        sessionWriteLine(&writer, nowUs() - t0, line, lineLen);
+        sendLine(&child, &out, line, lineLen);
+    }
+
+    /* let the program finish what it was given */
+    while (drainOutput(&child, &out, 500) > 0) fflush(stdout);
+    fflush(stdout);
+    stopChild(&child);
+
+    fprintf(stderr, "pftrace: recorded %lld line(s) in %.3f s to %s\n",
+            writer.lines, (nowUs() - t0) / 1e6, tracePath);
+    return sessionWriterClose(&writer) == 0 ? 0 : 1;
+}
+
+/* ---- replay ---- */
+
+static int bucketOf(long long us) {
+    int b = 0;
+    while (us > 1 && b < HIST_BUCKETS - 1) {
+        us >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static int cmpLL(const void *a, const void *b) {
+    long long x = *(const long long *) a, y = *(const long long *) b;
+    return (x > y) - (x < y);
+}
+
+static int cmdReplay(const char *tracePath, OutputState *out, int timed, double speed,
+                     int timeoutMs, char **cmd) {
+    SessionReader reader;
+    Child child;
+    long long hist[HIST_BUCKETS] = {0};
+    long long *lat = NULL, count = 0, cap = 0, timeouts = 0, bytesIn = 0;
+    const char *line;
+    size_t len;
+    long long us;
+    int rc;
+
+    if (sessionReaderOpen(&reader, tracePath) != 0) return 1;
+    if (!cmd) cmd = reader.argv;
+    if (!cmd || !cmd[0]) {
+        fprintf(stderr, "pftrace: trace has no command, pass one after --\n");
+        sessionReaderClose(&reader);
+        return 1;
+    }
+    if (startChild(&child, cmd) != 0) {
+        sessionReaderClose(&reader);
+        return 1;
+    }
+
+    long long t0 = nowUs();
+    int state = waitReady(&child, out, timeoutMs);
+    long long startup = nowUs() - t0;
+    long long playStart = nowUs();
+
+    while (state >= 0 && (rc = sessionNext(&reader, &us, &line, &len)) == 1) {
+        if (timed) {
+            long long due = playStart + (long long) (us / speed);
+            long long wait = due - nowUs();
+            if (wait > 0) usleep((useconds_t) wait);
+        }
+        long long sent = nowUs();
+        if (sendLine(&child, out, line, len) != 0) break;
+        bytesIn += (long long) len;
+        state = waitReady(&child, out, timeoutMs);
+        long long took = nowUs() - sent;
+        if (state == 1) timeouts++;
+
+        if (count == cap) {
+            cap = cap ? cap * 2 : 1024;
+            lat = (long long *) realloc(lat, (size_t) cap * sizeof(long long));
+            if (!lat) {
+                perror("realloc failed");
+                exit(1);
+            }
+        }
+        lat[count++] = took;
+        hist[bucketOf(took)]++;
+    }
+    long long elapsed = nowUs() - playStart;
+    while (drainOutput(&child, out, 200) > 0) {}
+    if (out->echo) fflush(stdout);
+    stopChild(&child);
+
+    qsort(lat, (size_t) count, sizeof(long long), cmpLL);
+    fprintf(stderr, "replayed %lld line(s) of %s (%s)\n", count, tracePath,
+            timed ? "recorded timing" : "full speed");
+    fprintf(stderr, "  startup      %.3f ms\n", startup / 1e3);
+    fprintf(stderr, "  elapsed      %.3f s\n", elapsed / 1e6);
+    fprintf(stderr, "  throughput   %.1f lines/s, in %lld B, out %lld B\n",
+            elapsed > 0 ? count * 1e6 / elapsed : 0.0, bytesIn, out->bytesOut);
+    fprintf(stderr, "  timeouts     %lld\n", timeouts);
+    if (count > 0) {
+        fprintf(stderr, "  latency us   p50 %lld  p90 %lld  p99 %lld  max %lld\n",
+                lat[count / 2], lat[(count * 9) / 10], lat[(count * 99) / 100], lat[count - 1]);
+        long long peak = 0;
+        for (int b = 0; b < HIST_BUCKETS; b++) if (hist[b] > peak) peak = hist[b];
+        for (int b = 0; b < HIST_BUCKETS; b++) {
+            if (!hist[b]) continue;
+            int bar = (int) (hist[b] * 50 / peak);
+            fprintf(stderr, "  <%10lld us %8lld |%.*s\n", 2LL << b, hist[b], bar,
+                    "##################################################");
+        }
+    }
+    free(lat);
+    sessionReaderClose(&reader);
+    return 0;
+}
+
+/* ---- dump ---- */
+
+static int cmdDump(const char *tracePath) {
+    SessionReader reader;
+    const char *line;
+    size_t len;
+    long long us;
+    int rc;
+
+    if (sessionReaderOpen(&reader, tracePath) != 0) return 1;
+    printf("# command:");
+    for (int i = 0; i < reader.argc; i++) printf(" %s", reader.argv[i]);
+    printf("\n");
+    while ((rc = sessionNext(&reader, &us, &line, &len)) == 1) {
+        printf("%10.3f ms  %.*s", us / 1e3, (int) len, line);
+        if (len == 0 || line[len - 1] != '\n') printf("\n");
+    }
+    sessionReaderClose(&reader);
+    if (rc < 0) {
+        fprintf(stderr, "pftrace: %s is truncated or corrupt\n", tracePath);
+        return 1;
+    }
+    return 0;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: pftrace record <trace> -- <program> [args...]\n"
+            "       pftrace replay <trace> [--timed] [--speed X] [--echo] [--timeout MS]\n"
+            "                      [--prompt STR]... [-- <program> [args...]]\n"
+            "       pftrace dump <trace>\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) usage();
+    signal(SIGPIPE, SIG_IGN);
+
+    char **cmd = NULL;
+    int cmdCount = 0;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--") == 0) {
+            cmd = argv + i + 1;
+            cmdCount = argc - i - 1;
+            argc = i;
+            break;
+        }
+    }
+    if (cmd && cmdCount == 0) usage();
+
+    if (strcmp(argv[1], "record") == 0) {
+        if (!cmd || argc != 3) usage();
+        return cmdRecord(argv[2], cmd, cmdCount);
+    }
+    if (strcmp(argv[1], "dump") == 0) {
+        if (argc != 3) usage();
+        return cmdDump(argv[2]);
+    }
+    if (strcmp(argv[1], "replay") == 0) {
+        OutputState out;
+        int timed = 0, timeoutMs = 2000;
+        double speed = 1.0;
+        memset(&out, 0, sizeof(out));
+        for (int i = 3; i < argc; i++) {
+            const char *next = i + 1 < argc ? argv[i + 1] : NULL;
+            if (strcmp(argv[i], "--timed") == 0) timed = 1;
+            else if (strcmp(argv[i], "--echo") == 0) out.echo = 1;
+            else if (strcmp(argv[i], "--speed") == 0 && next) { speed = atof(next); i++; }
+            else if (strcmp(argv[i], "--timeout") == 0 && next) { timeoutMs = atoi(next); i++; }
+            else if (strcmp(argv[i], "--prompt") == 0 && next && out.promptCount < MAX_PROMPTS) {
+                out.prompts[out.promptCount++] = next;
+                i++;
+            }
+            else usage();
+        }
+        if (speed <= 0) speed = 1.0;
+        if (out.promptCount == 0) {
+            out.prompts[0] = ": ";
+            out.prompts[1] = "> ";
+            out.prompts[2] = ":\n";
+            out.promptCount = 3;
+        }
+        return cmdReplay(argv[2], &out, timed, speed, timeoutMs, cmd);
+    }
+    usage();
+    return 2;
+}
@@ -0,0 +1,139 @@
+#include "session.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int putVarint(FILE *f, unsigned long long v) {
+    unsigned char out[10];
+    int n = 0;
+    do {
+        unsigned char b = (unsigned char) (v & 0x7f);
+        v >>= 7;
+        out[n++] = (unsigned char) (b | (v ? 0x80 : 0));
+    } while (v);
+    return fwrite(out, 1, (size_t) n, f) == (size_t) n ? 0 : -1;
+}
+
+static int getVarint(SessionReader *r, unsigned long long *v) {
+    unsigned long long x = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (r->pos >= r->size) return -1;
+        unsigned char b = r->data[r->pos++];
+        x |= (unsigned long long) (b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = x;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int sessionWriterOpen(SessionWriter *w, const char *path, int argc, char **argv) {
+    w->f = fopen(path, "wb");
+    w->lastUs = 0;
+    w->lines = 0;
+    if (!w->f) {
+        perror("session: cannot open trace for write");
+        return -1;
+    }
+    fwrite(SESSION_MAGIC, 1, 8, w->f);
+    putVarint(w->f, (unsigned long long) argc);
+    for (int i = 0; i < argc; i++) {
+        size_t len = strlen(argv[i]);
+        putVarint(w->f, len);
+        fwrite(argv[i], 1, len, w->f);
+    }
+    return 0;
+}
+
+int sessionWriteLine(SessionWriter *w, long long us, const char *line, size_t len) {
+    long long delta = us - w->lastUs;
+    if (delta < 0) delta = 0;
+    w->lastUs += delta;
+    w->lines++;
+    if (putVarint(w->f, (unsigned long long) delta) != 0 || putVarint(w->f, len) != 0 ||
+        fwrite(line, 1, len, w->f) != len) {
+        perror("session: write failed");
+        return -1;
+    }
+    return 0;
+}
+
+int sessionWriterClose(SessionWriter *w) {
+    int rc = 0;
+    if (w->f && fclose(w->f) == EOF) {
+        perror("session: close failed");
+        rc = -1;
+    }
+    w->f = NULL;
+    return rc;
+}
+
+int sessionReaderOpen(SessionReader *r, const char *path) {
+    memset(r, 0, sizeof(*r));
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror("session: cannot open trace");
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    if (size < 8) {
+        fprintf(stderr, "session: %s is not a trace\n", path);
+        fclose(f);
+        return -1;
+    }
+    r->data = (unsigned char *) malloc((size_t) size);
+    if (!r->data || fread(r->data, 1, (size_t) size, f) != (size_t) size) {
+        perror("session: read failed");
+        free(r->data);
+        r->data = NULL;
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    r->size = (size_t) size;
+
+    unsigned long long argc, len;
+    if (memcmp(r->data, SESSION_MAGIC, 8) != 0) goto corrupt;
+    r->pos = 8;
+    if (getVarint(r, &argc) != 0 || argc > 4096) goto corrupt;
+    r->argv = (char **) calloc((size_t) argc + 1, sizeof(char *));
+    if (!r->argv) goto corrupt;
+    for (r->argc = 0; r->argc < (int) argc; r->argc++) {
+        if (getVarint(r, &len) != 0 || len > r->size - r->pos) goto corrupt;
+        r->argv[r->argc] = (char *) malloc((size_t) len + 1);
+        if (!r->argv[r->argc]) goto corrupt;
+        memcpy(r->argv[r->argc], r->data + r->pos, (size_t) len);
+        r->argv[r->argc][len] = '\0';
+        r->pos += (size_t) len;
+    }
+    return 0;
+
+corrupt:
+    fprintf(stderr, "session: %s is corrupt\n", path);
+    sessionReaderClose(r);
+    return -1;
+}
+
+int sessionNext(SessionReader *r, long long *us, const char **line, size_t *len) {
+    unsigned long long delta, n;
+    if (r->pos >= r->size) return 0;
+    if (getVarint(r, &delta) != 0 || getVarint(r, &n) != 0 || n > r->size - r->pos) return -1;
+    r->us += (long long) delta;
+    *us = r->us;
+    *line = (const char *) r->data + r->pos;
+    *len = (size_t) n;
+    r->pos += (size_t) n;
+    return 1;
+}
+
+void sessionReaderClose(SessionReader *r) {
+    if (r->argv) {
+        for (int i = 0; i < r->argc; i++) free(r->argv[i]);
+        free(r->argv);
+    }
+    free(r->data);
+    memset(r, 0, sizeof(*r));
+}
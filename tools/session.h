@@ -0,0 +1,47 @@
+#ifndef PFTHEORY_SESSION_H
+#define PFTHEORY_SESSION_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* ---- Compact binary session traces ----
+ *
+ * A trace is the stdin of one interactive session, line by line, with the
+ * time each line was entered:
+ *
+ *   "PFTRACE1"                            8-byte magic
+ *   varint argc, then argc x (varint len, bytes)   command that was recorded
+ *   records: varint deltaUs, varint len, bytes     one per input line
+ *
+ * Varints are unsigned LEB128; deltaUs is relative to the previous record
+ * (the first one to the start of the session). Lines keep their '\n'.
+ */
+
+#define SESSION_MAGIC "PFTRACE1"
+
+typedef struct {
+    FILE *f;
+    long long lastUs;
+    long long lines;
+} SessionWriter;
+
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t pos;
+    int argc;
+    char **argv;       /* NULL-terminated, owned by the reader */
+    long long us;      /* absolute time of the last returned record */
+} SessionReader;
+
+/* Returns 0 on success, -1 on error (errno / message printed) */
+int sessionWriterOpen(SessionWriter *w, const char *path, int argc, char **argv);
+int sessionWriteLine(SessionWriter *w, long long us, const char *line, size_t len);
+int sessionWriterClose(SessionWriter *w);
+
+int sessionReaderOpen(SessionReader *r, const char *path);
+/* 1 = record returned, 0 = end of trace, -1 = corrupt trace */
+int sessionNext(SessionReader *r, long long *us, const char **line, size_t *len);
+void sessionReaderClose(SessionReader *r);
+
+#endif